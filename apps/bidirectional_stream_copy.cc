@@ -1,7 +1,7 @@
 #include "bidirectional_stream_copy.hh"
 
 #include "byte_stream.hh"
-#include "eventloop.hh"
+#include "static_eventloop.hh"
 
 #include <algorithm>
 #include <iostream>
@@ -13,80 +13,103 @@ void bidirectional_stream_copy(Socket &socket) {
     constexpr size_t max_copy_length = 65536;
     constexpr size_t buffer_size = 1048576;
 
-    EventLoop _eventloop{};
     FileDescriptor _input{STDIN_FILENO};
     FileDescriptor _output{STDOUT_FILENO};
     ByteStream _outbound{buffer_size};
     ByteStream _inbound{buffer_size};
     bool _outbound_shutdown{false};
     bool _inbound_shutdown{false};
+    bool _hung_up[3]{false, false, false};  //!< Has each handler's fd hung up? (then it is never polled again)
 
     socket.set_blocking(false);
     _input.set_blocking(false);
     _output.set_blocking(false);
 
-    // rule 1: read from stdin into outbound byte stream
-    _eventloop.add_rule(
-        _input,
-        Direction::In,
-        [&] {
-            _outbound.write(_input.read(_outbound.remaining_capacity()));
-            if (_input.eof()) {
-                _outbound.end_input();
-            }
-        },
-        [&] { return (not _outbound.error()) and (_outbound.remaining_capacity() > 0) and (not _inbound.error()); },
-        [&] { _outbound.end_input(); });
+    // handler 0: read from stdin into outbound byte stream
+    FdHandler stdin_handler{_input,
+                            [&] {
+                                _outbound.commit_write(_input.readv(_outbound.writable_iovecs()));
+                                if (_input.eof()) {
+                                    _outbound.end_input();
+                                }
+                            },
+                            NoOpCallback{},
+                            [&] {
+                                _outbound.end_input();
+                                _hung_up[0] = true;
+                            }};
 
-    // rule 2: read from outbound byte stream into socket
-    _eventloop.add_rule(
-        socket,
-        Direction::Out,
-        [&] {
-            const size_t bytes_to_write = min(max_copy_length, _outbound.buffer_size());
-            const size_t bytes_written = socket.write(_outbound.peek_output(bytes_to_write), false);
-            _outbound.pop_output(bytes_written);
-            if (_outbound.eof()) {
-                socket.shutdown(SHUT_WR);
-                _outbound_shutdown = true;
-            }
-        },
-        [&] { return (not _outbound.buffer_empty()) or (_outbound.eof() and not _outbound_shutdown); },
-        [&] { _outbound.end_input(); });
+    // handler 1: read from outbound byte stream into socket, and from socket into inbound byte stream
+    FdHandler socket_handler{socket,
+                             [&] {
+                                 _inbound.commit_write(socket.readv(_inbound.writable_iovecs()));
+                                 if (socket.eof()) {
+                                     _inbound.end_input();
+                                 }
+                             },
+                             [&] {
+                                 const size_t bytes_to_write = min(max_copy_length, _outbound.buffer_size());
+                                 const size_t bytes_written =
+                                     socket.write(_outbound.peek_output(bytes_to_write), false);
+                                 _outbound.pop_output(bytes_written);
+                                 if (_outbound.eof()) {
+                                     socket.shutdown(SHUT_WR);
+                                     _outbound_shutdown = true;
+                                 }
+                             },
+                             [&] {
+                                 _outbound.end_input();
+                                 _inbound.end_input();
+                                 _hung_up[1] = true;
+                             }};
 
-    // rule 3: read from socket into inbound byte stream
-    _eventloop.add_rule(
-        socket,
-        Direction::In,
-        [&] {
-            _inbound.write(socket.read(_inbound.remaining_capacity()));
-            if (socket.eof()) {
-                _inbound.end_input();
-            }
-        },
-        [&] { return (not _inbound.error()) and (_inbound.remaining_capacity() > 0) and (not _outbound.error()); },
-        [&] { _inbound.end_input(); });
+    // handler 2: read from inbound byte stream into stdout
+    FdHandler stdout_handler{_output,
+                             NoOpCallback{},
+                             [&] {
+                                 const size_t bytes_to_write = min(max_copy_length, _inbound.buffer_size());
+                                 const size_t bytes_written =
+                                     _output.write(_inbound.peek_output(bytes_to_write), false);
+                                 _inbound.pop_output(bytes_written);
 
-    // rule 4: read from inbound byte stream into stdout
-    _eventloop.add_rule(
-        _output,
-        Direction::Out,
-        [&] {
-            const size_t bytes_to_write = min(max_copy_length, _inbound.buffer_size());
-            const size_t bytes_written = _output.write(_inbound.peek_output(bytes_to_write), false);
-            _inbound.pop_output(bytes_written);
+                                 if (_inbound.eof()) {
+                                     _output.close();
+                                     _inbound_shutdown = true;
+                                 }
+                             },
+                             [&] {
+                                 _inbound.end_input();
+                                 _hung_up[2] = true;
+                             }};
 
-            if (_inbound.eof()) {
-                _output.close();
-                _inbound_shutdown = true;
-            }
-        },
-        [&] { return (not _inbound.buffer_empty()) or (_inbound.eof() and not _inbound_shutdown); },
-        [&] { _inbound.end_input(); });
+    StaticEventLoop eventloop{stdin_handler, socket_handler, stdout_handler};
+
+    // interest depends only on the streams, so recompute it after each round of callbacks; a hangup is
+    // final, since a hung-up fd would otherwise be polled (and report POLLHUP) again and again
+    const auto update_interest = [&] {
+        const bool ok = not _outbound.error() and not _inbound.error();
+        eventloop.set_interest(0,
+                               Direction::In,
+                               ok and not _hung_up[0] and not _outbound.input_ended() and
+                                   _outbound.remaining_capacity() > 0);
+        eventloop.set_interest(1,
+                               Direction::Out,
+                               not _hung_up[1] and ((not _outbound.buffer_empty()) or
+                                                    (_outbound.eof() and not _outbound_shutdown)));
+        eventloop.set_interest(1,
+                               Direction::In,
+                               ok and not _hung_up[1] and not _inbound.input_ended() and
+                                   _inbound.remaining_capacity() > 0);
+        eventloop.set_interest(2,
+                               Direction::Out,
+                               not _hung_up[2] and ((not _inbound.buffer_empty()) or
+                                                    (_inbound.eof() and not _inbound_shutdown)));
+    };
 
     // loop until completion
     while (true) {
-        if (EventLoop::Result::Exit == _eventloop.wait_next_event(-1)) {
+        update_interest();
+        if (EventLoop::Result::Exit == eventloop.wait_next_event(-1)) {
             return;
         }
     }
@@ -0,0 +1,272 @@
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "stream_reassembler.hh"
+#include "tcp_header.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Microbenchmarks of individual components (run `sponge_bench [filter]` to run only the benchmarks whose name
+// contains `filter`). Each benchmark is warmed up, then timed over several repetitions; the reported time is
+// the median repetition's, and allocations are counted by replacing the global operator new.
+
+static size_t allocation_count = 0;
+
+void *operator new(size_t size) {
+    ++allocation_count;
+    if (void *ptr = malloc(size)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t /* size */) noexcept { free(ptr); }
+
+//! Keep the compiler from optimizing away the computation of `value`
+template <typename T>
+static inline void keep(const T &value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+static constexpr unsigned int REPETITIONS = 7;
+static constexpr auto TARGET_REPETITION_TIME = milliseconds(20);
+
+static string filter{};
+
+//! Time `op`, which handles `bytes_per_op` bytes per call (or zero if throughput means nothing for it)
+template <typename F>
+static void bench(const string &name, const size_t bytes_per_op, F &&op) {
+    if (name.find(filter) == string::npos) {
+        return;
+    }
+
+    // warm up, and find how many calls take about TARGET_REPETITION_TIME
+    size_t iterations = 1;
+    while (true) {
+        const auto start = steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        if (steady_clock::now() - start >= TARGET_REPETITION_TIME / 4 or iterations >= (size_t{1} << 30)) {
+            iterations *= 4;
+            break;
+        }
+        iterations *= 2;
+    }
+
+    vector<double> ns_per_op;
+    size_t allocations = 0;
+    for (unsigned int rep = 0; rep < REPETITIONS; ++rep) {
+        const size_t allocations_before = allocation_count;
+        const auto start = steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            op();
+        }
+        const auto elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        allocations += allocation_count - allocations_before;
+        ns_per_op.push_back(double(elapsed) / iterations);
+    }
+    sort(ns_per_op.begin(), ns_per_op.end());
+    const double median = ns_per_op[REPETITIONS / 2];
+
+    cout << left << setw(44) << name << right << fixed << setprecision(1) << setw(12) << median << " ns/op";
+    if (bytes_per_op > 0) {
+        cout << setw(12) << bytes_per_op / median * 1000 << " MB/s";
+    } else {
+        cout << setw(17) << "";
+    }
+    cout << setprecision(2) << setw(10) << double(allocations) / (double(iterations) * REPETITIONS) << " allocs/op\n";
+}
+
+static string random_string(const size_t len) {
+    static mt19937 rng{12345};
+    string ret(len, 0);
+    generate(ret.begin(), ret.end(), [&] { return static_cast<char>(rng()); });
+    return ret;
+}
+
+static void bench_byte_stream() {
+    for (const size_t chunk : {1, 64, 1460, 16384}) {
+        const string data = random_string(chunk);
+        const string suffix = "/" + to_string(chunk);
+        ByteStream stream{65536};
+
+        bench("byte_stream/write+pop" + suffix, chunk, [&] {
+            stream.write(data);
+            stream.pop_output(chunk);
+        });
+        bench("byte_stream/write+peek_output+pop" + suffix, chunk, [&] {
+            stream.write(data);
+            keep(stream.peek_output(chunk));
+            stream.pop_output(chunk);
+        });
+        bench("byte_stream/write+peek_contiguous+pop" + suffix, chunk, [&] {
+            stream.write(data);
+            keep(stream.peek_contiguous());
+            stream.pop_output(chunk);
+        });
+        bench("byte_stream/write+read" + suffix, chunk, [&] {
+            stream.write(data);
+            keep(stream.read(chunk));
+        });
+    }
+}
+
+static void bench_reassembler() {
+    static constexpr size_t PIECE = 1024;
+    static constexpr size_t PIECES = 64;
+    static constexpr size_t WINDOW = PIECE * PIECES;
+    const string data = random_string(WINDOW + PIECE);
+
+    // each pattern is a list of (offset, length) pieces covering one window
+    vector<pair<size_t, size_t>> in_order;
+    for (size_t i = 0; i < PIECES; ++i) {
+        in_order.emplace_back(i * PIECE, PIECE);
+    }
+    auto reversed = in_order;
+    reverse(reversed.begin(), reversed.end());
+    auto shuffled = in_order;
+    shuffle(shuffled.begin(), shuffled.end(), mt19937{42});
+    vector<pair<size_t, size_t>> overlapping;
+    for (size_t offset = 0; offset < WINDOW; offset += PIECE / 2) {
+        overlapping.emplace_back(offset, min(PIECE, WINDOW - offset));
+    }
+
+    const vector<pair<string, vector<pair<size_t, size_t>> *>> patterns{
+        {"in_order", &in_order}, {"reversed", &reversed}, {"random", &shuffled}, {"overlapping", &overlapping}};
+    for (const auto &[name, pattern] : patterns) {
+        // the strings are made in advance, so that only push_substring() is timed
+        vector<pair<size_t, string>> pieces;
+        for (const auto &[offset, length] : *pattern) {
+            pieces.emplace_back(offset, data.substr(offset, length));
+        }
+
+        StreamReassembler reassembler{WINDOW};
+        size_t base = 0;
+        bench("reassembler/push_substring/" + name, WINDOW, [&] {
+            for (const auto &[offset, piece] : pieces) {
+                reassembler.push_substring(piece, base + offset, false);
+            }
+            reassembler.stream_out().pop_output(WINDOW);
+            base += WINDOW;
+        });
+    }
+}
+
+static void bench_wrapping_integers() {
+    const WrappingInt32 isn{0xdeadbeef};
+    uint64_t n = uint64_t{1} << 40;
+    bench("wrapping_integers/wrap", 0, [&] { keep(wrap(n++, isn)); });
+
+    uint32_t raw = 0;
+    uint64_t checkpoint = uint64_t{3} << 32;
+    bench("wrapping_integers/unwrap", 0, [&] {
+        keep(unwrap(WrappingInt32{raw}, isn, checkpoint));
+        raw += 1460;
+        checkpoint += 1460;
+    });
+}
+
+static void bench_checksum() {
+    for (const size_t len : {20, 1460, 65536}) {
+        const string data = random_string(len);
+        bench("internet_checksum/add/" + to_string(len), len, [&] {
+            InternetChecksum check;
+            check.add(data);
+            keep(check.value());
+        });
+    }
+}
+
+static void bench_headers() {
+    TCPHeader tcp_header;
+    tcp_header.sport = 1234;
+    tcp_header.dport = 80;
+    tcp_header.seqno = WrappingInt32{12345};
+    tcp_header.ackno = WrappingInt32{67890};
+    tcp_header.ack = true;
+    tcp_header.win = 65000;
+    bench("tcp_header/serialize", TCPHeader::LENGTH, [&] { keep(tcp_header.serialize()); });
+
+    const Buffer tcp_bytes{tcp_header.serialize()};
+    bench("tcp_header/parse", TCPHeader::LENGTH, [&] {
+        TCPHeader parsed;
+        NetParser p{tcp_bytes};
+        keep(parsed.parse(p));
+    });
+
+    IPv4Header ip_header;
+    ip_header.len = IPv4Header::LENGTH + TCPHeader::LENGTH;
+    ip_header.src = 0x0a000001;
+    ip_header.dst = 0x0a000002;
+    bench("ipv4_header/serialize", IPv4Header::LENGTH, [&] { keep(ip_header.serialize()); });
+
+    const Buffer ip_bytes{ip_header.serialize()};
+    bench("ipv4_header/parse", IPv4Header::LENGTH, [&] {
+        IPv4Header parsed;
+        NetParser p{ip_bytes};
+        keep(parsed.parse(p));
+    });
+}
+
+static void bench_buffer_list() {
+    const Buffer header{random_string(40)};
+    const Buffer payload{random_string(1460)};
+    const size_t len = header.size() + payload.size();
+
+    bench("buffer_list/append", len, [&] {
+        BufferList list{header};
+        list.append(payload);
+        keep(list);
+    });
+
+    BufferList list{header};
+    list.append(payload);
+    bench("buffer_list/concatenate", len, [&] { keep(list.concatenate()); });
+    bench("buffer_list/remove_prefix", len, [&] {
+        BufferList copy = list;
+        copy.remove_prefix(header.size() + 1);
+        keep(copy);
+    });
+    bench("buffer_list/as_iovecs", len, [&] { keep(BufferViewList{list}.as_iovecs()); });
+}
+
+int main(int argc, char *argv[]) {
+    try {
+        if (argc > 2) {
+            cerr << "Usage: " << argv[0] << " [FILTER]\n";
+            return EXIT_FAILURE;
+        }
+        if (argc == 2) {
+            filter = argv[1];
+        }
+
+        bench_byte_stream();
+        bench_reassembler();
+        bench_wrapping_integers();
+        bench_checksum();
+        bench_headers();
+        bench_buffer_list();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
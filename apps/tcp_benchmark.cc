@@ -1,112 +1,515 @@
 #include "tcp_connection.hh"
 
+#include <algorithm>
 #include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <malloc.h>
+#include <random>
+#include <sstream>
 #include <string>
+#include <unistd.h>
+#include <vector>
 
 using namespace std;
 using namespace std::chrono;
 
-constexpr size_t len = 100 * 1024 * 1024;
+constexpr size_t DEFAULT_LEN = 100 * 1024 * 1024;
+constexpr size_t DEFAULT_TICK_MS = 1000;
 
-void move_segments(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments, const bool reorder) {
-    while (not x.segments_out().empty()) {
-        segments.emplace_back(move(x.segments_out().front()));
-        x.segments_out().pop();
-    }
-    if (reorder) {
-        for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
-            y.segment_received(move(*it));
+//! One point of a sweep: everything that can be varied between runs
+struct BenchmarkParams {
+    size_t send_capacity = TCPConfig::DEFAULT_CAPACITY;
+    size_t recv_capacity = TCPConfig::DEFAULT_CAPACITY;
+    size_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+    uint16_t rt_timeout = TCPConfig::TIMEOUT_DFLT;
+    double loss = 0;              //!< Probability that a segment is dropped
+    double reorder = 0;           //!< Probability that a segment is delayed
+    size_t reorder_distance = 1;  //!< Number of later segments that a delayed segment is delivered behind
+    double duplicate = 0;         //!< Probability that a segment is delivered twice
+    bool reverse = false;         //!< Deliver each burst of data segments in reverse order
+    size_t tick_ms = DEFAULT_TICK_MS;
+    size_t pairs = 1;             //!< Number of pairs of connections transferring at once
+    size_t write_size = 0;        //!< Largest write() to the sender, or zero for as much as fits
+};
+
+//! Options that hold for the whole run; each list is swept over (as a cartesian product)
+struct BenchmarkOptions {
+    size_t len = DEFAULT_LEN;
+    unsigned int trials = 1;
+    string format = "text";
+    vector<size_t> send_capacity{TCPConfig::DEFAULT_CAPACITY};
+    vector<size_t> recv_capacity{TCPConfig::DEFAULT_CAPACITY};
+    vector<size_t> mss{TCPConfig::MAX_PAYLOAD_SIZE};
+    vector<size_t> rt_timeout{TCPConfig::TIMEOUT_DFLT};
+    vector<double> loss{0};
+    vector<double> reorder{0};
+    vector<size_t> reorder_distance{1};
+    vector<double> duplicate{0};
+    vector<size_t> tick_ms{DEFAULT_TICK_MS};
+    vector<bool> reverse{false, true};  //!< By default, compare in-order with reversed delivery
+    vector<size_t> pairs{1};
+    vector<size_t> write_size{0};
+};
+
+//! \brief The path between the two connections, which can drop, delay and duplicate segments
+class Channel {
+  private:
+    const BenchmarkParams &_params;
+    const bool _reverse;
+    mt19937 _rng;
+    uniform_real_distribution<double> _coin{0, 1};
+    vector<pair<double, TCPSegment>> _in_flight{};
+
+  public:
+    Channel(const BenchmarkParams &params, const bool reverse, const unsigned int seed)
+        : _params(params), _reverse(reverse), _rng(seed) {}
+
+    //! Move the segments queued by `x` to `y`, through the channel
+    void transfer(TCPConnection &x, TCPConnection &y, vector<TCPSegment> &segments) {
+        x.drain_segments(segments);
+        if (_reverse) {
+            reverse(segments.begin(), segments.end());
         }
-    } else {
-        for (auto it = segments.begin(); it != segments.end(); ++it) {
-            y.segment_received(move(*it));
+
+        // each segment is delivered in order of its key: its position, plus the distance if it is delayed
+        for (size_t i = 0; i < segments.size(); ++i) {
+            if (_params.loss > 0 and _coin(_rng) < _params.loss) {
+                continue;
+            }
+            double key = i;
+            if (_params.reorder > 0 and _coin(_rng) < _params.reorder) {
+                key += _params.reorder_distance + 0.5;
+            }
+            if (_params.duplicate > 0 and _coin(_rng) < _params.duplicate) {
+                _in_flight.emplace_back(key, segments[i]);
+            }
+            _in_flight.emplace_back(key, move(segments[i]));
         }
+        segments.clear();
+
+        const auto by_key = [](const auto &a, const auto &b) { return a.first < b.first; };
+        stable_sort(_in_flight.begin(), _in_flight.end(), by_key);
+        for (auto &[key, seg] : _in_flight) {
+            y.segment_received(seg);
+        }
+        _in_flight.clear();
     }
-    segments.clear();
+};
+
+//! A sender `x` and receiver `y`, and the progress of the transfer between them
+struct FlowPair {
+    TCPConnection x;
+    TCPConnection y;
+    size_t sent = 0;
+    size_t received = 0;
+    bool x_closed = false;
+    bool done = false;
+
+    explicit FlowPair(const TCPConfig &config) : x{config}, y{config} {}
+};
+
+//! What one trial measured
+struct TrialResult {
+    double duration_ns;             //!< Time until every pair's transfer was complete
+    double rss_per_pair;            //!< Growth of the resident set size during the trial, per pair, in bytes
+    double tick_ns_per_connection;  //!< Average cost of one call to TCPConnection::tick()
+    LatencyHistogram latency;       //!< Write-to-acknowledgment latencies (measured only with one pair)
+};
+
+//! \returns the resident set size of this process, in bytes
+static size_t resident_set_size() {
+    ifstream statm{"/proc/self/statm"};
+    size_t total_pages = 0, resident_pages = 0;
+    statm >> total_pages >> resident_pages;
+    return resident_pages * sysconf(_SC_PAGESIZE);
 }
 
-void main_loop(const bool reorder) {
+//! \brief Transfer a prefix of `data` over each of `pairs` pairs of connections, serviced round-robin
+//! \details The bytes are split evenly over the pairs (at least one byte each), and each pair's output is
+//! checked as it arrives. Every round services each pair in turn (writing its input, exchanging its
+//! segments through the channels and reading its output) and then ticks every connection.
+//!
+//! With a single pair, the latency of each write is measured too (with more, the histograms would
+//! inflate the memory use per pair).
+static TrialResult run_trial(const BenchmarkParams &params, const string &data, const unsigned int seed) {
     TCPConfig config;
-    TCPConnection x{config}, y{config};
+    config.send_capacity = params.send_capacity;
+    config.recv_capacity = params.recv_capacity;
+    config.max_payload_size = params.mss;
+    config.rt_timeout = params.rt_timeout;
+    config.measure_latency = params.pairs == 1;
 
-    string string_to_send(len, 'x');
-    for (auto &ch : string_to_send) {
-        ch = rand();
-    }
+    Channel data_channel{params, params.reverse, seed};
+    Channel ack_channel{params, false, seed + 1};
 
-    Buffer bytes_to_send{string(string_to_send)};
-    x.connect();
-    y.end_input_stream();
+    // give freed memory back to the OS, so that the growth of the RSS is due to this trial
+    malloc_trim(0);
+    const size_t rss_before = resident_set_size();
 
-    bool x_closed = false;
+    const size_t len = max(size_t{1}, data.size() / params.pairs);
+    deque<FlowPair> flows;
+    for (size_t i = 0; i < params.pairs; ++i) {
+        flows.emplace_back(config);
+        flows.back().x.connect();
+        flows.back().y.end_input_stream();
+    }
+    size_t remaining = flows.size();
 
-    string string_received;
-    string_received.reserve(len);
+    vector<TCPSegment> segments;
+    const string_view bytes_to_send{data.data(), min(len, data.size())};
+    nanoseconds tick_time{0};
+    size_t ticks = 0;
+    size_t rss_during = 0;
 
     const auto first_time = high_resolution_clock::now();
 
     auto loop = [&] {
-        // write input into x
-        while (bytes_to_send.size() and x.remaining_outbound_capacity()) {
-            const auto want = min(x.remaining_outbound_capacity(), bytes_to_send.size());
-            const auto written = x.write(string(bytes_to_send.str().substr(0, want)));
-            if (want != written) {
-                throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
+        for (auto &flow : flows) {
+            // write input into x
+            while (flow.sent < bytes_to_send.size() and flow.x.remaining_outbound_capacity()) {
+                auto want = min(flow.x.remaining_outbound_capacity(), bytes_to_send.size() - flow.sent);
+                if (params.write_size > 0) {
+                    want = min(want, params.write_size);
+                }
+                const auto written = flow.x.write(bytes_to_send.substr(flow.sent, want));
+                if (want != written) {
+                    throw runtime_error("want = " + to_string(want) + ", written = " + to_string(written));
+                }
+                flow.sent += written;
             }
-            bytes_to_send.remove_prefix(written);
-        }
 
-        if (bytes_to_send.size() == 0 and not x_closed) {
-            x.end_input_stream();
-            x_closed = true;
-        }
+            if (flow.sent == bytes_to_send.size() and not flow.x_closed) {
+                flow.x.end_input_stream();
+                flow.x_closed = true;
+            }
 
-        // exchange segments between x and y but in reverse order
-        vector<TCPSegment> segments;
-        move_segments(x, y, segments, reorder);
-        move_segments(y, x, segments, false);
+            // exchange segments between x and y
+            data_channel.transfer(flow.x, flow.y, segments);
+            ack_channel.transfer(flow.y, flow.x, segments);
+
+            // read output from y, and check it
+            ByteStream &output = flow.y.inbound_stream();
+            while (not output.buffer_empty()) {
+                const string_view chunk = output.peek_contiguous();
+                if (chunk != bytes_to_send.substr(flow.received, chunk.size())) {
+                    throw runtime_error("strings sent vs. received don't match");
+                }
+                flow.received += chunk.size();
+                output.pop_output(chunk.size());
+            }
 
-        // read output from y
-        const auto available_output = y.inbound_stream().buffer_size();
-        if (available_output > 0) {
-            string_received.append(y.inbound_stream().read(available_output));
+            if (not flow.done and output.eof()) {
+                if (flow.received != bytes_to_send.size()) {
+                    throw runtime_error("stream ended early");
+                }
+                flow.done = true;
+                --remaining;
+            } else if (not flow.done and (not flow.x.active() or not flow.y.active())) {
+                throw runtime_error("connection was reset (too many retransmissions?)");
+            }
         }
 
         // time passes
-        x.tick(1000);
-        y.tick(1000);
+        const auto tick_start = high_resolution_clock::now();
+        for (auto &flow : flows) {
+            flow.x.tick(params.tick_ms);
+            flow.y.tick(params.tick_ms);
+        }
+        tick_time += high_resolution_clock::now() - tick_start;
+        ticks += 2 * flows.size();
     };
 
-    while (not y.inbound_stream().eof()) {
+    while (remaining > 0) {
         loop();
+        if (rss_during == 0) {
+            rss_during = resident_set_size();  // once every connection has been set up and has sent some data
+        }
     }
 
-    if (string_received != string_to_send) {
-        throw runtime_error("strings sent vs. received don't match");
+    const auto final_time = high_resolution_clock::now();
+
+    const auto any_active = [&] {
+        return any_of(flows.begin(), flows.end(), [](const FlowPair &f) { return f.x.active() or f.y.active(); });
+    };
+    while (any_active()) {
+        loop();
     }
 
-    const auto final_time = high_resolution_clock::now();
+    return {double(duration_cast<nanoseconds>(final_time - first_time).count()),
+            (double(rss_during) - double(rss_before)) / params.pairs,
+            double(tick_time.count()) / ticks,
+            flows.front().x.stats().write_latency};
+}
 
-    const auto duration = duration_cast<nanoseconds>(final_time - first_time).count();
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " [options]\n\n"
+         << "Measures the CPU-limited throughput of a transfer between two TCPConnections in memory.\n"
+         << "Options marked with * take a comma-separated list; every combination is run.\n\n"
 
-    const auto gigabits_per_second = len * 8.0 / double(duration);
+         << "   Option                                                          Default\n"
+         << "   --                                                              --\n\n"
 
-    cout << fixed << setprecision(2);
-    cout << "CPU-limited throughput" << (reorder ? " with reordering: " : "                : ") << gigabits_per_second
-         << " Gbit/s\n";
+         << "   -n <bytes>      Transfer <bytes> bytes                          " << DEFAULT_LEN << "\n"
+         << "   -T <trials>     Run each combination <trials> times             1\n"
+         << "   -f <format>     Output as text, csv or json                     text\n\n"
 
-    while (x.active() or y.active()) {
-        loop();
+         << " * -s <bytes>      Send capacity                                   " << TCPConfig::DEFAULT_CAPACITY << "\n"
+         << " * -r <bytes>      Receive capacity (window)                       " << TCPConfig::DEFAULT_CAPACITY << "\n"
+         << " * -m <bytes>      Maximum payload size (MSS)                      " << TCPConfig::MAX_PAYLOAD_SIZE << "\n"
+         << " * -t <ms>         Initial retransmission timeout                  " << TCPConfig::TIMEOUT_DFLT << "\n"
+         << " * -k <ms>         Time that passes per exchange of segments       " << DEFAULT_TICK_MS << "\n\n"
+
+         << " * -L <rate>       Drop each segment with probability <rate>       0\n"
+         << " * -R <rate>       Delay each segment with probability <rate>      0\n"
+         << " * -D <segments>   ... behind this many later segments             1\n"
+         << " * -d <rate>       Duplicate each segment with probability <rate>  0\n"
+         << " * -v <0|1>        Reverse each burst of data segments             0,1\n\n"
+
+         << " * -N <pairs>      Split the transfer over <pairs> pairs of        1\n"
+         << "                   connections, and report each one's memory\n"
+         << "                   use and tick() cost (for large <pairs>, use\n"
+         << "                   small -s and -r)\n"
+         << " * -w <bytes>      Write at most <bytes> per call to write(), and  (as much as fits)\n"
+         << "                   report the write-to-ACK latency (one pair only)\n\n"
+
+         << "   -h              Show this message and quit.\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
     }
+    cout << endl;
 }
 
-int main() {
+//! Parse a comma-separated list of numbers, each at least `least` (and, if `below` is nonzero, less than it)
+template <typename T>
+static vector<T> parse_list(const char *argv0,
+                            const char *option,
+                            const char *arg,
+                            const T least = 0,
+                            const T below = 0) {
+    vector<T> ret;
+    stringstream ss{arg};
+    string item;
+    while (getline(ss, item, ',')) {
+        char *end = nullptr;
+        const double value = strtod(item.c_str(), &end);
+        if (item.empty() or *end != '\0' or value < 0) {
+            show_usage(argv0, ("ERROR: bad value \"" + item + "\" for " + option).c_str());
+            exit(1);
+        }
+        if (static_cast<T>(value) < least or (below != 0 and static_cast<T>(value) >= below)) {
+            show_usage(argv0, ("ERROR: " + string{option} + " is out of range: \"" + item + "\"").c_str());
+            exit(1);
+        }
+        ret.push_back(static_cast<T>(value));
+    }
+    return ret;
+}
+
+static BenchmarkOptions get_options(int argc, char **argv) {
+    BenchmarkOptions options;
+    for (int curr = 1; curr < argc; curr += 2) {
+        const string option = argv[curr];
+        if (option == "-h") {
+            show_usage(argv[0], nullptr);
+            exit(0);
+        }
+        if (curr + 1 >= argc) {
+            show_usage(argv[0], ("ERROR: " + option + " requires one argument.").c_str());
+            exit(1);
+        }
+        const char *arg = argv[curr + 1];
+
+        if (option == "-n") {
+            options.len = strtoul(arg, nullptr, 0);
+        } else if (option == "-T") {
+            options.trials = max(1ul, strtoul(arg, nullptr, 0));
+        } else if (option == "-f") {
+            options.format = arg;
+            if (options.format != "text" and options.format != "csv" and options.format != "json") {
+                show_usage(argv[0], "ERROR: -f must be text, csv or json.");
+                exit(1);
+            }
+        } else if (option == "-s") {
+            options.send_capacity = parse_list<size_t>(argv[0], option.c_str(), arg, 1);
+        } else if (option == "-r") {
+            options.recv_capacity = parse_list<size_t>(argv[0], option.c_str(), arg, 1);
+        } else if (option == "-m") {
+            options.mss = parse_list<size_t>(argv[0], option.c_str(), arg, 1);
+        } else if (option == "-t") {
+            options.rt_timeout = parse_list<size_t>(argv[0], option.c_str(), arg);
+        } else if (option == "-k") {
+            options.tick_ms = parse_list<size_t>(argv[0], option.c_str(), arg, 1);
+        } else if (option == "-L") {
+            options.loss = parse_list<double>(argv[0], option.c_str(), arg, 0, 1);
+        } else if (option == "-R") {
+            options.reorder = parse_list<double>(argv[0], option.c_str(), arg);
+        } else if (option == "-D") {
+            options.reorder_distance = parse_list<size_t>(argv[0], option.c_str(), arg);
+        } else if (option == "-d") {
+            options.duplicate = parse_list<double>(argv[0], option.c_str(), arg);
+        } else if (option == "-N") {
+            options.pairs = parse_list<size_t>(argv[0], option.c_str(), arg, 1);
+        } else if (option == "-w") {
+            options.write_size = parse_list<size_t>(argv[0], option.c_str(), arg);
+        } else if (option == "-v") {
+            options.reverse.clear();
+            for (const auto value : parse_list<size_t>(argv[0], option.c_str(), arg)) {
+                options.reverse.push_back(value != 0);
+            }
+        } else {
+            show_usage(argv[0], ("ERROR: unrecognized option " + option).c_str());
+            exit(1);
+        }
+    }
+    return options;
+}
+
+//! Every combination of the swept options
+static vector<BenchmarkParams> sweep(const BenchmarkOptions &options) {
+    vector<BenchmarkParams> ret{BenchmarkParams{}};
+    const auto vary = [&ret](const auto &values, auto set) {
+        vector<BenchmarkParams> next;
+        for (const auto &params : ret) {
+            for (const auto value : values) {
+                next.push_back(params);
+                set(next.back(), value);
+            }
+        }
+        ret = move(next);
+    };
+    vary(options.send_capacity, [](BenchmarkParams &p, size_t v) { p.send_capacity = v; });
+    vary(options.recv_capacity, [](BenchmarkParams &p, size_t v) { p.recv_capacity = v; });
+    vary(options.mss, [](BenchmarkParams &p, size_t v) { p.mss = v; });
+    vary(options.rt_timeout, [](BenchmarkParams &p, size_t v) { p.rt_timeout = static_cast<uint16_t>(v); });
+    vary(options.tick_ms, [](BenchmarkParams &p, size_t v) { p.tick_ms = v; });
+    vary(options.loss, [](BenchmarkParams &p, double v) { p.loss = v; });
+    vary(options.reorder, [](BenchmarkParams &p, double v) { p.reorder = v; });
+    vary(options.reorder_distance, [](BenchmarkParams &p, size_t v) { p.reorder_distance = v; });
+    vary(options.duplicate, [](BenchmarkParams &p, double v) { p.duplicate = v; });
+    vary(options.reverse, [](BenchmarkParams &p, bool v) { p.reverse = v; });
+    vary(options.pairs, [](BenchmarkParams &p, size_t v) { p.pairs = v; });
+    vary(options.write_size, [](BenchmarkParams &p, size_t v) { p.write_size = v; });
+    return ret;
+}
+
+//! \returns the `q` quantile (0..1) of the sorted `values`
+static double quantile(const vector<double> &values, const double q) {
+    return values.at(min(values.size() - 1, static_cast<size_t>(q * values.size())));
+}
+
+//! \returns `ns` in microseconds, as a CSV or JSON field, or `missing` if `latency` measured nothing
+static string latency_field(const LatencyHistogram &latency, const uint64_t ns, const string &missing) {
+    if (latency.count() == 0) {
+        return missing;
+    }
+    stringstream ss;
+    ss << ns / 1e3;
+    return ss.str();
+}
+
+int main(int argc, char **argv) {
     try {
-        main_loop(false);
-        main_loop(true);
+        const BenchmarkOptions options = get_options(argc, argv);
+
+        string data(options.len, 'x');
+        for (auto &ch : data) {
+            ch = rand();
+        }
+
+        if (options.format == "csv") {
+            cout << "bytes,send_capacity,recv_capacity,mss,rt_timeout,tick_ms,loss,reorder,reorder_distance,duplicate,"
+                    "reverse,pairs,write_size,trials,median_gbps,p99_gbps,rss_per_pair,tick_ns,latency_p50_us,"
+                    "latency_p99_us,latency_p999_us,latency_max_us\n";
+        } else if (options.format == "json") {
+            cout << "[";
+        }
+
+        bool first = true;
+        for (const auto &params : sweep(options)) {
+            // every pair transfers the same number of bytes
+            const size_t bytes = max(size_t{1}, options.len / params.pairs) * params.pairs;
+
+            vector<double> durations;
+            vector<double> rss_per_pair;
+            vector<double> tick_ns;
+            LatencyHistogram latency;
+            for (unsigned int trial = 0; trial < options.trials; ++trial) {
+                const TrialResult result = run_trial(params, data, 2 * trial);
+                durations.push_back(result.duration_ns);
+                rss_per_pair.push_back(result.rss_per_pair);
+                tick_ns.push_back(result.tick_ns_per_connection);
+                latency.merge(result.latency);
+            }
+            sort(durations.begin(), durations.end());
+            sort(rss_per_pair.begin(), rss_per_pair.end());
+            sort(tick_ns.begin(), tick_ns.end());
+
+            // the p99 throughput is the one reached by all but the slowest 1% of trials
+            const double median_gbps = bytes * 8.0 / quantile(durations, 0.5);
+            const double p99_gbps = bytes * 8.0 / quantile(durations, 0.99);
+            const double median_rss = quantile(rss_per_pair, 0.5);
+            const double median_tick_ns = quantile(tick_ns, 0.5);
+            // rows with several pairs don't measure latency, which is left empty (CSV) or null (JSON)
+            const string missing = options.format == "json" ? "null" : "";
+            const string p50_us = latency_field(latency, latency.percentile(50), missing);
+            const string p99_us = latency_field(latency, latency.percentile(99), missing);
+            const string p999_us = latency_field(latency, latency.percentile(99.9), missing);
+            const string max_us = latency_field(latency, latency.max(), missing);
+
+            if (options.format == "csv") {
+                cout << bytes << "," << params.send_capacity << "," << params.recv_capacity << "," << params.mss
+                     << "," << params.rt_timeout << "," << params.tick_ms << "," << params.loss << ","
+                     << params.reorder << "," << params.reorder_distance << "," << params.duplicate << ","
+                     << params.reverse << "," << params.pairs << "," << params.write_size << "," << options.trials
+                     << "," << median_gbps << "," << p99_gbps << "," << median_rss << "," << median_tick_ns << ","
+                     << p50_us << "," << p99_us << "," << p999_us << "," << max_us << "\n";
+            } else if (options.format == "json") {
+                cout << (first ? "\n" : ",\n") << "  {\"bytes\": " << bytes
+                     << ", \"send_capacity\": " << params.send_capacity
+                     << ", \"recv_capacity\": " << params.recv_capacity << ", \"mss\": " << params.mss
+                     << ", \"rt_timeout\": " << params.rt_timeout << ", \"tick_ms\": " << params.tick_ms
+                     << ", \"loss\": " << params.loss << ", \"reorder\": " << params.reorder
+                     << ", \"reorder_distance\": " << params.reorder_distance << ", \"duplicate\": " << params.duplicate
+                     << ", \"reverse\": " << (params.reverse ? "true" : "false") << ", \"pairs\": " << params.pairs
+                     << ", \"write_size\": " << params.write_size << ", \"trials\": " << options.trials
+                     << ", \"median_gbps\": " << median_gbps << ", \"p99_gbps\": " << p99_gbps
+                     << ", \"rss_per_pair\": " << median_rss << ", \"tick_ns\": " << median_tick_ns
+                     << ", \"latency_p50_us\": " << p50_us << ", \"latency_p99_us\": " << p99_us
+                     << ", \"latency_p999_us\": " << p999_us << ", \"latency_max_us\": " << max_us << "}";
+            } else {
+                cout << fixed << setprecision(2);
+                cout << "CPU-limited throughput" << (params.reverse ? " with reordering: " : "                : ")
+                     << median_gbps << " Gbit/s";
+                if (options.trials > 1) {
+                    cout << " (p99 " << p99_gbps << " Gbit/s)";
+                }
+                cout << "  [mss=" << params.mss << " wnd=" << params.recv_capacity << " sndbuf=" << params.send_capacity
+                     << " rto=" << params.rt_timeout << " tick=" << params.tick_ms << " loss=" << params.loss
+                     << " reorder=" << params.reorder << "/" << params.reorder_distance << " dup=" << params.duplicate;
+                if (params.pairs > 1) {
+                    cout << " pairs=" << params.pairs << " rss/pair=" << setprecision(0) << median_rss
+                         << "B tick=" << setprecision(1) << median_tick_ns << "ns/conn";
+                }
+                if (params.write_size > 0) {
+                    cout << " wsize=" << params.write_size;
+                }
+                cout << "]\n";
+                if (latency.count() > 0) {
+                    cout << "    write-to-ACK latency: " << latency.summary() << "\n";
+                }
+            }
+            first = false;
+        }
+
+        if (options.format == "json") {
+            cout << "\n]\n";
+        }
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
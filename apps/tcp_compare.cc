@@ -0,0 +1,503 @@
+#include "latency_histogram.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_sponge_socket.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Runs the same workloads over loopback through the kernel's TCP, sponge over UDP (a TCPSpongeSocket,
+// as in tcp_udp) and an in-process pair of TCPConnections, and reports them side by side:
+//  * bulk: the client sends a stream of bytes and closes, and the server reads it all;
+//  * rr: the client sends a request and waits for the server's response, over and over.
+// The CPU time is that of the whole process: both endpoints, and any threads that carry them.
+
+constexpr size_t DEFAULT_BULK_BYTES = 32 * 1024 * 1024;
+constexpr size_t DEFAULT_REQUESTS = 10000;
+constexpr size_t DEFAULT_REQUEST_SIZE = 64;
+constexpr size_t DEFAULT_RESPONSE_SIZE = 4096;
+constexpr uint16_t DEFAULT_RT_TIMEOUT = 200;  // Linux's minimum RTO; sponge lingers for ten of these after a close
+constexpr size_t CHUNK_SIZE = 65536;          // Largest write (and read) in the bulk workload
+
+//! How to run the comparison
+struct CompareOptions {
+    size_t bulk_bytes = DEFAULT_BULK_BYTES;
+    size_t requests = DEFAULT_REQUESTS;
+    size_t request_size = DEFAULT_REQUEST_SIZE;
+    size_t response_size = DEFAULT_RESPONSE_SIZE;
+    vector<string> transports{"kernel", "udp", "pair"};
+    vector<string> workloads{"bulk", "rr"};
+    string format = "text";
+    TCPConfig tcp{};
+};
+
+//! What one workload measured over one transport
+struct Measurement {
+    double seconds{0};           //!< Wall-clock time
+    double cpu_seconds{0};       //!< User and system time of the process
+    uint64_t bytes{0};           //!< Bytes carried, both ways
+    uint64_t transactions{0};    //!< Requests answered (rr only)
+    LatencyHistogram latency{};  //!< Time from each request to its whole response (rr only), in ns
+};
+
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " [options]\n\n"
+         << "Runs identical workloads over loopback through the kernel's TCP, sponge over UDP and an\n"
+         << "in-process pair of TCPConnections, and compares their throughput, CPU and latency.\n\n"
+
+         << "   Option                                                          Default\n"
+         << "   --                                                              --\n\n"
+
+         << "   -X <list>       Transports: kernel, udp, pair                   kernel,udp,pair\n"
+         << "   -W <list>       Workloads: bulk, rr (request/response)          bulk,rr\n"
+         << "   -n <bytes>      Bytes to send in bulk                           " << DEFAULT_BULK_BYTES << "\n"
+         << "   -q <requests>   Requests to make in rr                          " << DEFAULT_REQUESTS << "\n"
+         << "   -R <bytes>      Size of a request                               " << DEFAULT_REQUEST_SIZE << "\n"
+         << "   -S <bytes>      Size of a response                              " << DEFAULT_RESPONSE_SIZE << "\n"
+         << "   -w <bytes>      Sponge's window (send and receive capacity)     " << TCPConfig::DEFAULT_CAPACITY << "\n"
+         << "   -m <bytes>      Sponge's maximum payload size (MSS)             " << TCPConfig::MAX_PAYLOAD_SIZE << "\n"
+         << "   -t <ms>         Sponge's initial retransmission timeout         " << DEFAULT_RT_TIMEOUT << "\n"
+         << "   -f <format>     Output as text or csv                           text\n\n"
+
+         << "   -h              Show this message and quit.\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
+    }
+    cout << endl;
+}
+
+//! Split a comma-separated list, and check that every item is in `allowed`
+static vector<string> parse_list(const char *argv0, const string &option, const string &arg, vector<string> allowed) {
+    vector<string> items;
+    stringstream ss{arg};
+    string item;
+    while (getline(ss, item, ',')) {
+        if (find(allowed.begin(), allowed.end(), item) == allowed.end()) {
+            show_usage(argv0, ("ERROR: bad value \"" + item + "\" for " + option).c_str());
+            exit(1);
+        }
+        items.push_back(item);
+    }
+    return items;
+}
+
+//! Parse a number that must be at least 1 and at most `most` (the largest value the field it's for can hold)
+static size_t parse_number(const char *argv0, const string &option, const char *arg, const size_t most) {
+    char *end = nullptr;
+    errno = 0;
+    const unsigned long long value = strtoull(arg, &end, 0);
+    if (*arg == '\0' or *end != '\0' or *arg == '-' or errno == ERANGE) {
+        show_usage(argv0, ("ERROR: bad value \"" + string{arg} + "\" for " + option).c_str());
+        exit(1);
+    }
+    if (value < 1 or value > most) {
+        show_usage(argv0, ("ERROR: " + option + " is out of range: \"" + string{arg} + "\"").c_str());
+        exit(1);
+    }
+    return value;
+}
+
+static CompareOptions get_options(int argc, char **argv) {
+    CompareOptions options;
+    options.tcp.rt_timeout = DEFAULT_RT_TIMEOUT;
+    for (int curr = 1; curr < argc; curr += 2) {
+        const string option = argv[curr];
+        if (option == "-h") {
+            show_usage(argv[0], nullptr);
+            exit(0);
+        }
+        if (curr + 1 >= argc) {
+            show_usage(argv[0], ("ERROR: " + option + " requires one argument.").c_str());
+            exit(1);
+        }
+        const char *arg = argv[curr + 1];
+
+        if (option == "-X") {
+            options.transports = parse_list(argv[0], option, arg, {"kernel", "udp", "pair"});
+            // the kernel goes first, as the baseline that the others are compared with
+            stable_partition(options.transports.begin(), options.transports.end(), [](const string &transport) {
+                return transport == "kernel";
+            });
+        } else if (option == "-W") {
+            options.workloads = parse_list(argv[0], option, arg, {"bulk", "rr"});
+        } else if (option == "-n") {
+            options.bulk_bytes = strtoul(arg, nullptr, 0);
+        } else if (option == "-q") {
+            options.requests = strtoul(arg, nullptr, 0);
+        } else if (option == "-R") {
+            options.request_size = max(1ul, strtoul(arg, nullptr, 0));
+        } else if (option == "-S") {
+            options.response_size = max(1ul, strtoul(arg, nullptr, 0));
+        } else if (option == "-w") {
+            options.tcp.send_capacity = options.tcp.recv_capacity =
+                parse_number(argv[0], option, arg, numeric_limits<size_t>::max());
+        } else if (option == "-m") {
+            options.tcp.max_payload_size = parse_number(argv[0], option, arg, numeric_limits<size_t>::max());
+        } else if (option == "-t") {
+            options.tcp.rt_timeout = parse_number(argv[0], option, arg, numeric_limits<uint16_t>::max());
+        } else if (option == "-f") {
+            options.format = arg;
+            if (options.format != "text" and options.format != "csv") {
+                show_usage(argv[0], "ERROR: -f must be text or csv.");
+                exit(1);
+            }
+        } else {
+            show_usage(argv[0], ("ERROR: unrecognized option " + option).c_str());
+            exit(1);
+        }
+    }
+    return options;
+}
+
+//! \returns the user and system time used so far by every thread of this process, in seconds
+static double cpu_seconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    const auto seconds = [](const timeval &tv) { return tv.tv_sec + tv.tv_usec / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+//! Read exactly `length` bytes into `buffer` (which has room for them)
+static void read_exactly(Socket &socket, char *buffer, const size_t length) {
+    for (size_t done = 0; done < length;) {
+        const size_t n = socket.read(buffer + done, length - done);
+        if (n == 0) {
+            throw runtime_error("the stream ended early");
+        }
+        done += n;
+    }
+}
+
+//! \brief The server's side of `workload`, which ends when the client closes
+//! \returns the number of bytes read
+static uint64_t serve(Socket &socket, const string &workload, const CompareOptions &options) {
+    uint64_t received = 0;
+    if (workload == "bulk") {
+        string buffer(CHUNK_SIZE, 0);
+        for (size_t n; (n = socket.read(buffer.data(), buffer.size())) > 0;) {
+            received += n;
+        }
+    } else {
+        string request(options.request_size, 0);
+        const string response(options.response_size, 'r');
+        while (true) {
+            const size_t n = socket.read(request.data(), request.size());
+            if (n == 0) {
+                break;
+            }
+            read_exactly(socket, request.data() + n, request.size() - n);
+            received += request.size();
+            socket.write(response);
+        }
+    }
+    socket.shutdown(SHUT_WR);
+    return received;
+}
+
+//! The client's side of `workload`, timed from its first write until the server has closed
+static Measurement drive(Socket &socket, const string &workload, const CompareOptions &options) {
+    Measurement result;
+    string buffer(max(CHUNK_SIZE, options.response_size), 0);
+    const double cpu_start = cpu_seconds();
+    const auto start = steady_clock::now();
+
+    if (workload == "bulk") {
+        const string chunk(CHUNK_SIZE, 'b');
+        for (size_t sent = 0; sent < options.bulk_bytes;) {
+            const size_t length = min(chunk.size(), options.bulk_bytes - sent);
+            sent += socket.write(string_view{chunk.data(), length});
+        }
+        result.bytes = options.bulk_bytes;
+    } else {
+        const string request(options.request_size, 'q');
+        for (size_t i = 0; i < options.requests; ++i) {
+            const auto sent = steady_clock::now();
+            socket.write(request);
+            read_exactly(socket, buffer.data(), options.response_size);
+            result.latency.record(duration_cast<nanoseconds>(steady_clock::now() - sent).count());
+        }
+        result.transactions = options.requests;
+        result.bytes = options.requests * (options.request_size + options.response_size);
+    }
+    socket.shutdown(SHUT_WR);
+    while (socket.read(buffer.data(), buffer.size()) > 0) {
+    }
+
+    result.seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    result.cpu_seconds = cpu_seconds() - cpu_start;
+    return result;
+}
+
+//! Run `workload` between two connected sockets, serving it from another thread
+static Measurement run_over_sockets(Socket &client, Socket &server, const string &workload,
+                                    const CompareOptions &options) {
+    exception_ptr server_error;
+    uint64_t received = 0;
+    thread server_thread([&] {
+        try {
+            received = serve(server, workload, options);
+        } catch (...) {
+            server_error = current_exception();
+        }
+    });
+
+    Measurement result;
+    try {
+        result = drive(client, workload, options);
+    } catch (...) {
+        server.shutdown(SHUT_RDWR);  // wake up the server
+        server_thread.join();
+        throw;
+    }
+    server_thread.join();
+    if (server_error) {
+        rethrow_exception(server_error);
+    }
+    const uint64_t expected = workload == "bulk" ? options.bulk_bytes : options.requests * options.request_size;
+    if (received != expected) {
+        throw runtime_error("the server read " + to_string(received) + " bytes instead of " + to_string(expected));
+    }
+    return result;
+}
+
+//! The kernel's TCP, over loopback
+static Measurement over_kernel(const string &workload, const CompareOptions &options) {
+    TCPSocket listener;
+    listener.bind({"127.0.0.1", 0});
+    listener.listen();
+    TCPSocket client;
+    client.connect(listener.local_address());
+    TCPSocket server = listener.accept();
+    return run_over_sockets(client, server, workload, options);
+}
+
+//! Sponge over UDP, over loopback: two TCPSpongeSockets, as between two instances of tcp_udp
+static Measurement over_udp(const string &workload, const CompareOptions &options) {
+    UDPSocket server_udp;
+    server_udp.bind({"127.0.0.1", 0});
+    FdAdapterConfig server_config;
+    server_config.source = server_udp.local_address();
+    FdAdapterConfig client_config;
+    client_config.destination = server_config.source;
+
+    TCPOverUDPSpongeSocket server{TCPOverUDPSocketAdapter{move(server_udp)}};
+    TCPOverUDPSpongeSocket client{TCPOverUDPSocketAdapter{UDPSocket{}}};
+    exception_ptr accept_error;
+    thread accept_thread([&] {
+        try {
+            server.listen_and_accept(options.tcp, server_config);
+        } catch (...) {
+            accept_error = current_exception();
+        }
+    });
+    client.connect(options.tcp, client_config);
+    accept_thread.join();
+    if (accept_error) {
+        rethrow_exception(accept_error);
+    }
+
+    const Measurement result = run_over_sockets(client, server, workload, options);
+    server.wait_until_closed();
+    client.wait_until_closed();
+    return result;
+}
+
+//! \brief Deliver the segments that `a` and `b` have queued for each other, in one round each way
+//! \returns `true` if there were any
+static bool exchange(TCPConnection &a, TCPConnection &b, vector<TCPSegment> &segments) {
+    bool moved = false;
+    for (auto [from, to] : {pair{&a, &b}, pair{&b, &a}}) {
+        if (from->drain_segments(segments) > 0) {
+            moved = true;
+            for (const auto &seg : segments) {
+                to->segment_received(seg);
+            }
+            segments.clear();
+        }
+    }
+    return moved;
+}
+
+//! \returns the number of bytes read (and discarded) from `stream`
+static size_t drain(ByteStream &stream) {
+    const size_t size = stream.buffer_size();
+    stream.pop_output(size);
+    return size;
+}
+
+//! \brief Two TCPConnections in this thread, handing each other their segments directly
+//! \details Each application reads what has arrived between rounds of exchange(), as it would between
+//! segments: nothing ticks the connections, so a closed window would never be probed again.
+static Measurement in_process(const string &workload, const CompareOptions &options) {
+    TCPConnection client{options.tcp}, server{options.tcp};
+    vector<TCPSegment> segments;
+    Measurement result;
+    uint64_t received = 0;
+    const auto stalled = [] { return runtime_error("the in-process connections stalled"); };
+
+    // the server closes once it has read the client's whole stream
+    const auto serve_close = [&] {
+        received += drain(server.inbound_stream());
+        if (server.inbound_stream().eof() and not server.outbound_stream().input_ended()) {
+            server.end_input_stream();
+        }
+    };
+
+    const double cpu_start = cpu_seconds();
+    const auto start = steady_clock::now();
+
+    client.connect();
+    if (workload == "bulk") {
+        const string chunk(CHUNK_SIZE, 'b');
+        size_t sent = 0;
+        while (not client.inbound_stream().eof()) {
+            while (sent < options.bulk_bytes and client.remaining_outbound_capacity() > 0) {
+                const size_t length = min(chunk.size(), options.bulk_bytes - sent);
+                sent += client.write(string_view{chunk.data(), length});
+            }
+            if (sent == options.bulk_bytes and not client.outbound_stream().input_ended()) {
+                client.end_input_stream();
+            }
+            serve_close();
+            if (not exchange(client, server, segments)) {
+                throw stalled();
+            }
+        }
+        result.bytes = options.bulk_bytes;
+    } else {
+        const string request(options.request_size, 'q');
+        const string response(options.response_size, 'r');
+        for (size_t i = 0; i < options.requests; ++i) {
+            const auto sent = steady_clock::now();
+            size_t request_left = request.size(), request_read = 0, response_left = 0, response_read = 0;
+            while (true) {
+                request_left -= client.write(string_view{request.data(), request_left});
+                request_read += drain(server.inbound_stream());
+                if (request_read == request.size()) {
+                    request_read = 0;
+                    response_left = response.size();
+                }
+                response_left -= server.write(string_view{response.data(), response_left});
+                response_read += drain(client.inbound_stream());
+                if (response_read == response.size()) {
+                    break;
+                }
+                if (not exchange(client, server, segments)) {
+                    throw stalled();
+                }
+            }
+            received += request.size();
+            result.latency.record(duration_cast<nanoseconds>(steady_clock::now() - sent).count());
+        }
+        client.end_input_stream();
+        do {
+            serve_close();
+        } while (exchange(client, server, segments));
+        result.transactions = options.requests;
+        result.bytes = options.requests * (options.request_size + options.response_size);
+    }
+
+    result.seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+    result.cpu_seconds = cpu_seconds() - cpu_start;
+
+    // deliver the last ACKs, and let the client (which closed first) linger, so that neither ends uncleanly
+    while (exchange(client, server, segments)) {
+    }
+    client.tick(10 * options.tcp.rt_timeout);
+    if (client.active() or server.active()) {
+        throw runtime_error("the in-process connections didn't close cleanly");
+    }
+    const uint64_t expected = workload == "bulk" ? options.bulk_bytes : options.requests * options.request_size;
+    if (received != expected) {
+        throw runtime_error("the server read " + to_string(received) + " bytes instead of " + to_string(expected));
+    }
+    return result;
+}
+
+static string transport_name(const string &transport) {
+    return transport == "kernel" ? "kernel" : transport == "udp" ? "sponge-udp" : "sponge-pair";
+}
+
+int main(int argc, char **argv) {
+    try {
+        const CompareOptions options = get_options(argc, argv);
+
+        if (options.format == "csv") {
+            cout << "workload,transport,seconds,gbps,transactions_per_s,cpu_ns_per_byte,p50_us,p99_us,p999_us,"
+                    "vs_kernel\n";
+        }
+
+        for (const auto &workload : options.workloads) {
+            if (options.format == "text") {
+                cout << "\n";
+                if (workload == "bulk") {
+                    cout << "bulk: " << options.bulk_bytes << " bytes\n";
+                } else {
+                    cout << "rr: " << options.requests << " requests of " << options.request_size
+                         << " bytes, each answered with " << options.response_size << " bytes\n";
+                }
+                cout << "  transport        Gbit/s     trans/s   CPU ns/B     p50 us     p99 us   p99.9 us"
+                     << "   vs kernel\n";
+            }
+
+            optional<double> kernel_gbps;  // (the kernel, if it is run, is run first)
+            for (const auto &transport : options.transports) {
+                const Measurement m = transport == "kernel" ? over_kernel(workload, options)
+                                      : transport == "udp"  ? over_udp(workload, options)
+                                                            : in_process(workload, options);
+                const double gbps = m.bytes * 8 / m.seconds / 1e9;
+                const double cpu_ns_per_byte = m.cpu_seconds * 1e9 / m.bytes;
+                if (transport == "kernel") {
+                    kernel_gbps = gbps;
+                }
+                const bool rr = workload == "rr";
+                const auto us = [&](const double percent) { return m.latency.percentile(percent) / 1e3; };
+
+                if (options.format == "csv") {
+                    cout << workload << "," << transport_name(transport) << "," << m.seconds << "," << gbps << ","
+                         << (rr ? to_string(m.transactions / m.seconds) : "") << "," << cpu_ns_per_byte << ","
+                         << (rr ? to_string(us(50)) : "") << "," << (rr ? to_string(us(99)) : "") << ","
+                         << (rr ? to_string(us(99.9)) : "") << ","
+                         << (kernel_gbps ? to_string(gbps / kernel_gbps.value()) : "") << "\n";
+                    continue;
+                }
+
+                cout << fixed << setprecision(2) << "  " << left << setw(13) << transport_name(transport) << right
+                     << setw(10) << gbps;
+                if (rr) {
+                    cout << setw(12) << setprecision(0) << m.transactions / m.seconds << setprecision(2) << setw(11)
+                         << cpu_ns_per_byte << setprecision(1) << setw(11) << us(50) << setw(11) << us(99)
+                         << setw(11) << us(99.9);
+                } else {
+                    cout << setw(12) << "-" << setw(11) << cpu_ns_per_byte << setw(11) << "-" << setw(11) << "-"
+                         << setw(11) << "-";
+                }
+                if (kernel_gbps) {
+                    cout << setprecision(3) << setw(11) << gbps / kernel_gbps.value() << "x";
+                }
+                cout << endl;
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
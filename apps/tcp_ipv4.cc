@@ -1,6 +1,7 @@
 #include "bidirectional_stream_copy.hh"
 #include "tcp_config.hh"
 #include "tcp_sponge_socket.hh"
+#include "tcp_trace.hh"
 #include "tun.hh"
 
 #include <cstdint>
@@ -37,6 +38,9 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -T <file>       Write a binary trace of the connection to       (no trace)\n"
+         << "                   <file> (see trace_convert)\n\n"
+
          << "   -h              Show this message.\n\n";
 
     if (msg != nullptr) {
@@ -52,13 +56,14 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, bool, char *, string> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
     char *tundev = nullptr;
 
     int curr = 1;
     bool listen = false;
+    string trace_path;
 
     string source_address = LOCAL_ADDRESS_DFLT;
     string source_port = to_string(uint16_t(random_device()()));
@@ -109,6 +114,11 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-T", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -T requires one argument.");
+            trace_path = argv[curr + 1];
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -131,7 +141,7 @@ static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char
         c_filt.source = {source_address, source_port};
     }
 
-    return make_tuple(c_fsm, c_filt, listen, tundev);
+    return make_tuple(c_fsm, c_filt, listen, tundev, trace_path);
 }
 
 int main(int argc, char **argv) {
@@ -141,7 +151,10 @@ int main(int argc, char **argv) {
             return EXIT_FAILURE;
         }
 
-        auto [c_fsm, c_filt, listen, tun_dev_name] = get_config(argc, argv);
+        auto [c_fsm, c_filt, listen, tun_dev_name, trace_path] = get_config(argc, argv);
+        if (not trace_path.empty()) {
+            Tracer::start(trace_path);
+        }
         LossyTCPOverIPv4SpongeSocket tcp_socket(LossyTCPOverIPv4OverTunFdAdapter(
             TCPOverIPv4OverTunFdAdapter(TunFD(tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name))));
 
@@ -153,6 +166,13 @@ int main(int argc, char **argv) {
 
         bidirectional_stream_copy(tcp_socket);
         tcp_socket.wait_until_closed();
+
+        if (not trace_path.empty()) {
+            const uint64_t dropped = Tracer::stop();
+            if (dropped > 0) {
+                cerr << "DEBUG: " << dropped << " trace events were dropped (rings full).\n";
+            }
+        }
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
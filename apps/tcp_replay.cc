@@ -0,0 +1,418 @@
+#include "latency_histogram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_receiver.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <pcap/pcap.h>
+#include <string>
+#include <sys/socket.h>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+// Replays the segments of one direction of a captured TCP flow into a TCPReceiver (or, with -c, a
+// TCPConnection), as fast as it will take them, to measure what real loss and reordering cost.
+// The capture is read whole before the clock starts, so only segment_received() is timed.
+
+constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+constexpr unsigned int DEFAULT_RUNS = 10;
+
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " [options] <capture>\n\n"
+         << "Replays one direction of a TCP flow, from a pcap or pcapng capture, into a TCPReceiver.\n"
+         << "Payloads cut short by the capture's snaplen (or missing, as in the captures written by\n"
+         << "trace_convert) are replayed as zeros.\n\n"
+
+         << "   Option                                                          Default\n"
+         << "   --                                                              --\n\n"
+
+         << "   -p <port>       Replay the segments sent from <port>            (the direction\n"
+         << "                                                                   with most payload)\n"
+         << "   -u              The capture is of TCP over UDP (as by tcp_udp)  TCP over IP\n"
+         << "   -c              Replay into a TCPConnection, which also ACKs    TCPReceiver\n"
+         << "   -w <bytes>      Receive capacity                                " << DEFAULT_CAPACITY << "\n"
+         << "   -r <runs>       Replay <runs> times (untimed per segment)       " << DEFAULT_RUNS << "\n\n"
+
+         << "   -h              Show this message and quit.\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
+    }
+    cout << endl;
+}
+
+//! How to replay
+struct ReplayOptions {
+    optional<uint16_t> port{};
+    bool over_udp{false};
+    bool connection{false};
+    size_t capacity{DEFAULT_CAPACITY};
+    unsigned int runs{DEFAULT_RUNS};
+    string capture{};
+};
+
+static ReplayOptions get_options(int argc, char **argv) {
+    ReplayOptions options;
+    int curr = 1;
+    for (; curr < argc; ++curr) {
+        const string option = argv[curr];
+        if (option == "-h") {
+            show_usage(argv[0], nullptr);
+            exit(0);
+        } else if (option == "-u") {
+            options.over_udp = true;
+            continue;
+        } else if (option == "-c") {
+            options.connection = true;
+            continue;
+        } else if (option.empty() or option[0] != '-') {
+            break;
+        }
+
+        if (curr + 1 >= argc) {
+            show_usage(argv[0], ("ERROR: " + option + " requires one argument.").c_str());
+            exit(1);
+        }
+        const char *arg = argv[++curr];
+        if (option == "-p") {
+            options.port = strtoul(arg, nullptr, 0);
+        } else if (option == "-w") {
+            options.capacity = strtoul(arg, nullptr, 0);
+        } else if (option == "-r") {
+            options.runs = max(1ul, strtoul(arg, nullptr, 0));
+        } else {
+            show_usage(argv[0], ("ERROR: unrecognized option " + option).c_str());
+            exit(1);
+        }
+    }
+
+    if (curr + 1 != argc) {
+        show_usage(argv[0], "ERROR: expected one capture file.");
+        exit(1);
+    }
+    options.capture = argv[curr];
+    return options;
+}
+
+//! The segments sent in one direction of a flow
+struct Direction {
+    string name{};
+    vector<TCPSegment> segments{};
+    size_t payload_bytes{0};
+};
+
+//! \returns the length of the link-layer header of a captured packet, or empty if it isn't IP
+static optional<size_t> link_header_length(const int dl_type, const uint8_t *data, const size_t caplen) {
+    if (dl_type == DLT_RAW) {
+        return 0;
+    }
+    if (dl_type == DLT_NULL) {
+        if (caplen < 4) {
+            return {};
+        }
+        const uint8_t pt = data[3];
+        return (pt == 2 or pt == 24 or pt == 28 or pt == 30) ? optional<size_t>{4} : nullopt;
+    }
+    size_t length = 0;
+    size_t type_offset = 0;
+    if (dl_type == DLT_EN10MB) {
+        length = 14;
+        type_offset = 12;
+    } else if (dl_type == DLT_LINUX_SLL) {
+        length = 16;
+        type_offset = 14;
+#ifdef DLT_LINUX_SLL2
+    } else if (dl_type == DLT_LINUX_SLL2) {
+        length = 20;
+        type_offset = 0;
+#endif
+    } else {
+        throw runtime_error("unsupported datalink type " + string(pcap_datalink_val_to_description(dl_type)));
+    }
+    if (caplen < length) {
+        return {};
+    }
+    const uint16_t pt = (data[type_offset] << 8) | data[type_offset + 1];
+    return (pt == 0x0800 or pt == 0x86dd) ? optional<size_t>{length} : nullopt;
+}
+
+static string address(const int family, const uint8_t *data) {
+    char addrbuf[INET6_ADDRSTRLEN];
+    if (inet_ntop(family, data, static_cast<char *>(addrbuf), sizeof(addrbuf)) == nullptr) {
+        return "unknown";
+    }
+    return string(static_cast<char *>(addrbuf));
+}
+
+//! \brief Find the TCP segment in an IPv4 or IPv6 packet
+//! \param[out] src and `dst` are set to the packet's addresses
+//! \returns the segment's offset and its length (according to the IP header), or empty if there is none
+static optional<pair<size_t, size_t>> find_segment(
+    const uint8_t *data, const size_t caplen, const bool over_udp, string &src, string &dst) {
+    const uint8_t protocol = over_udp ? 17 : 6;
+    if (caplen < 1) {
+        return {};
+    }
+    size_t offset = 0;
+    size_t end = 0;
+    if ((data[0] & 0xf0) == 0x40) {
+        offset = (data[0] & 0x0f) * 4;
+        if (caplen < 20 or data[9] != protocol) {
+            return {};
+        }
+        end = (data[2] << 8) | data[3];
+        src = address(AF_INET, data + 12);
+        dst = address(AF_INET, data + 16);
+    } else if ((data[0] & 0xf0) == 0x60) {
+        if (caplen < 40) {
+            return {};
+        }
+        offset = 40;
+        end = 40 + ((data[4] << 8) | data[5]);
+        uint8_t next = data[6];
+        while (next != protocol) {
+            if ((next != 0 and next != 43 and next != 60) or caplen < offset + 2) {
+                return {};  // another protocol, or a fragment
+            }
+            next = data[offset];
+            offset += 8 * (1 + data[offset + 1]);
+        }
+        src = address(AF_INET6, data + 8);
+        dst = address(AF_INET6, data + 24);
+    } else {
+        return {};
+    }
+
+    if (over_udp) {
+        offset += 8;
+    }
+    if (end < offset + TCPHeader::LENGTH or caplen < offset + TCPHeader::LENGTH) {
+        return {};
+    }
+    return {{offset, end - offset}};
+}
+
+//! Read every TCP segment in the capture, by direction
+static map<string, Direction> read_capture(const ReplayOptions &options) {
+    char errbuf[PCAP_ERRBUF_SIZE] = {
+        0,
+    };
+    pcap_t *pcap = pcap_open_offline(options.capture.c_str(), static_cast<char *>(errbuf));
+    if (pcap == nullptr) {
+        throw runtime_error("couldn't open " + options.capture + ": " + static_cast<char *>(errbuf));
+    }
+    const int dl_type = pcap_datalink(pcap);
+
+    map<string, Direction> directions;
+    size_t skipped = 0;
+    struct pcap_pkthdr *hdr = nullptr;
+    const uint8_t *pkt = nullptr;
+    int ret = 0;
+    try {
+        while ((ret = pcap_next_ex(pcap, &hdr, &pkt)) == 1) {
+            const optional<size_t> link_length = link_header_length(dl_type, pkt, hdr->caplen);
+            string src, dst;
+            optional<pair<size_t, size_t>> found;
+            if (link_length) {
+                const size_t length = link_length.value();
+                found = find_segment(pkt + length, hdr->caplen - length, options.over_udp, src, dst);
+            }
+            if (not found) {
+                ++skipped;
+                continue;
+            }
+
+            // what the capture cut off is replayed as zeros, and what follows the packet is dropped
+            const size_t offset = link_length.value() + found->first;
+            string raw(reinterpret_cast<const char *>(pkt) + offset, min(size_t{hdr->caplen} - offset, found->second));
+            raw.resize(found->second, 0);
+
+            TCPSegment seg;
+            // checksums aren't checked: they are often offloaded, and the payload may have been cut off
+            if (seg.parse_unchecked(Buffer(move(raw))) != ParseResult::NoError) {
+                ++skipped;
+                continue;
+            }
+            const string name = src + ":" + to_string(seg.header().sport) + " > " + dst + ":" +
+                                to_string(seg.header().dport);
+            Direction &direction = directions[name];
+            direction.name = name;
+            direction.payload_bytes += seg.payload().size();
+            direction.segments.push_back(move(seg));
+        }
+    } catch (...) {
+        pcap_close(pcap);
+        throw;
+    }
+    if (ret == -1) {
+        const string error = pcap_geterr(pcap);
+        pcap_close(pcap);
+        throw runtime_error("error reading " + options.capture + ": " + error);
+    }
+    pcap_close(pcap);
+
+    if (skipped > 0) {
+        cerr << "Skipped " << skipped << " packet(s) that weren't " << (options.over_udp ? "TCP over UDP" : "TCP")
+             << ".\n";
+    }
+    return directions;
+}
+
+//! Choose the direction to replay: the one from `port`, or else the one that carried the most payload
+static const Direction &choose(const map<string, Direction> &directions, const optional<uint16_t> port) {
+    const Direction *chosen = nullptr;
+    for (const auto &[name, direction] : directions) {
+        if (port and direction.segments.front().header().sport != port.value()) {
+            continue;
+        }
+        if (chosen == nullptr or direction.payload_bytes > chosen->payload_bytes) {
+            chosen = &direction;
+        }
+    }
+    if (chosen == nullptr) {
+        throw runtime_error("no TCP segments to replay");
+    }
+    return *chosen;
+}
+
+//! \brief The segments to replay, starting with a SYN (made up, if the capture starts later)
+//! \details The segments before the SYN (if any) are dropped, as a receiver would drop them.
+static vector<TCPSegment> replay_segments(const Direction &direction) {
+    const auto syn = find_if(direction.segments.begin(), direction.segments.end(), [](const TCPSegment &seg) {
+        return seg.header().syn;
+    });
+    if (syn != direction.segments.end()) {
+        return {syn, direction.segments.end()};
+    }
+
+    vector<TCPSegment> segments{TCPSegment{}};
+    segments.front().header().syn = true;
+    segments.front().header().seqno = direction.segments.front().header().seqno - 1;
+    segments.insert(segments.end(), direction.segments.begin(), direction.segments.end());
+    cerr << "The capture doesn't have the SYN: replaying as if it came just before the first segment.\n";
+    return segments;
+}
+
+//! Replays segments into a TCPReceiver or TCPConnection, whose application reads everything at once
+class Replayer {
+  private:
+    optional<TCPReceiver> _receiver{};
+    optional<TCPConnection> _connection{};
+    vector<TCPSegment> _acks{};
+
+  public:
+    Replayer(const ReplayOptions &options, const vector<TCPSegment> &segments) {
+        if (not options.connection) {
+            _receiver.emplace(options.capacity);
+            return;
+        }
+        TCPConfig config;
+        config.recv_capacity = options.capacity;
+        // start the connection's seqnos where the captured acknos expect them
+        for (const auto &seg : segments) {
+            if (seg.header().ack) {
+                config.fixed_isn = seg.header().ackno - 1;
+                break;
+            }
+        }
+        _connection.emplace(config);
+    }
+
+    //! Ends the connection (if any) with a reset, as its peer would be gone, so that it doesn't warn
+    ~Replayer() {
+        if (_connection and _connection->active()) {
+            TCPSegment rst;
+            rst.header().rst = true;
+            _connection->segment_received(rst);
+        }
+    }
+    Replayer(const Replayer &other) = delete;
+    Replayer &operator=(const Replayer &other) = delete;
+
+    void segment_received(const TCPSegment &seg) {
+        if (_receiver) {
+            _receiver->segment_received(seg);
+            ByteStream &stream = _receiver->stream_out();
+            stream.pop_output(stream.buffer_size());
+        } else {
+            _connection->segment_received(seg);
+            ByteStream &stream = _connection->inbound_stream();
+            stream.pop_output(stream.buffer_size());
+            _connection->drain_segments(_acks);
+            _acks.clear();
+        }
+    }
+
+    size_t unassembled_bytes() const {
+        return _receiver ? _receiver->unassembled_bytes() : _connection->unassembled_bytes();
+    }
+    const ByteStream &stream() { return _receiver ? _receiver->stream_out() : _connection->inbound_stream(); }
+    TCPReceiverStats stats() const { return _receiver ? _receiver->stats() : _connection->stats().receiver; }
+};
+
+int main(int argc, char **argv) {
+    try {
+        const ReplayOptions options = get_options(argc, argv);
+        const map<string, Direction> directions = read_capture(options);
+        const Direction &direction = choose(directions, options.port);
+        const vector<TCPSegment> segments = replay_segments(direction);
+
+        // one instrumented run: every segment timed, and the reassembler watched
+        LatencyHistogram cost;
+        size_t peak_unassembled = 0, gaps = 0;
+        {
+            Replayer replayer{options, segments};
+            for (const auto &seg : segments) {
+                const bool had_gap = replayer.unassembled_bytes() > 0;
+                const auto start = steady_clock::now();
+                replayer.segment_received(seg);
+                cost.record(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+                peak_unassembled = max(peak_unassembled, replayer.unassembled_bytes());
+                gaps += not had_gap and replayer.unassembled_bytes() > 0;
+            }
+
+            const TCPReceiverStats stats = replayer.stats();
+            const char *target = options.connection ? "TCPConnection" : "TCPReceiver";
+            cout << "Replayed " << direction.name << " into a " << target << ": " << segments.size() << " segments, "
+                 << direction.payload_bytes << " bytes of payload\n"
+                 << "    assembled " << replayer.stream().bytes_written() << " bytes"
+                 << (replayer.stream().input_ended() ? " and the FIN" : "") << ", "
+                 << replayer.unassembled_bytes() << " left unassembled\n"
+                 << "    " << stats.out_of_order_segments << " segments out of order, " << gaps << " gaps opened, "
+                 << "at most " << peak_unassembled << " bytes unassembled\n"
+                 << "    " << stats.duplicate_segments << " duplicate segments\n";
+        }
+        cout << fixed << setprecision(0) << "    per segment: mean " << cost.mean() << " ns, p50 "
+             << cost.percentile(50) << " ns, p99 " << cost.percentile(99) << " ns, p99.9 " << cost.percentile(99.9)
+             << " ns, max " << cost.max() << " ns\n";
+
+        // then the whole replay, over and over, for the throughput
+        const auto start = steady_clock::now();
+        for (unsigned int run = 0; run < options.runs; ++run) {
+            Replayer replayer{options, segments};
+            for (const auto &seg : segments) {
+                replayer.segment_received(seg);
+            }
+        }
+        const double seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+        cout << setprecision(2) << "    " << options.runs << " replays: "
+             << segments.size() * options.runs / seconds / 1e6 << " M segments/s, "
+             << direction.payload_bytes * options.runs * 8 / seconds / 1e9 << " Gbit/s of payload\n";
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include "network_emulator.hh"
+#include "simulator.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t DEFAULT_LEN = 10 * 1000 * 1000;
+constexpr uint64_t DEFAULT_LIMIT_S = 3600;
+
+//! Options for the whole run; each scenario is one -e
+struct SimOptions {
+    size_t len = DEFAULT_LEN;
+    size_t flows = 1;
+    uint64_t limit_s = DEFAULT_LIMIT_S;
+    string format = "text";
+    TCPConfig tcp{};
+    vector<string> scenarios{};
+    string reverse{};
+};
+
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " [options]\n\n"
+         << "Simulates transfers between TCPConnections over emulated paths, in virtual time.\n"
+         << "Each -e gives a scenario: a path (see tcp_udp -e) for the data; every scenario is run.\n\n"
+
+         << "   Option                                                          Default\n"
+         << "   --                                                              --\n\n"
+
+         << "   -e <netem>      Path of the data, e.g. delay=40,loss=0.01        delay=10\n"
+         << "   -r <netem>      Path of the ACKs                                (the data path's\n"
+         << "                                                                   delay and jitter)\n"
+         << "   -n <bytes>      Bytes to send per flow                          " << DEFAULT_LEN << "\n"
+         << "   -N <flows>      Flows sharing the paths                         1\n"
+         << "   -w <bytes>      Receive capacity (window)                       " << TCPConfig::DEFAULT_CAPACITY << "\n"
+         << "   -s <bytes>      Send capacity                                   " << TCPConfig::DEFAULT_CAPACITY << "\n"
+         << "   -m <bytes>      Maximum payload size (MSS)                      " << TCPConfig::MAX_PAYLOAD_SIZE << "\n"
+         << "   -t <ms>         Initial retransmission timeout                  " << TCPConfig::TIMEOUT_DFLT << "\n"
+         << "   -l <seconds>    Give up after <seconds> of virtual time         " << DEFAULT_LIMIT_S << "\n"
+         << "   -f <format>     Output as text or csv                           text\n\n"
+
+         << "   -h              Show this message and quit.\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
+    }
+    cout << endl;
+}
+
+static SimOptions get_options(int argc, char **argv) {
+    SimOptions options;
+    for (int curr = 1; curr < argc; curr += 2) {
+        const string option = argv[curr];
+        if (option == "-h") {
+            show_usage(argv[0], nullptr);
+            exit(0);
+        }
+        if (curr + 1 >= argc) {
+            show_usage(argv[0], ("ERROR: " + option + " requires one argument.").c_str());
+            exit(1);
+        }
+        const char *arg = argv[curr + 1];
+
+        if (option == "-e") {
+            options.scenarios.push_back(arg);
+        } else if (option == "-r") {
+            options.reverse = arg;
+        } else if (option == "-n") {
+            options.len = strtoul(arg, nullptr, 0);
+        } else if (option == "-N") {
+            options.flows = max(1ul, strtoul(arg, nullptr, 0));
+        } else if (option == "-w") {
+            options.tcp.recv_capacity = strtoul(arg, nullptr, 0);
+        } else if (option == "-s") {
+            options.tcp.send_capacity = strtoul(arg, nullptr, 0);
+        } else if (option == "-m") {
+            options.tcp.max_payload_size = strtoul(arg, nullptr, 0);
+        } else if (option == "-t") {
+            options.tcp.rt_timeout = strtoul(arg, nullptr, 0);
+        } else if (option == "-l") {
+            options.limit_s = strtoul(arg, nullptr, 0);
+        } else if (option == "-f") {
+            options.format = arg;
+            if (options.format != "text" and options.format != "csv") {
+                show_usage(argv[0], "ERROR: -f must be text or csv.");
+                exit(1);
+            }
+        } else {
+            show_usage(argv[0], ("ERROR: unrecognized option " + option).c_str());
+            exit(1);
+        }
+    }
+    if (options.scenarios.empty()) {
+        options.scenarios.push_back("delay=10");
+    }
+    return options;
+}
+
+int main(int argc, char **argv) {
+    try {
+        const SimOptions options = get_options(argc, argv);
+
+        if (options.format == "csv") {
+            cout << "scenario,flows,bytes,completed,virtual_s,cpu_ms,events,median_mbps,min_mbps,retransmissions,"
+                    "rto_expirations\n";
+        }
+
+        for (const auto &scenario : options.scenarios) {
+            const NetemConfig forward = parse_netem_config(scenario);
+            NetemConfig reverse;
+            if (options.reverse.empty()) {
+                reverse.delay_ms = forward.delay_ms;
+                reverse.jitter_ms = forward.jitter_ms;
+                reverse.seed = forward.seed + 1;
+            } else {
+                reverse = parse_netem_config(options.reverse);
+            }
+
+            Simulator sim;
+            const size_t forward_link = sim.add_link(forward);
+            const size_t reverse_link = sim.add_link(reverse);
+            for (size_t i = 0; i < options.flows; ++i) {
+                SimFlowConfig flow;
+                flow.tcp = options.tcp;
+                flow.bytes = options.len;
+                flow.forward_link = forward_link;
+                flow.reverse_link = reverse_link;
+                sim.add_flow(flow);
+            }
+
+            const auto cpu_start = steady_clock::now();
+            sim.run(options.limit_s * 1000);
+            const double cpu_ms = duration_cast<microseconds>(steady_clock::now() - cpu_start).count() / 1e3;
+
+            size_t completed = 0;
+            uint64_t retransmissions = 0, rto_expirations = 0;
+            vector<double> goodputs;
+            for (size_t i = 0; i < options.flows; ++i) {
+                const SimFlowResult result = sim.result(i);
+                completed += result.completed;
+                goodputs.push_back(result.goodput_bps / 1e6);
+                retransmissions += result.client.sender.retransmissions;
+                rto_expirations += result.client.sender.rto_expirations;
+            }
+            sort(goodputs.begin(), goodputs.end());
+            const double median_mbps = goodputs[goodputs.size() / 2];
+            const double virtual_s = sim.now_ms() / 1e3;
+
+            if (options.format == "csv") {
+                cout << "\"" << scenario << "\"," << options.flows << "," << options.len << "," << completed << ","
+                     << virtual_s << "," << cpu_ms << "," << sim.events() << "," << median_mbps << ","
+                     << goodputs.front() << "," << retransmissions << "," << rto_expirations << "\n";
+            } else {
+                cout << fixed << setprecision(2) << scenario << ": " << completed << "/" << options.flows
+                     << " flows completed, median goodput " << median_mbps << " Mbit/s (min " << goodputs.front()
+                     << "), " << retransmissions << " retransmissions (" << rto_expirations << " timeouts)\n"
+                     << "    " << virtual_s << " s of virtual time in " << cpu_ms << " ms of CPU (" << sim.events()
+                     << " events)\n";
+            }
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
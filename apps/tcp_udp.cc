@@ -1,6 +1,8 @@
 #include "bidirectional_stream_copy.hh"
+#include "network_emulator.hh"
 #include "tcp_config.hh"
 #include "tcp_sponge_socket.hh"
+#include "tcp_trace.hh"
 
 #include <cstdlib>
 #include <cstring>
@@ -33,6 +35,19 @@ static void show_usage(const char *argv0, const char *msg) {
          << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
          << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+         << "   -o              Use UDP segmentation offload (GSO/GRO)          (off)\n\n"
+
+         << "   -e <netem>      Emulate a path for outgoing segments, e.g.      (none)\n"
+         << "                   delay=40,jitter=5,loss=0.01,duplicate=0.001,\n"
+         << "                   reorder=0.01,rate=20M,queue=65536,aqm=codel,seed=1\n"
+         << "                   (delay/jitter in ms; aqm is droptail or codel)\n\n"
+
+         << "   -T <file>       Write a binary trace of the connection to       (no trace)\n"
+         << "                   <file> (see trace_convert)\n\n"
+
+         << "   -H              Measure the latency from each write until its   (off)\n"
+         << "                   ACK, and print a summary of the histogram\n\n"
+
          << "   -h              Show this message and quit.\n\n";
 
     if (msg != nullptr) {
@@ -48,12 +63,15 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
     }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv) {
+static tuple<TCPConfig, FdAdapterConfig, NetemConfig, bool, bool, string> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
     FdAdapterConfig c_filt{};
+    NetemConfig c_netem{};
 
     int curr = 1;
     bool listen = false;
+    bool offload = false;
+    string trace_path;
 
     while (argc - curr > 2) {
         if (strncmp("-l", argv[curr], 3) == 0) {
@@ -86,6 +104,24 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
                 static_cast<LossRateDnT>(static_cast<float>(numeric_limits<LossRateDnT>::max()) * lossrate);
             curr += 2;
 
+        } else if (strncmp("-o", argv[curr], 3) == 0) {
+            offload = true;
+            curr += 1;
+
+        } else if (strncmp("-e", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -e requires one argument.");
+            c_netem = parse_netem_config(argv[curr + 1]);
+            curr += 2;
+
+        } else if (strncmp("-H", argv[curr], 3) == 0) {
+            c_fsm.measure_latency = true;
+            curr += 1;
+
+        } else if (strncmp("-T", argv[curr], 3) == 0) {
+            check_argc(argc, argv, curr, "ERROR: -T requires one argument.");
+            trace_path = argv[curr + 1];
+            curr += 2;
+
         } else if (strncmp("-h", argv[curr], 3) == 0) {
             show_usage(argv[0], nullptr);
             exit(0);
@@ -102,7 +138,7 @@ static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv)
         c_filt.destination = {argv[argc - 2], argv[argc - 1]};
     }
 
-    return make_tuple(c_fsm, c_filt, listen);
+    return make_tuple(c_fsm, c_filt, c_netem, listen, offload, trace_path);
 }
 
 int main(int argc, char **argv) {
@@ -114,14 +150,20 @@ int main(int argc, char **argv) {
         }
 
         // handle configuration and UDP setup from cmdline arguments
-        auto [c_fsm, c_filt, listen] = get_config(argc, argv);
+        auto [c_fsm, c_filt, c_netem, listen, offload, trace_path] = get_config(argc, argv);
+        if (not trace_path.empty()) {
+            Tracer::start(trace_path);
+        }
 
         // build a TCP FSM on top of the UDP socket
         UDPSocket udp_sock;
         if (listen) {
             udp_sock.bind(c_filt.source);
         }
-        LossyTCPOverUDPSpongeSocket tcp_socket(LossyTCPOverUDPSocketAdapter(TCPOverUDPSocketAdapter(move(udp_sock))));
+        TCPOverUDPSocketAdapter udp_adapter(move(udp_sock));
+        udp_adapter.set_offload(offload);
+        NetemTCPOverUDPSpongeSocket tcp_socket(
+            NetemTCPOverUDPSocketAdapter(LossyTCPOverUDPSocketAdapter(move(udp_adapter)), c_netem));
         if (listen) {
             tcp_socket.listen_and_accept(c_fsm, c_filt);
         } else {
@@ -130,6 +172,16 @@ int main(int argc, char **argv) {
 
         bidirectional_stream_copy(tcp_socket);
         tcp_socket.wait_until_closed();
+        if (c_fsm.measure_latency) {
+            cerr << "DEBUG: write-to-ACK latency: " << tcp_socket.stats().write_latency.summary() << "\n";
+        }
+
+        if (not trace_path.empty()) {
+            const uint64_t dropped = Tracer::stop();
+            if (dropped > 0) {
+                cerr << "DEBUG: " << dropped << " trace events were dropped (rings full).\n";
+            }
+        }
     } catch (const exception &e) {
         cerr << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
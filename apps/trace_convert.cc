@@ -0,0 +1,230 @@
+#include "ipv4_header.hh"
+#include "tcp_header.hh"
+#include "tcp_trace.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Converts a trace file written by the Tracer (e.g. by `tcp_udp -T <file>`) into
+//  * pcapng: every traced segment, as an IPv4 packet captured without its payload (as with `tcpdump -s 40`),
+//    with a nanosecond timestamp, for Wireshark or tcpdump; or
+//  * csv: every event, one per line, e.g. to plot sequence numbers against time.
+
+static constexpr uint16_t LINKTYPE_RAW = 101;  //!< Raw IPv4 or IPv6 packets, in pcap and pcapng files
+
+static void show_usage(const char *argv0, const char *msg) {
+    cout << "Usage: " << argv0 << " <trace> <pcapng|csv> <output>\n\n"
+         << "Converts a trace written by the Tracer into a pcapng capture (of the segments' headers)\n"
+         << "or a CSV time-sequence listing (of every event).\n\n";
+
+    if (msg != nullptr) {
+        cout << msg;
+    }
+    cout << endl;
+}
+
+//! Append `value` to `out` in host byte order (pcapng files are written in the writer's byte order)
+template <typename T>
+static void put(string &out, const T value) {
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+//! Append a pcapng block of type `type`, whose body (options included) is `body`
+static void put_block(string &out, const uint32_t type, string body) {
+    body.resize((body.size() + 3) / 4 * 4, 0);
+    const uint32_t total_length = body.size() + 12;
+    put(out, type);
+    put(out, total_length);
+    out += body;
+    put(out, total_length);
+}
+
+//! Reconstruct the IPv4 and TCP headers of a traced segment
+static string packet_headers(const TraceRecord &record) {
+    TCPHeader tcp;
+    tcp.sport = record.sport;
+    tcp.dport = record.dport;
+    tcp.seqno = WrappingInt32{record.seqno};
+    tcp.ackno = WrappingInt32{record.ackno};
+    tcp.urg = record.flags & 0x20;
+    tcp.ack = record.flags & 0x10;
+    tcp.psh = record.flags & 0x08;
+    tcp.rst = record.flags & 0x04;
+    tcp.syn = record.flags & 0x02;
+    tcp.fin = record.flags & 0x01;
+    tcp.win = record.win;
+
+    IPv4Header ip;
+    ip.len = IPv4Header::LENGTH + TCPHeader::LENGTH + record.length;
+    ip.src = record.src_ip;
+    ip.dst = record.dst_ip;
+    InternetChecksum check;
+    check.add(ip.serialize());
+    ip.cksum = check.value();
+
+    // the TCP checksum can't be computed without the payload, so it is left as zero
+    return ip.serialize() + tcp.serialize();
+}
+
+static string to_pcapng(const vector<TraceRecord> &records, const TraceFileHeader &header) {
+    string out;
+
+    // Section Header Block
+    string section;
+    put(section, uint32_t{0x1a2b3c4d});  // byte-order magic
+    put(section, uint16_t{1});           // major version
+    put(section, uint16_t{0});           // minor version
+    put(section, int64_t{-1});           // section length (unknown)
+    put_block(out, 0x0a0d0d0a, section);
+
+    // Interface Description Block, with nanosecond timestamps (if_tsresol = 9)
+    string interface;
+    put(interface, LINKTYPE_RAW);
+    put(interface, uint16_t{0});  // reserved
+    put(interface, uint32_t{0});  // snaplen (unlimited)
+    put(interface, uint16_t{9});  // if_tsresol
+    put(interface, uint16_t{1});
+    interface += string("\x09\0\0\0", 4);
+    put(interface, uint32_t{0});  // opt_endofopt
+    put_block(out, 1, interface);
+
+    // an Enhanced Packet Block per segment
+    for (const auto &record : records) {
+        if (record.event != TraceEvent::SegmentSent and record.event != TraceEvent::SegmentReceived) {
+            continue;
+        }
+        const string headers = packet_headers(record);
+        const uint64_t timestamp = record.time_ns + header.realtime_offset_ns;
+
+        string packet;
+        put(packet, uint32_t{0});  // interface id
+        put(packet, static_cast<uint32_t>(timestamp >> 32));
+        put(packet, static_cast<uint32_t>(timestamp));
+        put(packet, static_cast<uint32_t>(headers.size()));                  // captured length
+        put(packet, static_cast<uint32_t>(headers.size() + record.length));  // original length
+        packet += headers;
+        put_block(out, 6, packet);
+    }
+
+    return out;
+}
+
+static string event_name(const TraceEvent event) {
+    switch (event) {
+        case TraceEvent::SegmentSent:
+            return "sent";
+        case TraceEvent::SegmentReceived:
+            return "received";
+        case TraceEvent::RetransmissionTimeout:
+            return "rto";
+        case TraceEvent::WindowUpdate:
+            return "window";
+        case TraceEvent::StateChange:
+            return "state";
+    }
+    return "unknown";
+}
+
+//! The name of the `state`th TCPState::State (or "other" for a state that isn't an official one)
+static string state_name(const uint32_t state) {
+    static const char *const names[] = {"LISTEN",
+                                        "SYN_RCVD",
+                                        "SYN_SENT",
+                                        "ESTABLISHED",
+                                        "CLOSE_WAIT",
+                                        "LAST_ACK",
+                                        "FIN_WAIT_1",
+                                        "FIN_WAIT_2",
+                                        "CLOSING",
+                                        "TIME_WAIT",
+                                        "CLOSED",
+                                        "RESET"};
+    return state < size(names) ? names[state] : "other";
+}
+
+static string flags_string(const uint8_t flags) {
+    string ret;
+    const char *names = "FSRPAU";
+    for (unsigned int bit = 0; bit < 6; ++bit) {
+        if (flags & (1 << bit)) {
+            ret += names[bit];
+        }
+    }
+    return ret;
+}
+
+static string ipv4_string(const uint32_t address) {
+    const in_addr addr{htonl(address)};
+    return inet_ntoa(addr);
+}
+
+static string to_csv(const vector<TraceRecord> &records) {
+    ostringstream out;
+    out << "time_s,event,connection,src,sport,dst,dport,flags,seqno,ackno,length,win,value\n";
+    const uint64_t start = records.empty() ? 0 : records.front().time_ns;
+    for (const auto &record : records) {
+        out << fixed << setprecision(9) << (record.time_ns - start) / 1e9 << "," << event_name(record.event) << ","
+            << record.connection << ",";
+        if (record.event == TraceEvent::SegmentSent or record.event == TraceEvent::SegmentReceived) {
+            out << ipv4_string(record.src_ip) << "," << record.sport << "," << ipv4_string(record.dst_ip) << ","
+                << record.dport << "," << flags_string(record.flags) << ",";
+        } else {
+            out << ",,,,,";
+        }
+        out << record.seqno << "," << record.ackno << "," << record.length << "," << record.win << ",";
+        if (record.event == TraceEvent::StateChange) {
+            out << state_name(record.value) << "\n";
+        } else {
+            out << record.value << "\n";
+        }
+    }
+    return out.str();
+}
+
+int main(int argc, char **argv) {
+    try {
+        if (argc != 4) {
+            show_usage(argv[0], "ERROR: wrong number of arguments.");
+            return EXIT_FAILURE;
+        }
+        const string format = argv[2];
+        if (format != "pcapng" and format != "csv") {
+            show_usage(argv[0], "ERROR: the format must be pcapng or csv.");
+            return EXIT_FAILURE;
+        }
+
+        TraceFileHeader header;
+        vector<TraceRecord> records = read_trace_file(argv[1], header);
+
+        // each thread's events are in order, but different threads' events are not interleaved
+        stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b) {
+            return a.time_ns < b.time_ns;
+        });
+
+        ofstream output{argv[3], ios::binary};
+        if (not output) {
+            throw runtime_error(string("could not open ") + argv[3]);
+        }
+        output << (format == "pcapng" ? to_pcapng(records, header) : to_csv(records));
+        if (not output) {
+            throw runtime_error(string("could not write ") + argv[3]);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
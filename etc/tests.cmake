@@ -36,6 +36,7 @@ add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_watermarks   COMMAND byte_stream_watermarks)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
@@ -56,6 +57,18 @@ add_test(NAME t_connect              COMMAND fsm_connect_relaxed)
 add_test(NAME ec_listen              COMMAND fsm_listen)
 add_test(NAME t_listen               COMMAND fsm_listen_relaxed)
 add_test(NAME t_winsize              COMMAND fsm_winsize)
+add_test(NAME t_tcp_stats            COMMAND tcp_stats)
+add_test(NAME t_latency_histogram    COMMAND latency_histogram)
+add_test(NAME t_network_emulator     COMMAND network_emulator)
+add_test(NAME t_simulator            COMMAND simulator)
+add_test(NAME t_static_eventloop     COMMAND static_eventloop)
+add_test(NAME t_connection_table     COMMAND connection_table)
+add_test(NAME t_siphash              COMMAND siphash)
+add_test(NAME t_tcp_stack            COMMAND tcp_stack)
+add_test(NAME t_spsc_ring            COMMAND spsc_ring)
+add_test(NAME t_sharded_stack        COMMAND sharded_stack)
+add_test(NAME t_buffer_pool          COMMAND buffer_pool)
+add_test(NAME t_tcp_trace            COMMAND tcp_trace)
 add_test(NAME ec_retx                COMMAND fsm_retx)
 add_test(NAME t_retx                 COMMAND fsm_retx_relaxed)
 add_test(NAME t_retx_win             COMMAND fsm_retx_win)
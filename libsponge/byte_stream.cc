@@ -1,5 +1,9 @@
 #include "byte_stream.hh"
 
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
 // Dummy implementation of a flow-controlled in-memory byte stream.
 
 // For Lab 0, please replace with a real implementation that passes the
@@ -7,13 +11,10 @@
 
 // You will need to add private members to the class declaration in `byte_stream.hh`
 
-template <typename... Targs>
-void DUMMY_CODE(Targs &&... /* unused */) {}
-
 using namespace std;
 
 ByteStream::ByteStream(const size_t capacity)
-    : _queue(capacity + 1)
+    : _queue(capacity)
     , _head(0)
     , _rear(0)
     , _written_size(0)
@@ -21,37 +22,83 @@ ByteStream::ByteStream(const size_t capacity)
     , _buffer_size(0)
     , _capacity_size(capacity)
     , _end_input(false)
-    , _error(false) {
-        DUMMY_CODE(_head,_rear);
-    //_queue.reserve(capacity + 1);
-}
+    , _error(false) {}
 
-size_t ByteStream::write(const string &data) {
+size_t ByteStream::write(string_view data) {
     if (_end_input) {
         return 0;
     }
-    size_t size_to_write = min(data.size(), _capacity_size - _buffer_size);
-    string s=data.substr(0,size_to_write);
-    _buffer.append(BufferList(move(s)));
+    const size_t size_to_write = min(data.size(), remaining_capacity());
+    const size_t first_part = min(size_to_write, _capacity_size - _rear);
+    copy_n(data.data(), first_part, _queue.begin() + _rear);
+    copy_n(data.data() + first_part, size_to_write - first_part, _queue.begin());
 
-    _written_size += size_to_write;
-    _buffer_size += size_to_write;
+    commit_write(size_to_write);
     return size_to_write;
 }
 
+//! \returns one iovec for each contiguous run of free space, in stream order (none if the stream is full)
+vector<iovec> ByteStream::writable_iovecs() {
+    vector<iovec> ret;
+    if (_end_input) {
+        return ret;
+    }
+    const size_t free_space = remaining_capacity();
+    const size_t first_part = min(free_space, _capacity_size - _rear);
+    if (first_part > 0) {
+        ret.push_back({_queue.data() + _rear, first_part});
+    }
+    if (free_space > first_part) {
+        ret.push_back({_queue.data(), free_space - first_part});
+    }
+    return ret;
+}
+
+//! \param[in] len is the number of bytes that were stored, in order, at the start of writable_iovecs()
+void ByteStream::commit_write(const size_t len) {
+    if (len > remaining_capacity()) {
+        throw runtime_error("ByteStream::commit_write: more bytes than free space");
+    }
+    const bool was_readable = readable();
+    _rear += len;
+    if (_rear >= _capacity_size) {
+        _rear -= _capacity_size;
+    }
+    _written_size += len;
+    _buffer_size += len;
+    if (not was_readable and readable() and _on_readable) {
+        _on_readable();
+    }
+}
+
 //! \param[in] len bytes will be copied from the output side of the buffer
 string ByteStream::peek_output(const size_t len) const {
-    size_t pop_size = min(len, _buffer_size);
-    string output=_buffer.concatenate().substr(0,pop_size);
+    const size_t peek_size = min(len, _buffer_size);
+    const size_t first_part = min(peek_size, _capacity_size - _head);
+    string output;
+    output.reserve(peek_size);
+    output.append(_queue.data() + _head, first_part);
+    output.append(_queue.data(), peek_size - first_part);
     return output;
 }
 
+string_view ByteStream::peek_contiguous() const {
+    return {_queue.data() + _head, min(_buffer_size, _capacity_size - _head)};
+}
+
 //! \param[in] len bytes will be removed from the output side of the buffer
 void ByteStream::pop_output(const size_t len) {
-    size_t pop_size = min(len, _buffer_size);
-    _buffer.remove_prefix(pop_size);
+    const size_t pop_size = min(len, _buffer_size);
+    const bool was_writable = writable();
+    _head += pop_size;
+    if (_head >= _capacity_size) {
+        _head -= _capacity_size;
+    }
     _buffer_size -= pop_size;
     _read_size += pop_size;
+    if (not was_writable and writable() and _on_writable) {
+        _on_writable();
+    }
 }
 
 //! Read (i.e., copy and then pop) the next "len" bytes of the stream
@@ -64,9 +111,35 @@ std::string ByteStream::read(const size_t len) {
     return data;
 }
 
-// void ByteStream::end_input() {}
+void ByteStream::end_input() {
+    const bool was_readable = readable();
+    _end_input = true;
+    if (not was_readable and _on_readable) {
+        _on_readable();
+    }
+}
 
-// bool ByteStream::input_ended() const { return {}; }
+void ByteStream::set_error() {
+    const bool was_readable = readable();
+    _error = true;
+    if (not was_readable and _on_readable) {
+        _on_readable();
+    }
+}
+
+//! \param[in] free_bytes is the free space at which the stream counts as writable (at least one byte)
+//! \param[in] callback is called whenever the stream becomes writable (not if it already is)
+void ByteStream::set_writable_watermark(const size_t free_bytes, function<void()> callback) {
+    _writable_watermark = clamp(free_bytes, size_t{1}, max(_capacity_size, size_t{1}));
+    _on_writable = move(callback);
+}
+
+//! \param[in] bytes is the number of buffered bytes at which the stream counts as readable (at least one)
+//! \param[in] callback is called whenever the stream becomes readable (not if it already is)
+void ByteStream::set_readable_watermark(const size_t bytes, function<void()> callback) {
+    _readable_watermark = clamp(bytes, size_t{1}, max(_capacity_size, size_t{1}));
+    _on_readable = move(callback);
+}
 
 size_t ByteStream::buffer_size() const { return _buffer_size; }
 
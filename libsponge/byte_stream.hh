@@ -1,8 +1,13 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #include "buffer.hh"
+
+#include <functional>
 #include <string>
+#include <string_view>
+#include <sys/uio.h>
 #include <vector>
+
 //! \brief An in-order byte stream.
 
 //! Bytes are written on the "input" side and read from the "output"
@@ -16,17 +21,21 @@ class ByteStream {
     // all, but if any of your tests are taking longer than a second,
     // that's a sign that you probably want to keep exploring
     // different approaches.
-    std::vector<u_char> _queue;
-    BufferList _buffer={};
-    size_t _head, _rear;
-    size_t _written_size;  // total bytes written into the stream.
-    size_t _read_size;     // total bytes read from the stream.
+    std::vector<char> _queue;  //!< Ring buffer holding the unread bytes
+    size_t _head, _rear;       //!< Ring indices of the next byte to read and the next byte to write
+    size_t _written_size;      // total bytes written into the stream.
+    size_t _read_size;         // total bytes read from the stream.
 
     size_t _buffer_size;  // current number of bytes in buffer.
     size_t _capacity_size;
     bool _end_input{};
     bool _error{};  //!< Flag indicating that the stream suffered an error.
 
+    size_t _writable_watermark{1};         //!< Free space at which the stream counts as writable
+    size_t _readable_watermark{1};         //!< Buffered bytes at which the stream counts as readable
+    std::function<void()> _on_writable{};  //!< Called when the stream becomes writable
+    std::function<void()> _on_readable{};  //!< Called when the stream becomes readable
+
   public:
     //! Construct a stream with room for `capacity` bytes.
     ByteStream(const size_t capacity);
@@ -37,16 +46,23 @@ class ByteStream {
     //! Write a string of bytes into the stream. Write as many
     //! as will fit, and return how many were written.
     //! \returns the number of bytes accepted into the stream
-    size_t write(const std::string &data);
+    size_t write(std::string_view data);
 
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
+    //! \brief The free space of the stream, as (at most two) regions that can be filled in place
+    //! \note For use with [readv(2)](\ref man2::readv); follow with a call to commit_write()
+    std::vector<iovec> writable_iovecs();
+
+    //! \brief Account for `len` bytes that were written directly into the regions from writable_iovecs()
+    void commit_write(const size_t len);
+
     //! Signal that the byte stream has reached its ending
-    void end_input() { _end_input = true; }
+    void end_input();
 
     //! Indicate that the stream suffered an error.
-    void set_error() { _error = true; }
+    void set_error();
     //!@}
 
     //! \name "Output" interface for the reader
@@ -59,6 +75,11 @@ class ByteStream {
     //! Remove bytes from the buffer
     void pop_output(const size_t len);
 
+    //! \brief Peek at the next bytes of the stream without copying them
+    //! \returns a view of the longest prefix of the buffer that is stored contiguously (possibly not all of it);
+    //!          valid until the next call to a non-const method
+    std::string_view peek_contiguous() const;
+
     //! Read (i.e., copy and then pop) the next "len" bytes of the stream
     //! \returns a string
     std::string read(const size_t len);
@@ -88,6 +109,29 @@ class ByteStream {
     //! Total number of bytes popped
     size_t bytes_read() const;
     //!@}
+
+    //! \name Watermarks
+    //! The stream is *writable* when its input has not ended and it has room for at least the writable
+    //! watermark, and *readable* when it buffers at least the readable watermark or has reached
+    //! its ending (or an error). Both watermarks start at one byte (and are capped at the capacity).
+    //! Each callback is edge-triggered: it is called, after the change, by the write(), pop_output(),
+    //! end_input() or set_error() that makes the stream writable (or readable) when it was not, so a
+    //! reader or writer can sleep until there is a worthwhile amount of work, rather than being woken
+    //! for every byte.
+    //!@{
+
+    //! Count the stream as writable once `free_bytes` are free, and call `callback` when it becomes so
+    void set_writable_watermark(const size_t free_bytes, std::function<void()> callback = {});
+
+    //! Count the stream as readable once `bytes` are buffered, and call `callback` when it becomes so
+    void set_readable_watermark(const size_t bytes, std::function<void()> callback = {});
+
+    //! \returns `true` if the input has not ended and at least the writable watermark is free
+    bool writable() const { return not _end_input and remaining_capacity() >= _writable_watermark; }
+
+    //! \returns `true` if at least the readable watermark is buffered, or the stream has ended or suffered an error
+    bool readable() const { return _buffer_size >= _readable_watermark or _end_input or _error; }
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_BYTE_STREAM_HH
\ No newline at end of file
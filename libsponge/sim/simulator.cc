@@ -0,0 +1,205 @@
+#include "simulator.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static constexpr uint64_t NS_PER_MS = 1000000;
+
+//! What the clients write (only its length matters)
+static const string filler(65536, 'x');
+
+Simulator::Flow::Flow(const SimFlowConfig &flow_config)
+    : config(flow_config), client(flow_config.tcp), server(flow_config.tcp) {}
+
+//! \param[in] config is the link's behavior, including its seed
+size_t Simulator::add_link(const NetemConfig &config) {
+    _links.emplace_back(config);
+    _links.back().advance_to(_now_ns);
+    _link_event_ns.emplace_back();
+    return _links.size() - 1;
+}
+
+//! \param[in] config is the flow to simulate
+size_t Simulator::add_flow(const SimFlowConfig &config) {
+    if (config.forward_link >= _links.size() or config.reverse_link >= _links.size()) {
+        throw runtime_error("Simulator::add_flow: no such link");
+    }
+    SimFlowConfig fixed = config;
+    if (not fixed.tcp.fixed_isn) {
+        fixed.tcp.fixed_isn = WrappingInt32{static_cast<uint32_t>(_flows.size() * 0x9e3779b9)};
+    }
+    _flows.emplace_back(fixed);
+    _agenda.push({max(_now_ns, config.start_ms * NS_PER_MS), EventType::FlowStart, _flows.size() - 1});
+    return _flows.size() - 1;
+}
+
+//! \param[in] until_ms is the virtual time at which to stop, if some flows are still running
+bool Simulator::run(const uint64_t until_ms) {
+    const uint64_t until_ns = until_ms * NS_PER_MS;
+    while (not _agenda.empty() and _agenda.top().time_ns <= until_ns) {
+        const Event event = _agenda.top();
+        _agenda.pop();
+        _now_ns = max(_now_ns, event.time_ns);
+
+        switch (event.type) {
+            case EventType::FlowStart: {
+                Flow &flow = _flows[event.index];
+                flow.started = true;
+                flow.result.start_ms = _now_ns / NS_PER_MS;
+                flow.tick_ns[0] = flow.tick_ns[1] = _now_ns;
+                flow.client.connect();
+                break;
+            }
+            case EventType::Timer: {
+                Flow &flow = _flows[event.index / 2];
+                const unsigned int side = event.index % 2;
+                if (flow.timer_ns[side] != event.time_ns) {
+                    continue;  // superseded by an earlier timer event
+                }
+                flow.timer_ns[side].reset();
+                _catch_up(flow, side);
+                break;
+            }
+            case EventType::Link:
+                if (_link_event_ns[event.index] != event.time_ns) {
+                    continue;  // superseded
+                }
+                _link_event_ns[event.index].reset();
+                ++_events;
+                _deliver(event.index);
+                continue;
+        }
+
+        ++_events;
+        const size_t flow_index = event.type == EventType::FlowStart ? event.index : event.index / 2;
+        _service(flow_index);
+        _schedule(flow_index);
+    }
+
+    if (not _agenda.empty()) {
+        _now_ns = max(_now_ns, until_ns);
+        return false;
+    }
+    return true;
+}
+
+//! \param[in] flow is the flow whose endpoint to tick
+//! \param[in] side is 0 for the client, 1 for the server
+void Simulator::_catch_up(Flow &flow, const unsigned int side) {
+    const uint64_t ms = (_now_ns - flow.tick_ns[side]) / NS_PER_MS;
+    if (ms > 0) {
+        flow.endpoint(side).tick(ms);
+        flow.tick_ns[side] += ms * NS_PER_MS;
+    }
+}
+
+//! \param[in] flow_index is the flow to service
+void Simulator::_service(const size_t flow_index) {
+    Flow &flow = _flows[flow_index];
+    if (not flow.started) {
+        return;
+    }
+
+    // the client writes all it can, and closes once it has written everything
+    while (flow.sent < flow.config.bytes and flow.client.remaining_outbound_capacity() > 0) {
+        const size_t length =
+            min({flow.config.bytes - flow.sent, flow.client.remaining_outbound_capacity(), filler.size()});
+        flow.sent += flow.client.write(string_view{filler.data(), length});
+    }
+    if (flow.sent == flow.config.bytes and not flow.client_closed) {
+        flow.client.end_input_stream();
+        flow.client_closed = true;
+    }
+
+    // the server reads everything, and closes once it has read the end of the stream
+    ByteStream &inbound = flow.server.inbound_stream();
+    flow.received += inbound.buffer_size();
+    inbound.pop_output(inbound.buffer_size());
+    if (inbound.eof() and not flow.result.completed) {
+        flow.result.completed = true;
+        flow.result.finish_ms = _now_ns / NS_PER_MS;
+        flow.server.end_input_stream();
+    }
+
+    // each endpoint's segments go into its link, addressed to the other endpoint
+    for (unsigned int side = 0; side < 2; ++side) {
+        flow.endpoint(side).drain_segments(_outgoing);
+        NetworkEmulator &link = _links[side == 0 ? flow.config.forward_link : flow.config.reverse_link];
+        const FourTuple destination{0, static_cast<uint32_t>(2 * flow_index + 1 - side), 0, 0};
+        for (const auto &seg : _outgoing) {
+            link.send(seg, destination);
+        }
+        _outgoing.clear();
+    }
+}
+
+//! \param[in] flow_index is the flow whose endpoints (and links) may have something new to do
+void Simulator::_schedule(const size_t flow_index) {
+    Flow &flow = _flows[flow_index];
+    for (unsigned int side = 0; side < 2; ++side) {
+        const optional<size_t> timeout = flow.endpoint(side).time_until_next_timeout();
+        if (not timeout) {
+            continue;
+        }
+        const uint64_t due_ns = flow.tick_ns[side] + timeout.value() * NS_PER_MS;
+        if (not flow.timer_ns[side] or due_ns < flow.timer_ns[side].value()) {
+            flow.timer_ns[side] = due_ns;
+            _agenda.push({due_ns, EventType::Timer, 2 * flow_index + side});
+        }
+    }
+    _schedule_link(flow.config.forward_link);
+    _schedule_link(flow.config.reverse_link);
+}
+
+//! \param[in] link is the link that may have something new to do
+void Simulator::_schedule_link(const size_t link) {
+    const optional<uint64_t> next_ns = _links[link].next_event_ns();
+    if (next_ns and (not _link_event_ns[link] or next_ns.value() < _link_event_ns[link].value())) {
+        _link_event_ns[link] = next_ns;
+        _agenda.push({next_ns.value(), EventType::Link, link});
+    }
+}
+
+//! \param[in] link is the link whose segments have come out
+void Simulator::_deliver(const size_t link) {
+    _links[link].advance_to(_now_ns);
+    _links[link].take_ready(_ready);
+
+    vector<size_t> touched;
+    for (auto &packet : _ready) {
+        const uint32_t endpoint = packet.flow.value().dst_ip;
+        Flow &flow = _flows[endpoint / 2];
+        TCPConnection &connection = flow.endpoint(endpoint % 2);
+        if (not connection.active()) {
+            continue;
+        }
+        _catch_up(flow, endpoint % 2);
+        connection.segment_received(packet.segment);
+        if (find(touched.begin(), touched.end(), endpoint / 2) == touched.end()) {
+            touched.push_back(endpoint / 2);
+        }
+    }
+    _ready.clear();
+
+    for (const auto flow_index : touched) {
+        _service(flow_index);
+        _schedule(flow_index);
+    }
+    _schedule_link(link);
+}
+
+//! \param[in] flow is the flow whose results to report
+SimFlowResult Simulator::result(const size_t flow) const {
+    const Flow &f = _flows.at(flow);
+    SimFlowResult result = f.result;
+    result.reset = f.client.state() == TCPState::State::RESET or f.server.state() == TCPState::State::RESET;
+    if (result.completed and result.finish_ms > result.start_ms) {
+        result.goodput_bps = f.received * 8e3 / (result.finish_ms - result.start_ms);
+    }
+    result.client = f.client.stats();
+    result.server = f.server.stats();
+    return result;
+}
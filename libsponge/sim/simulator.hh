@@ -0,0 +1,132 @@
+#ifndef SPONGE_LIBSPONGE_SIMULATOR_HH
+#define SPONGE_LIBSPONGE_SIMULATOR_HH
+
+#include "network_emulator.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_stats.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <vector>
+
+//! One transfer to simulate: a client that connects, sends `bytes` and closes, and a server that reads
+struct SimFlowConfig {
+    TCPConfig tcp{};         //!< Config of both endpoints (a fixed ISN is chosen if it has none)
+    size_t bytes{1000000};   //!< Bytes that the client sends
+    uint64_t start_ms{0};    //!< When the client connects
+    size_t forward_link{0};  //!< Link that carries the client's segments (see Simulator::add_link())
+    size_t reverse_link{1};  //!< Link that carries the server's segments
+};
+
+//! What happened to one simulated transfer
+struct SimFlowResult {
+    bool completed{false};  //!< Did the server read every byte, and the end of the stream?
+    bool reset{false};      //!< Was either connection reset (e.g. after too many retransmissions)?
+    uint64_t start_ms{0};   //!< When the client connected
+    uint64_t finish_ms{0};  //!< When the server read the end of the stream (if it did)
+    double goodput_bps{0};  //!< Bytes delivered, in bits per second from connect to finish
+    TCPStats client{};      //!< The client's statistics
+    TCPStats server{};      //!< The server's statistics
+};
+
+//! \brief A discrete-event simulator of TCPConnections talking over NetworkEmulator links, in virtual time
+//! \details Unlike a real-time owner (or a benchmark that calls tick() at every step), the simulator
+//! keeps a virtual clock and jumps from one event to the next: a segment coming out of a link, a
+//! link's queue moving, a flow starting, or a connection's timer expiring (see
+//! TCPConnection::time_until_next_timeout()). Idle time costs nothing, so a long transfer over a
+//! slow, high-latency path takes as much CPU as the segments it sends.
+//!
+//! Each link is a NetworkEmulator, which may be shared by several flows (e.g. as a common
+//! bottleneck). Given the same links (with the same seeds) and flows, a run always gives the same
+//! results: the only other randomness, the ISNs, is fixed by the simulator.
+class Simulator {
+  private:
+    //! Everything about one flow
+    struct Flow {
+        SimFlowConfig config;
+        TCPConnection client;
+        TCPConnection server;
+        uint64_t tick_ns[2]{0, 0};              //!< Virtual time up to which each endpoint has been ticked
+        std::optional<uint64_t> timer_ns[2]{};  //!< Time of each endpoint's pending timer event, if any
+        size_t sent{0};                         //!< Bytes written to the client
+        size_t received{0};                     //!< Bytes read from the server
+        bool started{false};
+        bool client_closed{false};
+        SimFlowResult result{};
+
+        explicit Flow(const SimFlowConfig &flow_config);
+        TCPConnection &endpoint(const unsigned int side) { return side == 0 ? client : server; }
+    };
+
+    //! What an event is about
+    enum class EventType { FlowStart, Timer, Link };
+
+    //! An event: something to look at, at a given time
+    struct Event {
+        uint64_t time_ns;
+        EventType type;
+        size_t index;  //!< The flow (for FlowStart), endpoint (for Timer: 2 * flow + side) or link
+
+        //! Orders a std::priority_queue soonest first (and then by insertion, through `index`)
+        bool operator<(const Event &other) const {
+            return time_ns != other.time_ns ? time_ns > other.time_ns : index > other.index;
+        }
+    };
+
+    uint64_t _now_ns{0};                                    //!< The virtual clock
+    uint64_t _events{0};                                    //!< Events processed so far
+    std::priority_queue<Event> _agenda{};                   //!< Upcoming events (some of them stale)
+    std::deque<NetworkEmulator> _links{};                   //!< The links
+    std::vector<std::optional<uint64_t>> _link_event_ns{};  //!< Time of each link's pending event, if any
+    std::deque<Flow> _flows{};                              //!< The flows
+    std::vector<NetworkEmulator::Packet> _ready{};          //!< Segments that have come out of a link
+    std::vector<TCPSegment> _outgoing{};                    //!< Segments on their way from an endpoint into a link
+
+    //! Tick endpoint `side` of `flow` up to the current time
+    void _catch_up(Flow &flow, const unsigned int side);
+
+    //! Let `flow`'s applications write and read, and send what its endpoints have queued
+    void _service(const size_t flow_index);
+
+    //! Make sure that an event is pending for the next thing that `flow`'s endpoints or the links will do
+    void _schedule(const size_t flow_index);
+
+    //! Make sure that an event is pending for the next thing that link `link` will do
+    void _schedule_link(const size_t link);
+
+    //! Deliver every segment that has come out of link `link`
+    void _deliver(const size_t link);
+
+  public:
+    //! Add a link, and return its index
+    size_t add_link(const NetemConfig &config);
+
+    //! Add a flow, and return its index
+    size_t add_flow(const SimFlowConfig &config);
+
+    //! Run until every flow is over, or until the virtual clock reaches `until_ms`
+    //! \returns `true` if every flow is over
+    bool run(const uint64_t until_ms);
+
+    //! \name Accessors
+    //!@{
+
+    //! The virtual clock, in milliseconds
+    uint64_t now_ms() const { return _now_ns / 1000000; }
+
+    //! Events processed so far
+    uint64_t events() const { return _events; }
+
+    //! A link
+    const NetworkEmulator &link(const size_t index) const { return _links.at(index); }
+
+    //! A flow's results so far
+    SimFlowResult result(const size_t flow) const;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_SIMULATOR_HH
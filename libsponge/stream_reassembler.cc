@@ -37,6 +37,17 @@ void StreamReassembler::push_substring(const string &data, const size_t index, c
     assemble_string();
 }
 
+bool StreamReassembler::push_in_order(const string_view data, const uint64_t index) {
+    if (index != _unassembled_byte_idx or not _unassembled_strs.empty() or _output.input_ended() or
+        data.size() > _output.remaining_capacity()) {
+        return false;
+    }
+    _output.write(data);
+    _unassembled_byte_idx += data.size();
+    update_eof_status();
+    return true;
+}
+
 inline size_t StreamReassembler::current_max_byte_idx() const {
     return _unassembled_byte_idx + _capacity - _output.buffer_size() - 1;
 }
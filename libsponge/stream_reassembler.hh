@@ -10,6 +10,7 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -67,6 +68,12 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Fast path of push_substring() for the common case of in-order data
+    //! \details Applies when `data` starts at the first unassembled index, nothing is waiting to be
+    //! reassembled, and all of `data` fits in the stream; it is then written straight to the stream.
+    //! \returns `false` (having done nothing) if this doesn't apply, and the caller should use push_substring()
+    bool push_in_order(const std::string_view data, const uint64_t index);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
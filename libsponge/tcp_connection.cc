@@ -1,6 +1,7 @@
 #include "tcp_connection.hh"
 
 #include <cassert>
+#include <chrono>
 #include <iostream>
 // Dummy implementation of a TCP connection
 
@@ -20,9 +21,95 @@ size_t TCPConnection::unassembled_bytes() const { return _receiver.unassembled_b
 
 size_t TCPConnection::time_since_last_segment_received() const { return _time_since_last_segment_received; }
 
+optional<size_t> TCPConnection::time_until_next_timeout() const {
+    if (not active()) {
+        return {};
+    }
+    optional<size_t> ret = _sender.time_until_retransmission();
+    if (TCPState::state_summary(_receiver) == TCPReceiverStateSummary::FIN_RECV and
+        TCPState::state_summary(_sender) == TCPSenderStateSummary::FIN_ACKED and _linger_after_streams_finish) {
+        const size_t linger = 10 * _cfg.rt_timeout;
+        const size_t remaining =
+            _time_since_last_segment_received >= linger ? 0 : linger - _time_since_last_segment_received;
+        ret = min(ret.value_or(remaining), remaining);
+    }
+    return ret;
+}
+
+TCPStats TCPConnection::stats() const {
+    return {_segments_received, _sender.stats(), _receiver.stats(), _write_latency};
+}
+
+static uint64_t monotonic_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//! \details The sender's acknowledged sequence numbers are its SYN, then the stream's bytes (then its FIN).
+void TCPConnection::record_write_latencies() {
+    const uint64_t acked = _sender.next_seqno_absolute() - _sender.bytes_in_flight();
+    if (acked == 0 or _unacked_writes.front().first > acked - 1) {
+        return;
+    }
+    const uint64_t now = monotonic_ns();
+    while (not _unacked_writes.empty() and _unacked_writes.front().first <= acked - 1) {
+        _write_latency.record(now - _unacked_writes.front().second);
+        _unacked_writes.pop_front();
+    }
+}
+
+//! \details As in Van Jacobson's header prediction, almost every segment of a bulk transfer is one of
+//! two kinds, each of which only needs one half of the connection: a pure ACK that acknowledges new
+//! data (for the sender), or the next in-order data segment acknowledging nothing new (for the
+//! receiver). Both are only predicted in ESTABLISHED, for segments with no flags but ACK.
+bool TCPConnection::segment_received_predicted(const TCPSegment &seg) {
+    const auto &header = seg.header();
+    if (not header.ack or header.syn or header.fin or header.rst) {
+        return false;
+    }
+    if (not _sender.syn_acked() or _sender.fin_sent()) {
+        return false;
+    }
+
+    const int32_t unacked = _sender.next_seqno() - header.ackno;  // bytes in flight once `seg` is processed
+    if (seg.payload().size() == 0) {
+        // pure ACK: must be in sequence and acknowledge something new
+        if (_receiver.ackno() != header.seqno or unacked < 0 or
+            static_cast<size_t>(unacked) >= _sender.bytes_in_flight()) {
+            return false;
+        }
+        _sender.ack_received(header.ackno, header.win);
+        send_segments_from_sender();
+        return true;
+    }
+
+    // in-order data: with nothing in flight and the same (open) window, the sender has nothing to do
+    if (unacked != 0 or _sender.bytes_in_flight() != 0 or header.win == 0 or header.win != _sender.window_size()) {
+        return false;
+    }
+    if (not _receiver.segment_received_in_order(seg)) {
+        return false;
+    }
+    _sender.send_empty_segment();
+    send_segments_from_sender();
+    return true;
+}
+
 void TCPConnection::segment_received(const TCPSegment &seg) {
     _time_since_last_segment_received = 0;
+    ++_segments_received;
+
+    if (not segment_received_predicted(seg)) {
+        segment_received_unpredicted(seg);
+    }
+    if (not _unacked_writes.empty()) {
+        record_write_latencies();
+    }
+    if (Tracer::enabled()) {
+        trace_changes();
+    }
+}
 
+void TCPConnection::segment_received_unpredicted(const TCPSegment &seg) {
     bool ack_needed = seg.length_in_sequence_space();  // if the incoming segment occupied any sequence numbers, the
                                                        // TCPConnection makes sure that at least one segment is sent in
                                                        // reply, to reflect an update in the ackno and window size.
@@ -104,21 +191,41 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
 
 bool TCPConnection::active() const { return _is_active; }
 
-size_t TCPConnection::write(const string &data) {
+size_t TCPConnection::write(string_view data) {
     auto actual_bytes_written = _sender.stream_in().write(data);
+    data_written(actual_bytes_written);
+    return actual_bytes_written;
+}
+
+//! \param[in] len is the number of bytes stored, in order, at the start of `outbound_stream().writable_iovecs()`
+void TCPConnection::commit_write(const size_t len) {
+    _sender.stream_in().commit_write(len);
+    data_written(len);
+}
+
+void TCPConnection::data_written(const size_t len) {
+    if (_cfg.measure_latency and len > 0) {
+        _unacked_writes.emplace_back(_sender.stream_in().bytes_written(), monotonic_ns());
+    }
     // send data through sender
     _sender.fill_window();
     send_segments_from_sender();
-    return actual_bytes_written;
 }
 
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
     _time_since_last_segment_received += ms_since_last_tick;
+    const unsigned int retransmissions = _sender.consecutive_retransmissions();
     _sender.tick(ms_since_last_tick);
+    if (Tracer::enabled() and _sender.consecutive_retransmissions() > retransmissions) {
+        trace(TraceEvent::RetransmissionTimeout, _sender.stats().rto_ms, &_sender.segments_out().back());
+    }
     send_segments_from_sender();
     if (_sender.consecutive_retransmissions() > _cfg.MAX_RETX_ATTEMPTS) {
         reset(true);
+        if (Tracer::enabled()) {
+            trace_changes();
+        }
         return;
     }
 
@@ -129,6 +236,9 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
         _is_active = false;
         _linger_after_streams_finish = false;
     }
+    if (Tracer::enabled()) {
+        trace_changes();
+    }
 }
 
 void TCPConnection::end_input_stream() {
@@ -136,6 +246,9 @@ void TCPConnection::end_input_stream() {
     // FIN is needed to be send immediately. (TEST 36#,37# active_close)
     _sender.fill_window();
     send_segments_from_sender();
+    if (Tracer::enabled()) {
+        trace_changes();
+    }
 }
 
 void TCPConnection::connect() {
@@ -143,12 +256,15 @@ void TCPConnection::connect() {
     send_segments_from_sender();
 
     _is_active = true;  // connected, become active.
+    if (Tracer::enabled()) {
+        trace_changes();
+    }
 }
 
 void TCPConnection::send_segments_from_sender() {
     while (!_sender.segments_out().empty()) {
         // extract segment from _sender
-        TCPSegment seg = _sender.segments_out().front();
+        TCPSegment seg = move(_sender.segments_out().front());
         _sender.segments_out().pop();
 
         if (_receiver.ackno().has_value()) {
@@ -156,10 +272,22 @@ void TCPConnection::send_segments_from_sender() {
             seg.header().ackno = *_receiver.ackno();
             seg.header().win = _receiver.window_size();
         }
-        _segments_out.push(seg);
+        _segments_out.push(move(seg));
     }
 }
 
+//! \param[out] segments receives the segments, moved out of segments_out()
+//! \param[in] max_segments is the largest number of segments to move
+size_t TCPConnection::drain_segments(vector<TCPSegment> &segments, const size_t max_segments) {
+    size_t moved = 0;
+    while (moved < max_segments and not _segments_out.empty()) {
+        segments.push_back(move(_segments_out.front()));
+        _segments_out.pop();
+        ++moved;
+    }
+    return moved;
+}
+
 void TCPConnection::reset(bool send_reset_segment = false) {  // unclean shutdown
     _sender.stream_in().set_error();
     _receiver.stream_out().set_error();
@@ -180,6 +308,58 @@ void TCPConnection::reset(bool send_reset_segment = false) {  // unclean shutdow
     }
 }
 
+//! \param[in] event is what happened
+//! \param[in] value is the event-specific value (see TraceEvent)
+//! \param[in] seg is the segment involved, if any
+void TCPConnection::trace(const TraceEvent event, const uint32_t value, const TCPSegment *seg) {
+    if (_trace_id == 0) {
+        _trace_id = Tracer::next_connection_id();
+    }
+    TraceRecord record;
+    record.connection = _trace_id;
+    record.event = event;
+    record.value = value;
+    if (seg) {
+        record.seqno = seg->header().seqno.raw_value();
+        record.ackno = seg->header().ackno.raw_value();
+        record.length = seg->payload().size();
+    }
+    Tracer::record(record);
+}
+
+//! \details Working out the official state (see TCPState) is slow, so it is only done when a cheap
+//! summary of the sender's and receiver's progress has changed.
+void TCPConnection::trace_changes() {
+    if (_sender.window_size() != _traced_window) {
+        _traced_window = _sender.window_size();
+        trace(TraceEvent::WindowUpdate, _traced_window);
+    }
+
+    const ByteStream &inbound = _receiver.stream_out();
+    const ByteStream &outbound = _sender.stream_in();
+    const uint16_t summary = _receiver.ackno().has_value() | inbound.input_ended() << 1 | inbound.error() << 2 |
+                             (_sender.next_seqno_absolute() > 0) << 3 | _sender.syn_acked() << 4 |
+                             _sender.fin_sent() << 5 | (_sender.fin_sent() and _sender.bytes_in_flight() == 0) << 6 |
+                             outbound.error() << 7 | (not active()) << 8 | (not _linger_after_streams_finish) << 9;
+    if (summary == _traced_summary) {
+        return;
+    }
+    _traced_summary = summary;
+
+    const TCPState current = state();
+    uint8_t official = numeric_limits<uint8_t>::max();
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(TCPState::State::RESET); ++i) {
+        if (current == TCPState{static_cast<TCPState::State>(i)}) {
+            official = i;
+            break;
+        }
+    }
+    if (official != _traced_state) {
+        _traced_state = official;
+        trace(TraceEvent::StateChange, official);
+    }
+}
+
 TCPConnection::~TCPConnection() {
     try {
         if (active()) {
@@ -5,13 +5,20 @@
 #include "tcp_receiver.hh"
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
+#include "tcp_stats.hh"
+#include "tcp_trace.hh"
+
+#include <deque>
+#include <limits>
+#include <utility>
+#include <vector>
 
 //! \brief A complete endpoint of a TCP connection
 class TCPConnection {
   private:
     TCPConfig _cfg;
     TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn, _cfg.max_payload_size};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -24,12 +31,52 @@ class TCPConnection {
     /* Furthur implementation of Lab 4 */
     size_t _time_since_last_segment_received{0};
 
+    //! number of segments given to segment_received()
+    uint64_t _segments_received{0};
+
+    //! \name Latency measurement (if `_cfg.measure_latency`)
+    //!@{
+
+    //! for each write() not yet acknowledged: the outbound stream's size after it, and when it happened (in ns)
+    std::deque<std::pair<uint64_t, uint64_t>> _unacked_writes{};
+
+    //! time from each write() until the peer acknowledged its last byte
+    LatencyHistogram _write_latency{};
+
+    //! \brief Record the latency of every write() that has now been entirely acknowledged
+    void record_write_latencies();
+    //!@}
+
+    //! \brief Note the `len` bytes just added to the outbound stream, and send them if possible
+    void data_written(const size_t len);
+
     //! \brief Write data from `_sender.segments_out()` to the outbound byte stream, adding ackno & win from `-_receiver`.
     void send_segments_from_sender();
     void reset(bool);
 
+    //! \brief Header prediction: handle an in-order data segment, or a pure ACK of new data, in ESTABLISHED
+    //! \returns `false` (having done nothing) if `seg` needs the full segment_received()
+    bool segment_received_predicted(const TCPSegment &seg);
+
+    //! \brief The rest of segment_received(), for segments that header prediction doesn't handle
+    void segment_received_unpredicted(const TCPSegment &seg);
+
     bool _is_active{true};
 
+    //! \name Tracing (see Tracer)
+    //!@{
+    uint32_t _trace_id{0};        //!< This connection's id in trace events (assigned by the first one)
+    uint16_t _traced_summary{0};  //!< Cheap summary of the state, as of the last trace_changes()
+    uint8_t _traced_state{0};     //!< Official state (a TCPState::State) last traced; starts in LISTEN
+    size_t _traced_window{0};     //!< Peer's window last traced
+
+    //! \brief Record an event about this connection, and the segment involved (if any)
+    void trace(const TraceEvent event, const uint32_t value, const TCPSegment *seg = nullptr);
+
+    //! \brief Record any change of state or of the peer's window since the last call
+    void trace_changes();
+    //!@}
+
   public:
     //! \name "Input" interface for the writer
     //!@{
@@ -39,13 +86,20 @@ class TCPConnection {
 
     //! \brief Write data to the outbound byte stream, and send it over TCP if possible
     //! \returns the number of bytes from `data` that were actually written.
-    size_t write(const std::string &data);
+    size_t write(std::string_view data);
+
+    //! \brief Account for `len` bytes stored directly in outbound_stream() (see ByteStream::writable_iovecs()),
+    //! and send them over TCP if possible, as write() would have
+    void commit_write(const size_t len);
 
     //! \returns the number of `bytes` that can be written right now.
     size_t remaining_outbound_capacity() const;
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief The outbound byte stream, e.g. to set its writable watermark (write to it with write() or commit_write())
+    ByteStream &outbound_stream() { return _sender.stream_in(); }
     //!@}
 
     //! \name "Output" interface for the reader
@@ -64,10 +118,17 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Milliseconds until tick() will next act (retransmit, or stop lingering), or empty if it won't
+    //! \details Between segments, nothing but tick() changes a connection, so an owner that keeps virtual
+    //! time can skip straight to this moment (as the simulator in libsponge/sim does).
+    std::optional<size_t> time_until_next_timeout() const;
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
 
+    //! \brief Counters and gauges (segments, retransmissions, RTT, windows...) to see why a flow is slow
+    TCPStats stats() const;
+
     //! \name Methods for the owner or operating system to call
     //!@{
 
@@ -83,6 +144,11 @@ class TCPConnection {
     //! but could also be user datagrams (UDP) or any other kind).
     std::queue<TCPSegment> &segments_out() { return _segments_out; }
 
+    //! \brief Move up to `max_segments` of the queued segments (oldest first) to the end of `segments`
+    //! \returns the number of segments moved
+    size_t drain_segments(std::vector<TCPSegment> &segments,
+                          const size_t max_segments = std::numeric_limits<size_t>::max());
+
     //! \brief Is the connection still alive in any way?
     //! \returns `true` if either stream is still running or if the TCPConnection is lingering
     //! after both streams have finished (e.g. to ACK retransmissions from the peer)
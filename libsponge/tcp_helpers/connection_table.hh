@@ -0,0 +1,156 @@
+#ifndef SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+#define SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
+
+#include "four_tuple.hh"
+#include "siphash.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hash table from FourTuple to `ValueT`, using open addressing with linear probing
+//! \details All entries live in one contiguous array, so a lookup is usually a single cache miss.
+//! Erased entries leave a tombstone behind (so that later entries in the same probe sequence stay
+//! reachable); tombstones are reused by insertions and cleared whenever the table is rebuilt.
+//! The table is rebuilt (doubling in size if it is more than half full) when live entries plus
+//! tombstones reach 70% of the slots. Each table hashes with its own random key, so the peers that
+//! pick the source addresses and ports cannot predict which flows collide.
+//!
+//! Rebuilding moves the values, so pointers returned by find() and insert() are only valid until
+//! the next insertion. To keep large objects in place, use a `std::unique_ptr` as the `ValueT`.
+template <typename ValueT>
+class ConnectionTable {
+  private:
+    enum class SlotState : uint8_t { Empty, Full, Tombstone };
+
+    struct Slot {
+        FourTuple key{};
+        ValueT value{};
+        SlotState state{SlotState::Empty};
+    };
+
+    std::vector<Slot> _slots;               //!< Always a power of two in size
+    size_t _size{0};                        //!< Number of Full slots
+    size_t _tombstones{0};                  //!< Number of Tombstone slots
+    SipHashKey _key{SipHashKey::random()};  //!< Key for FourTuple::hash()
+
+    //! \returns the index of the slot holding `key`, or of the first reusable slot where it would go
+    size_t _probe(const FourTuple &key) const {
+        const size_t mask = _slots.size() - 1;
+        size_t first_tombstone = _slots.size();
+        for (size_t i = key.hash(_key) & mask;; i = (i + 1) & mask) {
+            const Slot &slot = _slots[i];
+            if (slot.state == SlotState::Empty) {
+                return first_tombstone != _slots.size() ? first_tombstone : i;
+            }
+            if (slot.state == SlotState::Tombstone) {
+                if (first_tombstone == _slots.size()) {
+                    first_tombstone = i;
+                }
+            } else if (slot.key == key) {
+                return i;
+            }
+        }
+    }
+
+    void _rebuild(const size_t new_capacity) {
+        std::vector<Slot> old_slots(new_capacity);
+        std::swap(old_slots, _slots);
+        _size = 0;
+        _tombstones = 0;
+        for (auto &slot : old_slots) {
+            if (slot.state == SlotState::Full) {
+                Slot &dest = _slots[_probe(slot.key)];
+                dest.key = slot.key;
+                dest.value = std::move(slot.value);
+                dest.state = SlotState::Full;
+                ++_size;
+            }
+        }
+    }
+
+  public:
+    //! Create a table with room for `capacity` slots (rounded up to a power of two)
+    explicit ConnectionTable(const size_t capacity = 64) : _slots() {
+        size_t rounded = 8;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        _slots.resize(rounded);
+    }
+
+    //! \returns a pointer to the value stored for `key`, or `nullptr`
+    ValueT *find(const FourTuple &key) {
+        Slot &slot = _slots[_probe(key)];
+        return slot.state == SlotState::Full ? &slot.value : nullptr;
+    }
+
+    //! Insert `value` for `key`, unless `key` is already present
+    //! \returns a pointer to the value stored for `key`, and `true` if it was inserted
+    std::pair<ValueT *, bool> insert(const FourTuple &key, ValueT &&value) {
+        if (ValueT *existing = find(key)) {
+            return {existing, false};
+        }
+        if ((_size + _tombstones + 1) * 10 > _slots.size() * 7) {
+            _rebuild(_size * 2 >= _slots.size() ? _slots.size() * 2 : _slots.size());
+        }
+        Slot &slot = _slots[_probe(key)];
+        if (slot.state == SlotState::Tombstone) {
+            --_tombstones;
+        }
+        slot.key = key;
+        slot.value = std::move(value);
+        slot.state = SlotState::Full;
+        ++_size;
+        return {&slot.value, true};
+    }
+
+    //! Remove the entry for `key`
+    //! \returns `true` if there was one
+    bool erase(const FourTuple &key) {
+        Slot &slot = _slots[_probe(key)];
+        if (slot.state != SlotState::Full) {
+            return false;
+        }
+        slot.value = ValueT{};
+        slot.state = SlotState::Tombstone;
+        --_size;
+        ++_tombstones;
+        return true;
+    }
+
+    //! Call `f(key, value)` on every entry
+    template <typename F>
+    void for_each(F &&f) {
+        for (auto &slot : _slots) {
+            if (slot.state == SlotState::Full) {
+                f(static_cast<const FourTuple &>(slot.key), slot.value);
+            }
+        }
+    }
+
+    //! Remove every entry for which `pred(key, value)` is true
+    //! \returns the number of entries removed
+    template <typename Pred>
+    size_t erase_if(Pred &&pred) {
+        size_t removed = 0;
+        for (auto &slot : _slots) {
+            if (slot.state == SlotState::Full and pred(static_cast<const FourTuple &>(slot.key), slot.value)) {
+                slot.value = ValueT{};
+                slot.state = SlotState::Tombstone;
+                --_size;
+                ++_tombstones;
+                ++removed;
+            }
+        }
+        return removed;
+    }
+
+    size_t size() const { return _size; }              //!< Number of entries
+    bool empty() const { return _size == 0; }          //!< Is the table empty?
+    size_t capacity() const { return _slots.size(); }  //!< Number of slots
+    size_t tombstones() const { return _tombstones; }  //!< Number of slots left behind by erased entries
+};
+
+#endif  // SPONGE_LIBSPONGE_CONNECTION_TABLE_HH
@@ -1,11 +1,19 @@
 #include "fd_adapter.hh"
 
+#include "tcp_trace.hh"
+
 #include <iostream>
+#include <iterator>
 #include <stdexcept>
 #include <utility>
 
 using namespace std;
 
+//! \returns the IPv4 address of `address` for a TraceRecord, or zero if it is not IPv4
+static uint32_t trace_ip(const Address &address) {
+    return address.size() == sizeof(sockaddr_in) ? address.ipv4_numeric() : 0;
+}
+
 //! \details This function first attempts to parse a TCP segment from the next UDP
 //! payload recv()d from the socket.
 //!
@@ -13,14 +21,44 @@ using namespace std;
 //! current connection. When a TCP connection has been established, this means
 //! checking that the source and destination ports in the TCP header are correct.
 //!
+//! The payload is received into a slot of TCPOverUDPSocketAdapter::_recv_pool, and the parsed
+//! segment's payload refers to that slot rather than to a copy.
+//!
 //! If the TCP FSM is listening (i.e., TCPOverUDPSocketAdapter::_listen is `true`)
 //! and the TCP segment read from the wire includes a SYN, this function clears the
 //! `_listen` flag and calls calls connect() on the underlying UDP socket, with
 //! the result that future outgoing segments go to the sender of the SYN segment.
+//!
+//! With offload on (see set_offload()), one read can yield several segments; the extras are
+//! returned by subsequent calls (or by read_many()) before the socket is read again.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
 optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
-    auto datagram = _sock.recv();
+    if (not _sock.gro()) {
+        return _parse_datagram(_sock.recv(_recv_pool));
+    }
 
+    if (_unread.empty()) {
+        _sock.recv_many(_datagrams, _recv_pool, 1);
+        for (auto &datagram : _datagrams) {
+            auto seg = _parse_datagram(move(datagram));
+            if (seg) {
+                _unread.push_back(move(seg.value()));
+            }
+        }
+        _datagrams.clear();
+    }
+
+    if (_unread.empty()) {
+        return {};
+    }
+    TCPSegment seg = move(_unread.front());
+    _unread.pop_front();
+    return seg;
+}
+
+//! \param[in] datagram is a datagram received from the UDP socket
+//! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated (see read())
+optional<TCPSegment> TCPOverUDPSocketAdapter::_parse_datagram(UDPSocket::pooled_datagram &&datagram) {
     // is it for us?
     if (not listening() and (datagram.source_address != config().destination)) {
         return {};
@@ -42,6 +80,10 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
         }
     }
 
+    if (Tracer::enabled()) {
+        Tracer::segment(
+            TraceEvent::SegmentReceived, seg, trace_ip(datagram.source_address), trace_ip(config().source));
+    }
     return seg;
 }
 
@@ -50,8 +92,102 @@ optional<TCPSegment> TCPOverUDPSocketAdapter::read() {
 void TCPOverUDPSocketAdapter::write(TCPSegment &seg) {
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentSent, seg, trace_ip(config().source), trace_ip(config().destination));
+    }
     _sock.sendto(config().destination, seg.serialize(0));
 }
 
+//! \param[out] segments is replaced by the valid, related TCP segments received, in order
+//! \param[in] max_segments is the largest number of datagrams to receive
+//! \details The datagrams are received with one call to UDPSocket::recv_many, and each is then
+//! filtered exactly as in read(). This can return no segments if none of the datagrams were valid.
+void TCPOverUDPSocketAdapter::read_many(vector<TCPSegment> &segments, const size_t max_segments) {
+    segments.clear();
+    if (not _unread.empty()) {
+        segments.insert(segments.end(), make_move_iterator(_unread.begin()), make_move_iterator(_unread.end()));
+        _unread.clear();
+        return;
+    }
+
+    _sock.recv_many(_datagrams, _recv_pool, max_segments);
+    for (auto &datagram : _datagrams) {
+        auto seg = _parse_datagram(move(datagram));
+        if (seg) {
+            segments.push_back(move(seg.value()));
+        }
+    }
+    _datagrams.clear();
+}
+
+//! \param[in] destination is the UDP address of the peer
+//! \param[in] sport is the source port to set in each segment
+//! \param[in] dport is the destination port to set in each segment
+//! \param[in] segments are the TCP segments to write
+void TCPOverUDPSocketAdapter::_send_many(const Address &destination,
+                                         const uint16_t sport,
+                                         const uint16_t dport,
+                                         vector<TCPSegment> &segments) {
+    vector<BufferList> serialized;
+    serialized.reserve(segments.size());
+    const bool tracing = Tracer::enabled();
+    for (auto &seg : segments) {
+        seg.header().sport = sport;
+        seg.header().dport = dport;
+        if (tracing) {
+            Tracer::segment(TraceEvent::SegmentSent, seg, trace_ip(config().source), trace_ip(destination));
+        }
+        serialized.push_back(seg.serialize(0));
+    }
+    _sock.send_many(destination, {serialized.begin(), serialized.end()});
+}
+
+//! \param[in] segments are the TCP segments to write (their ports are filled in, as in write())
+void TCPOverUDPSocketAdapter::write_many(vector<TCPSegment> &segments) {
+    _send_many(config().destination, config().source.port(), config().destination.port(), segments);
+}
+
+//! \param[out] segments is replaced by the valid TCP segments received, in order, each tagged with its flow
+//! \param[in] max_segments is the largest number of datagrams to receive
+void TCPOverUDPSocketAdapter::read_from(vector<AddressedSegment> &segments, const size_t max_segments) {
+    segments.clear();
+    const uint32_t local_ip = config().source.ipv4_numeric();
+    const uint16_t local_port = config().source.port();
+
+    _sock.recv_many(_datagrams, _recv_pool, max_segments);
+    for (auto &datagram : _datagrams) {
+        TCPSegment seg;
+        if (ParseResult::NoError != seg.parse(move(datagram.payload), 0)) {
+            continue;
+        }
+        const Address &peer = datagram.source_address;
+        if (Tracer::enabled()) {
+            Tracer::segment(TraceEvent::SegmentReceived, seg, peer.ipv4_numeric(), local_ip);
+        }
+        segments.push_back({{peer.ipv4_numeric(), local_ip, peer.port(), local_port}, move(seg)});
+    }
+    _datagrams.clear();
+}
+
+//! \param[in] flow identifies the connection (and so the UDP address of the peer)
+//! \param[in] seg is the TCP segment to write
+void TCPOverUDPSocketAdapter::write_to(const FourTuple &flow, TCPSegment &seg) {
+    seg.header().sport = flow.dst_port;
+    seg.header().dport = flow.src_port;
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentSent, seg, flow.dst_ip, flow.src_ip);
+    }
+    _sock.sendto(flow.remote_address(), seg.serialize(0));
+}
+
+//! \param[in] flow identifies the connection (and so the UDP address of the peer)
+//! \param[in] segments are the TCP segments to write (their ports are set from `flow`, as in write_to())
+void TCPOverUDPSocketAdapter::write_many_to(const FourTuple &flow, vector<TCPSegment> &segments) {
+    _send_many(flow.remote_address(), flow.dst_port, flow.src_port, segments);
+}
+
 //! Specialize LossyFdAdapter to TCPOverUDPSocketAdapter
 template class LossyFdAdapter<TCPOverUDPSocketAdapter>;
+
+//! Specialize NetemFdAdapter to LossyTCPOverUDPSocketAdapter
+template class NetemFdAdapter<LossyTCPOverUDPSocketAdapter>;
@@ -2,14 +2,18 @@
 #define SPONGE_LIBSPONGE_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "four_tuple.hh"
 #include "lossy_fd_adapter.hh"
+#include "netem_fd_adapter.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_header.hh"
 #include "tcp_segment.hh"
 
+#include <deque>
 #include <optional>
 #include <utility>
+#include <vector>
 
 //! \brief Basic functionality for file descriptor adaptors
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
@@ -44,9 +48,34 @@ class FdAdapterBase {
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
 class TCPOverUDPSocketAdapter : public FdAdapterBase {
+  public:
+    //! Slots in the receive BufferPool are sized for the largest datagram on the loopback interface
+    static constexpr size_t RECV_SLOT_SIZE = 65536;
+
+    //! Number of slots in the receive BufferPool
+    static constexpr size_t RECV_SLOT_COUNT = 64;
+
   private:
     UDPSocket _sock;
 
+    //! Storage for received datagrams (only touched by the thread that calls read())
+    BufferPool _recv_pool{RECV_SLOT_COUNT, RECV_SLOT_SIZE};
+
+    //! Datagrams received by the latest read_many() (kept to reuse its allocation)
+    std::vector<UDPSocket::pooled_datagram> _datagrams{};
+
+    //! Segments received by read() in GRO mode but not yet returned
+    std::deque<TCPSegment> _unread{};
+
+    //! Filter and parse one received datagram
+    std::optional<TCPSegment> _parse_datagram(UDPSocket::pooled_datagram &&datagram);
+
+    //! Write a batch of TCP segments (with the given ports) to `destination`
+    void _send_many(const Address &destination,
+                    const uint16_t sport,
+                    const uint16_t dport,
+                    std::vector<TCPSegment> &segments);
+
   public:
     //! Construct from a UDPSocket sliced into a FileDescriptor
     explicit TCPOverUDPSocketAdapter(UDPSocket &&sock) : _sock(std::move(sock)) {}
@@ -57,6 +86,30 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
     //! Writes a TCP segment into a UDP payload
     void write(TCPSegment &seg);
 
+    //! Attempts to read up to `max_segments` TCP segments related to the current connection, with one system call
+    void read_many(std::vector<TCPSegment> &segments, const size_t max_segments);
+
+    //! Writes a batch of TCP segments, each into its own UDP payload, with as few system calls as possible
+    void write_many(std::vector<TCPSegment> &segments);
+
+    //! \brief Read up to `max_segments` valid TCP segments from any peer, with one system call
+    //! \details Unlike read(), this ignores the listening flag and the configured destination (e.g. for TCPStack)
+    void read_from(std::vector<AddressedSegment> &segments, const size_t max_segments);
+
+    //! Writes a TCP segment to the peer of `flow` (with the ports set from `flow`)
+    void write_to(const FourTuple &flow, TCPSegment &seg);
+
+    //! Addressed version of write_many()
+    void write_many_to(const FourTuple &flow, std::vector<TCPSegment> &segments);
+
+    //! \brief Turn UDP segmentation offload on or off (GSO for write_many(), GRO for reads)
+    //! \details Works best with a sender that emits bursts of full-size segments, which GSO can send
+    //! as one `sendmsg` and GRO can receive as one coalesced datagram.
+    void set_offload(const bool enabled) {
+        _sock.set_gso(enabled);
+        _sock.set_gro(enabled);
+    }
+
     //! Access the underlying UDP socket
     operator UDPSocket &() { return _sock; }
 
@@ -67,4 +120,7 @@ class TCPOverUDPSocketAdapter : public FdAdapterBase {
 //! Typedef for TCPOverUDPSocketAdapter
 using LossyTCPOverUDPSocketAdapter = LossyFdAdapter<TCPOverUDPSocketAdapter>;
 
+//! Typedef for a LossyTCPOverUDPSocketAdapter whose outbound segments go through a NetworkEmulator
+using NetemTCPOverUDPSocketAdapter = NetemFdAdapter<LossyTCPOverUDPSocketAdapter>;
+
 #endif  // SPONGE_LIBSPONGE_FD_ADAPTER_HH
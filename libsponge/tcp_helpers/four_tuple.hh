@@ -0,0 +1,56 @@
+#ifndef SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+#define SPONGE_LIBSPONGE_FOUR_TUPLE_HH
+
+#include "address.hh"
+#include "siphash.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+//! \brief The (source IP, source port, destination IP, destination port) that identifies a TCP connection
+//! \details A FourTuple is always written from the point of view of an *inbound* segment: the
+//! source is the remote peer and the destination is the local end. Addresses and ports are in host
+//! byte order. For TCP-over-UDP, the UDP addresses stand in for the IP addresses and TCP ports (as
+//! in TCPOverUDPSocketAdapter, the TCP ports are always set to match the UDP ports).
+struct FourTuple {
+    uint32_t src_ip{};    //!< Remote IPv4 address
+    uint32_t dst_ip{};    //!< Local IPv4 address
+    uint16_t src_port{};  //!< Remote port
+    uint16_t dst_port{};  //!< Local port
+
+    //! Build from the remote and local addresses (which must be IPv4)
+    static FourTuple from_addresses(const Address &remote, const Address &local) {
+        return {remote.ipv4_numeric(), local.ipv4_numeric(), remote.port(), local.port()};
+    }
+
+    Address remote_address() const { return Address::from_ipv4_numeric(src_ip, src_port); }  //!< The peer
+    Address local_address() const { return Address::from_ipv4_numeric(dst_ip, dst_port); }   //!< The local end
+
+    bool operator==(const FourTuple &other) const {
+        return src_ip == other.src_ip and dst_ip == other.dst_ip and src_port == other.src_port and
+               dst_port == other.dst_port;
+    }
+    bool operator!=(const FourTuple &other) const { return not operator==(other); }
+
+    //! \brief The SipHash of the four fields under `key`
+    //! \details Keyed, so that a peer that can choose its address and port cannot choose where the flow lands
+    //! in a hash table (and, e.g., make every flow collide).
+    uint64_t hash(const SipHashKey &key) const {
+        char input[12];
+        std::memcpy(input, &src_ip, 4);
+        std::memcpy(input + 4, &dst_ip, 4);
+        std::memcpy(input + 8, &src_port, 2);
+        std::memcpy(input + 10, &dst_port, 2);
+        return siphash24(key, {input, sizeof(input)});
+    }
+};
+
+//! A TCP segment together with the connection it belongs to (see the addressed reads of the FD adapters)
+struct AddressedSegment {
+    FourTuple flow;      //!< The connection, as seen by an inbound segment
+    TCPSegment segment;  //!< The segment itself
+};
+
+#endif  // SPONGE_LIBSPONGE_FOUR_TUPLE_HH
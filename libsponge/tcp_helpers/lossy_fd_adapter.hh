@@ -2,13 +2,16 @@
 #define SPONGE_LIBSPONGE_LOSSY_FD_ADAPTER_HH
 
 #include "file_descriptor.hh"
+#include "four_tuple.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <optional>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template <typename AdapterT>
@@ -56,6 +59,52 @@ class LossyFdAdapter {
         return _adapter.write(seg);
     }
 
+    //! \brief Read a batch from the underlying AdapterT instance, then drop each segment with the downlink loss rate
+    //! \param[out] segments is replaced by the segments that survived
+    //! \param[in] max_segments is passed to the underlying AdapterT
+    void read_many(std::vector<TCPSegment> &segments, const size_t max_segments) {
+        _adapter.read_many(segments, max_segments);
+        segments.erase(
+            std::remove_if(segments.begin(), segments.end(), [&](const TCPSegment &) { return _should_drop(false); }),
+            segments.end());
+    }
+
+    //! \brief Drop each segment with the uplink loss rate, then write the rest to the underlying AdapterT instance
+    //! \param[in] segments are the segments to either write or drop (dropped ones are removed)
+    void write_many(std::vector<TCPSegment> &segments) {
+        segments.erase(
+            std::remove_if(segments.begin(), segments.end(), [&](const TCPSegment &) { return _should_drop(true); }),
+            segments.end());
+        if (not segments.empty()) {
+            _adapter.write_many(segments);
+        }
+    }
+
+    //! \brief Addressed version of read_many(), with the same downlink losses
+    void read_from(std::vector<AddressedSegment> &segments, const size_t max_segments) {
+        _adapter.read_from(segments, max_segments);
+        const auto dropped = [&](const AddressedSegment &) { return _should_drop(false); };
+        segments.erase(std::remove_if(segments.begin(), segments.end(), dropped), segments.end());
+    }
+
+    //! \brief Addressed version of write(), with the same uplink losses
+    void write_to(const FourTuple &flow, TCPSegment &seg) {
+        if (_should_drop(true)) {
+            return;
+        }
+        _adapter.write_to(flow, seg);
+    }
+
+    //! \brief Addressed version of write_many(), with the same uplink losses
+    void write_many_to(const FourTuple &flow, std::vector<TCPSegment> &segments) {
+        segments.erase(
+            std::remove_if(segments.begin(), segments.end(), [&](const TCPSegment &) { return _should_drop(true); }),
+            segments.end());
+        if (not segments.empty()) {
+            _adapter.write_many_to(flow, segments);
+        }
+    }
+
     //! \name
     //! Passthrough functions to the underlying AdapterT instance
 
@@ -0,0 +1,69 @@
+#ifndef SPONGE_LIBSPONGE_MEMORY_ADAPTER_HH
+#define SPONGE_LIBSPONGE_MEMORY_ADAPTER_HH
+
+#include "event_fd.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <utility>
+#include <vector>
+
+//! \brief An adapter whose "network" is a pair of in-memory queues, played by the owner
+//! \details The owner queues segments for the adapter's user to read with deliver(), and collects
+//! what it wrote from sent(). This makes it possible to drive a TCPStack segment by segment, e.g.
+//! in a test. So that the adapter can be polled like the others, it converts to an eventfd that is
+//! readable whenever delivered segments are waiting.
+class MemoryAdapter : public FdAdapterBase {
+  private:
+    EventFD _readable{};                      //!< Readable while `_inbound` is not empty
+    bool _signalled{false};                   //!< Has `_readable` been notified since it was last consumed?
+    std::deque<AddressedSegment> _inbound{};  //!< Segments waiting for read_from()
+    std::deque<AddressedSegment> _sent{};     //!< Segments written, oldest first
+
+  public:
+    MemoryAdapter() { _readable.set_blocking(false); }
+
+    //! Conversion to a FileDescriptor (the eventfd)
+    operator const FileDescriptor &() const { return _readable; }
+
+    //! Queue `segment` to be read from `flow` (as seen by an inbound segment)
+    void deliver(const FourTuple &flow, const TCPSegment &segment) {
+        _inbound.push_back({flow, segment});
+        if (not _signalled) {
+            _readable.notify();
+            _signalled = true;
+        }
+    }
+
+    //! Segments written so far and not yet removed by the owner, oldest first
+    std::deque<AddressedSegment> &sent() { return _sent; }
+
+    //! Move up to `max_segments` delivered segments into `segments`
+    void read_from(std::vector<AddressedSegment> &segments, const size_t max_segments) {
+        const size_t count = std::min(max_segments, _inbound.size());
+        for (size_t i = 0; i < count; ++i) {
+            segments.push_back(std::move(_inbound.front()));
+            _inbound.pop_front();
+        }
+        if (_inbound.empty() and _signalled) {
+            _readable.consume();
+            _signalled = false;
+        }
+    }
+
+    //! Record a segment written to the peer of `flow`
+    void write_to(const FourTuple &flow, TCPSegment &seg) { _sent.push_back({flow, seg}); }
+
+    //! Record a batch of segments written to the peer of `flow`
+    void write_many_to(const FourTuple &flow, std::vector<TCPSegment> &segments) {
+        for (auto &seg : segments) {
+            write_to(flow, seg);
+        }
+    }
+};
+
+#endif  // SPONGE_LIBSPONGE_MEMORY_ADAPTER_HH
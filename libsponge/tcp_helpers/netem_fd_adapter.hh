@@ -0,0 +1,135 @@
+#ifndef SPONGE_LIBSPONGE_NETEM_FD_ADAPTER_HH
+#define SPONGE_LIBSPONGE_NETEM_FD_ADAPTER_HH
+
+#include "file_descriptor.hh"
+#include "four_tuple.hh"
+#include "network_emulator.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <optional>
+#include <utility>
+#include <vector>
+
+//! \brief An adapter class that sends an FD adapter's outbound segments through a NetworkEmulator
+//! \details Like `netem` on a Linux interface, the emulation applies to outbound segments only: to
+//! emulate a path in both directions, emulate it at both ends. Segments that the emulator delays
+//! are written to the underlying adapter by a later write or tick(), so the delays are only as fine
+//! as the owner's ticks (TCPSpongeSocket ticks at least every 10 ms). With a transparent
+//! NetemConfig, segments pass straight through.
+template <typename AdapterT>
+class NetemFdAdapter {
+  private:
+    //! The underlying FD adapter
+    AdapterT _adapter;
+
+    //! The emulated path
+    NetworkEmulator _emulator;
+
+    //! Segments that have come out of the emulator (kept to reuse the allocations)
+    std::vector<NetworkEmulator::Packet> _ready{};
+
+    //! Unaddressed segments on their way to the underlying write_many()
+    std::vector<TCPSegment> _batch{};
+
+    //! Write every segment that has come out of the emulator to the underlying AdapterT instance
+    void _flush() {
+        _emulator.take_ready(_ready);
+        for (auto &packet : _ready) {
+            if (packet.flow) {
+                _adapter.write_to(packet.flow.value(), packet.segment);
+            } else {
+                _batch.push_back(std::move(packet.segment));
+            }
+        }
+        _ready.clear();
+        if (not _batch.empty()) {
+            _adapter.write_many(_batch);
+            _batch.clear();
+        }
+    }
+
+  public:
+    //! Conversion to a FileDescriptor by returning the underlying AdapterT
+    operator const FileDescriptor &() const { return _adapter; }
+
+    //! Construct from the adapter to wrap, and the path to emulate
+    explicit NetemFdAdapter(AdapterT &&adapter, const NetemConfig &netem = {})
+        : _adapter(std::move(adapter)), _emulator(netem) {}
+
+    //! \name Reads (passed through)
+    //!@{
+    std::optional<TCPSegment> read() { return _adapter.read(); }
+    void read_many(std::vector<TCPSegment> &segments, const size_t max_segments) {
+        _adapter.read_many(segments, max_segments);
+    }
+    void read_from(std::vector<AddressedSegment> &segments, const size_t max_segments) {
+        _adapter.read_from(segments, max_segments);
+    }
+    //!@}
+
+    //! \name Writes (through the emulator)
+    //!@{
+
+    //! \brief Send `seg` through the emulator, and write whatever has come out of it
+    void write(TCPSegment &seg) {
+        if (_emulator.config().transparent()) {
+            return _adapter.write(seg);
+        }
+        _emulator.send(seg);
+        _flush();
+    }
+
+    //! \brief Send each of `segments` through the emulator, and write whatever has come out of it
+    void write_many(std::vector<TCPSegment> &segments) {
+        if (_emulator.config().transparent()) {
+            return _adapter.write_many(segments);
+        }
+        for (const auto &seg : segments) {
+            _emulator.send(seg);
+        }
+        _flush();
+    }
+
+    //! \brief Addressed version of write()
+    void write_to(const FourTuple &flow, TCPSegment &seg) {
+        if (_emulator.config().transparent()) {
+            return _adapter.write_to(flow, seg);
+        }
+        _emulator.send(seg, flow);
+        _flush();
+    }
+
+    //! \brief Addressed version of write_many()
+    void write_many_to(const FourTuple &flow, std::vector<TCPSegment> &segments) {
+        if (_emulator.config().transparent()) {
+            return _adapter.write_many_to(flow, segments);
+        }
+        for (const auto &seg : segments) {
+            _emulator.send(seg, flow);
+        }
+        _flush();
+    }
+    //!@}
+
+    //! \brief Advance the emulator's clock, and write the segments that are now due
+    void tick(const size_t ms_since_last_tick) {
+        _adapter.tick(ms_since_last_tick);
+        _emulator.tick(ms_since_last_tick);
+        _flush();
+    }
+
+    //! \brief What the emulator has done so far
+    NetemStats netem_stats() const { return _emulator.stats(); }
+
+    //! \name
+    //! Passthrough functions to the underlying AdapterT instance
+
+    //!@{
+    void set_listening(const bool l) { _adapter.set_listening(l); }      //!< FdAdapterBase::set_listening passthrough
+    const FdAdapterConfig &config() const { return _adapter.config(); }  //!< FdAdapterBase::config passthrough
+    FdAdapterConfig &config_mut() { return _adapter.config_mut(); }      //!< FdAdapterBase::config_mut passthrough
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_NETEM_FD_ADAPTER_HH
@@ -0,0 +1,229 @@
+#include "network_emulator.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! Below this many queued bytes (about one full-size packet), CoDel never drops
+static constexpr size_t CODEL_MIN_QUEUE_BYTES = 1500;
+
+//! \param[in] config is the settings to emulate
+NetworkEmulator::NetworkEmulator(const NetemConfig &config) : _cfg(config), _rng(config.seed) {}
+
+//! \param[in] segment is the segment to send (it is copied, with its payload shared)
+//! \param[in] flow is the connection it belongs to, if it is to be written with write_to()
+void NetworkEmulator::send(const TCPSegment &segment, const optional<FourTuple> &flow) {
+    ++_stats.segments_sent;
+    if (_cfg.loss > 0 and _coin(_rng) < _cfg.loss) {
+        ++_stats.dropped_loss;
+        return;
+    }
+    unsigned int copies = 1;
+    if (_cfg.duplicate > 0 and _coin(_rng) < _cfg.duplicate) {
+        ++_stats.duplicated;
+        copies = 2;
+    }
+
+    const size_t size = segment.header().doff * 4 + segment.payload().size();
+    for (unsigned int i = 0; i < copies; ++i) {
+        Packet packet{flow, segment, size, _now_ns};
+        if (_cfg.rate_bps == 0) {
+            _propagate(move(packet), _now_ns);
+        } else if (_stats.queue_bytes + size > _cfg.queue_bytes) {
+            ++_stats.dropped_queue;
+        } else {
+            _stats.queue_bytes += size;
+            _queue.push_back(move(packet));
+        }
+    }
+    _serve_queue();
+}
+
+//! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
+void NetworkEmulator::tick(const size_t ms_since_last_tick) { advance_to(_now_ns + ms_since_last_tick * 1000000); }
+
+//! \param[in] now_ns is the new time
+void NetworkEmulator::advance_to(const uint64_t now_ns) {
+    _now_ns = max(_now_ns, now_ns);
+    _serve_queue();
+}
+
+optional<uint64_t> NetworkEmulator::next_event_ns() const {
+    optional<uint64_t> ret;
+    if (not _in_flight.empty()) {
+        ret = _in_flight.begin()->first;
+    }
+    if (not _queue.empty()) {
+        const uint64_t start_ns = max(_link_free_ns, _queue.front().time_ns);
+        ret = min(ret.value_or(start_ns), start_ns);
+    }
+    return ret;
+}
+
+//! \param[out] packets has the segments that are due appended to it
+void NetworkEmulator::take_ready(vector<Packet> &packets) {
+    while (not _in_flight.empty() and _in_flight.begin()->first <= _now_ns) {
+        packets.push_back(move(_in_flight.begin()->second));
+        _in_flight.erase(_in_flight.begin());
+        ++_stats.segments_delivered;
+    }
+}
+
+NetemStats NetworkEmulator::stats() const { return _stats; }
+
+//! \details The link serializes the queue's segments back to back, so the head of the queue leaves
+//! when the link has finished with the previous segment (or when the head arrived, if later).
+void NetworkEmulator::_serve_queue() {
+    while (not _queue.empty()) {
+        const uint64_t start_ns = max(_link_free_ns, _queue.front().time_ns);
+        if (start_ns > _now_ns) {
+            break;
+        }
+        Packet packet = move(_queue.front());
+        _queue.pop_front();
+        _stats.queue_bytes -= packet.size;
+
+        if (_cfg.queue == NetemConfig::QueueDiscipline::CoDel and _codel_drop(packet, start_ns)) {
+            ++_stats.dropped_codel;
+            continue;
+        }
+        _link_free_ns = start_ns + packet.size * uint64_t{8000000000} / _cfg.rate_bps;
+        _propagate(move(packet), _link_free_ns);
+    }
+}
+
+//! \details This is the dequeue side of CoDel, as in the pseudocode of RFC 8289, applied to one
+//! packet at a time: once the sojourn time has stayed above the target for a whole interval, drop
+//! a packet, and then keep dropping, at intervals that shrink with the square root of the number
+//! of drops, until the sojourn time falls below the target.
+bool NetworkEmulator::_codel_drop(const Packet &packet, const uint64_t now_ns) {
+    const uint64_t target_ns = _cfg.codel_target_us * 1000;
+    const uint64_t interval_ns = _cfg.codel_interval_us * 1000;
+    const auto control_law = [&](const uint64_t t) {
+        return t + static_cast<uint64_t>(interval_ns / sqrt(static_cast<double>(_drop_count)));
+    };
+
+    bool ok_to_drop = false;
+    if (now_ns - packet.time_ns < target_ns or _stats.queue_bytes <= CODEL_MIN_QUEUE_BYTES) {
+        _first_above_ns = 0;
+    } else if (_first_above_ns == 0) {
+        _first_above_ns = now_ns + interval_ns;
+    } else {
+        ok_to_drop = now_ns >= _first_above_ns;
+    }
+
+    if (_dropping) {
+        if (not ok_to_drop) {
+            _dropping = false;
+            return false;
+        }
+        if (now_ns < _drop_next_ns) {
+            return false;
+        }
+        ++_drop_count;
+        _drop_next_ns = control_law(_drop_next_ns);
+        return true;
+    }
+
+    if (not ok_to_drop) {
+        return false;
+    }
+    // if the dropping state was left recently, resume at about the rate it ended with
+    const uint32_t delta = _drop_count - _last_drop_count;
+    _drop_count = (delta > 1 and now_ns < _drop_next_ns + 16 * interval_ns) ? delta : 1;
+    _dropping = true;
+    _drop_next_ns = control_law(now_ns);
+    _last_drop_count = _drop_count;
+    return true;
+}
+
+//! \param[in] packet is the segment that has crossed the bottleneck
+//! \param[in] time_ns is when it did
+void NetworkEmulator::_propagate(Packet &&packet, const uint64_t time_ns) {
+    int64_t delay_ns = _cfg.delay_ms * 1000000;
+    if (_cfg.reorder > 0 and _coin(_rng) < _cfg.reorder) {
+        ++_stats.reordered;
+        delay_ns = 0;
+    } else if (_cfg.jitter_ms > 0) {
+        const double jitter_ns = _cfg.jitter_ms * 1e6 * (2 * _coin(_rng) - 1);
+        delay_ns = max(int64_t{0}, delay_ns + static_cast<int64_t>(jitter_ns));
+    }
+    packet.time_ns = time_ns + delay_ns;
+    _in_flight.emplace(packet.time_ns, move(packet));
+}
+
+//! \param[in] value is a number, optionally followed by k, M or G
+static double parse_rate(const string &value) {
+    char *end = nullptr;
+    double rate = strtod(value.c_str(), &end);
+    const string suffix = end;
+    if (suffix == "k") {
+        rate *= 1e3;
+    } else if (suffix == "M") {
+        rate *= 1e6;
+    } else if (suffix == "G") {
+        rate *= 1e9;
+    } else if (not suffix.empty()) {
+        throw runtime_error("netem: bad rate \"" + value + "\"");
+    }
+    return rate;
+}
+
+//! \param[in] spec is e.g. "delay=40,jitter=5,loss=0.01,rate=20M,aqm=codel"
+NetemConfig parse_netem_config(const string &spec) {
+    NetemConfig config;
+    stringstream ss{spec};
+    string item;
+    while (getline(ss, item, ',')) {
+        const auto equals = item.find('=');
+        if (equals == string::npos) {
+            throw runtime_error("netem: expected key=value, got \"" + item + "\"");
+        }
+        const string key = item.substr(0, equals);
+        const string value = item.substr(equals + 1);
+        char *end = nullptr;
+        const double number = strtod(value.c_str(), &end);
+        const bool numeric = not value.empty() and *end == '\0' and number >= 0;
+        if (key != "rate" and key != "aqm" and not numeric) {
+            throw runtime_error("netem: bad value \"" + value + "\" for " + key);
+        }
+
+        if (key == "delay") {
+            config.delay_ms = number;
+        } else if (key == "jitter") {
+            config.jitter_ms = number;
+        } else if (key == "loss") {
+            config.loss = number;
+        } else if (key == "duplicate") {
+            config.duplicate = number;
+        } else if (key == "reorder") {
+            config.reorder = number;
+        } else if (key == "rate") {
+            config.rate_bps = parse_rate(value);
+        } else if (key == "queue") {
+            config.queue_bytes = number;
+        } else if (key == "aqm") {
+            if (value == "droptail") {
+                config.queue = NetemConfig::QueueDiscipline::DropTail;
+            } else if (value == "codel") {
+                config.queue = NetemConfig::QueueDiscipline::CoDel;
+            } else {
+                throw runtime_error("netem: aqm must be droptail or codel");
+            }
+        } else if (key == "target") {
+            config.codel_target_us = number * 1000;
+        } else if (key == "interval") {
+            config.codel_interval_us = number * 1000;
+        } else if (key == "seed") {
+            config.seed = number;
+        } else {
+            throw runtime_error("netem: unknown setting \"" + key + "\"");
+        }
+    }
+    return config;
+}
@@ -0,0 +1,119 @@
+#ifndef SPONGE_LIBSPONGE_NETWORK_EMULATOR_HH
+#define SPONGE_LIBSPONGE_NETWORK_EMULATOR_HH
+
+#include "four_tuple.hh"
+#include "tcp_config.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+//! What a NetworkEmulator has done to the segments sent through it
+struct NetemStats {
+    uint64_t segments_sent{0};       //!< Segments given to send()
+    uint64_t segments_delivered{0};  //!< Segments that came out (duplicates included)
+    uint64_t dropped_loss{0};        //!< Segments dropped at random (NetemConfig::loss)
+    uint64_t dropped_queue{0};       //!< Segments dropped because the bottleneck queue was full
+    uint64_t dropped_codel{0};       //!< Segments dropped by CoDel
+    uint64_t duplicated{0};          //!< Segments sent twice
+    uint64_t reordered{0};           //!< Segments that skipped the propagation delay
+    size_t queue_bytes{0};           //!< Gauge: bytes waiting in the bottleneck queue
+};
+
+//! \brief A one-way path with a bottleneck link and a propagation delay, like Linux's `netem`
+//! \details A segment given to send() is first dropped or duplicated at random. It then waits in the
+//! bottleneck queue until the link (of NetemConfig::rate_bps) has serialized the segments ahead of it,
+//! and then spends the propagation delay (plus or minus the jitter, or nothing if it is reordered) in
+//! flight. Segments whose delays end out of order come out out of order.
+//!
+//! Time only advances with tick(), and every random choice comes from a generator seeded with
+//! NetemConfig::seed, so a given sequence of calls always gives the same result. Times are kept in
+//! nanoseconds, so that a fast link can serialize many segments per millisecond tick.
+class NetworkEmulator {
+  public:
+    //! A segment on its way through the emulator
+    struct Packet {
+        std::optional<FourTuple> flow;  //!< The connection, for an addressed write (see FdAdapters' write_to())
+        TCPSegment segment;             //!< The segment
+        size_t size;                    //!< Bytes that the segment occupies on the link
+        uint64_t time_ns;               //!< When it entered the queue (or, once in flight, when it leaves)
+    };
+
+  private:
+    NetemConfig _cfg;
+    std::mt19937 _rng;
+    std::uniform_real_distribution<double> _coin{0, 1};
+
+    uint64_t _now_ns{0};  //!< The sum of every tick()
+
+    std::deque<Packet> _queue{};  //!< The bottleneck queue
+    uint64_t _link_free_ns{0};    //!< When the link will have finished serializing its current segment
+
+    //! Segments past the bottleneck, by the time they come out (in order of arrival, for equal times)
+    std::multimap<uint64_t, Packet> _in_flight{};
+
+    //! \name CoDel's state (see RFC 8289)
+    //!@{
+    uint64_t _first_above_ns{0};   //!< When the sojourn time will have been above target for an interval
+    uint64_t _drop_next_ns{0};     //!< When the next drop is due, in the dropping state
+    uint32_t _drop_count{0};       //!< Drops since entering the dropping state
+    uint32_t _last_drop_count{0};  //!< `_drop_count` when the dropping state was last entered
+    bool _dropping{false};         //!< In the dropping state?
+    //!@}
+
+    NetemStats _stats{};
+
+    //! Move every segment that the link has started to serialize by now from the queue into flight
+    void _serve_queue();
+
+    //! Should CoDel drop `packet`, which leaves the queue at `now_ns`?
+    bool _codel_drop(const Packet &packet, const uint64_t now_ns);
+
+    //! Start the propagation delay of `packet`, which left the link at `time_ns`
+    void _propagate(Packet &&packet, const uint64_t time_ns);
+
+  public:
+    //! Create an emulator with the given settings
+    explicit NetworkEmulator(const NetemConfig &config);
+
+    //! Send a segment through the emulator (optionally with the connection it belongs to)
+    void send(const TCPSegment &segment, const std::optional<FourTuple> &flow = {});
+
+    //! Notifies the emulator of the passage of time
+    void tick(const size_t ms_since_last_tick);
+
+    //! Advance the emulator's clock to `now_ns` (which must not be in its past)
+    void advance_to(const uint64_t now_ns);
+
+    //! The emulator's clock, in nanoseconds since it was created
+    uint64_t now_ns() const { return _now_ns; }
+
+    //! When a segment will next leave the queue or come out of the emulator, or empty if it holds none
+    std::optional<uint64_t> next_event_ns() const;
+
+    //! Move the segments that have come out of the emulator (in the order they did) to the end of `packets`
+    void take_ready(std::vector<Packet> &packets);
+
+    //! Are any segments still in the emulator?
+    bool empty() const { return _queue.empty() and _in_flight.empty(); }
+
+    //! The settings
+    const NetemConfig &config() const { return _cfg; }
+
+    //! Counters of what the emulator has done
+    NetemStats stats() const;
+};
+
+//! \brief Parse a comma-separated list of `key=value` settings into a NetemConfig
+//! \details The keys are delay and jitter (ms), loss, duplicate and reorder (probabilities), rate (bits/s,
+//! with an optional k, M or G suffix), queue (bytes), aqm (droptail or codel), target and interval (CoDel's,
+//! in ms) and seed; e.g. "delay=40,jitter=5,rate=20M,aqm=codel". Throws std::runtime_error if it can't.
+NetemConfig parse_netem_config(const std::string &spec);
+
+#endif  // SPONGE_LIBSPONGE_NETWORK_EMULATOR_HH
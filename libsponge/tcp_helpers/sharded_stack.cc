@@ -0,0 +1,118 @@
+#include "sharded_stack.hh"
+
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+//! Receive buffer for each shard's socket, which is shared by all of the shard's peers
+static constexpr int SHARD_RECEIVE_BUFFER = 4 << 20;
+
+//! \param[in] config configures the shards and their connections
+//! \param[in] make_adapter makes each shard's adapter
+//! \param[in] service is called on each worker after every event or tick
+//! \param[in] setup is called once on each worker before its first event
+template <typename AdaptT>
+ShardedStack<AdaptT>::ShardedStack(const ShardedStackConfig &config,
+                                   AdapterFactory make_adapter,
+                                   ServiceHandler service,
+                                   SetupHandler setup)
+    : _config(config), _make_adapter(move(make_adapter)), _setup(move(setup)), _service(move(service)) {
+    if (_config.shards == 0) {
+        throw runtime_error("ShardedStack: need at least one shard");
+    }
+    _errors.resize(_config.shards);
+    _workers.reserve(_config.shards);
+    try {
+        for (size_t i = 0; i < _config.shards; ++i) {
+            _workers.emplace_back(&ShardedStack::_worker_main, this, i);
+        }
+    } catch (...) {
+        // the destructor won't run, so the workers that did start must be stopped here
+        _stop = true;
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+        throw;
+    }
+}
+
+//! \param[in] index is the shard that this worker runs
+template <typename AdaptT>
+void ShardedStack<AdaptT>::_worker_main(const size_t index) {
+    try {
+        if (_config.pin_threads) {
+            pin_current_thread(index);
+        }
+
+        TCPStack<AdaptT> stack(_make_adapter(index), _config.tcp);
+        stack.listen(_config.listen);
+
+        EventLoop loop;
+        stack.add_rules(loop);
+        if (_setup) {
+            _setup(index, stack, loop);
+        }
+
+        auto base_time = timestamp_ms();
+        while (not _stop.load(memory_order_relaxed)) {
+            if (loop.wait_next_event(_config.tick_ms) == EventLoop::Result::Exit) {
+                break;
+            }
+            _service(index, stack);
+
+            const auto next_time = timestamp_ms();
+            stack.tick(next_time - base_time);
+            base_time = next_time;
+        }
+    } catch (...) {
+        _errors[index] = current_exception();
+    }
+}
+
+//! \details Each worker's exception is only rethrown once, so a second call to stop() returns normally.
+template <typename AdaptT>
+void ShardedStack<AdaptT>::stop() {
+    _stop = true;
+    for (auto &worker : _workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    for (auto &error : _errors) {
+        if (error) {
+            rethrow_exception(exchange(error, nullptr));
+        }
+    }
+}
+
+template <typename AdaptT>
+ShardedStack<AdaptT>::~ShardedStack() {
+    try {
+        stop();
+    } catch (const exception &e) {
+        cerr << "Exception stopping ShardedStack: " << e.what() << "\n";
+    }
+}
+
+//! \param[in] address is the address that every shard's socket is bound to
+TCPOverUDPSocketAdapter reuseport_udp_adapter(const Address &address) {
+    UDPSocket socket;
+    socket.set_reuseport();
+    socket.set_receive_buffer_size(SHARD_RECEIVE_BUFFER);
+    socket.bind(address);
+
+    TCPOverUDPSocketAdapter adapter(move(socket));
+    adapter.config_mut().source = address;
+    return adapter;
+}
+
+//! Specialization of ShardedStack for TCPOverUDPSocketAdapter
+template class ShardedStack<TCPOverUDPSocketAdapter>;
+
+//! Specialization of ShardedStack for TCPOverIPv4OverTunFdAdapter
+template class ShardedStack<TCPOverIPv4OverTunFdAdapter>;
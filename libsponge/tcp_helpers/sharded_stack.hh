@@ -0,0 +1,96 @@
+#ifndef SPONGE_LIBSPONGE_SHARDED_STACK_HH
+#define SPONGE_LIBSPONGE_SHARDED_STACK_HH
+
+#include "address.hh"
+#include "eventloop.hh"
+#include "tcp_config.hh"
+#include "tcp_stack.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <thread>
+#include <vector>
+
+//! Config for a ShardedStack
+struct ShardedStackConfig {
+    size_t shards = 1;          //!< Number of worker threads, each with its own adapter, EventLoop and TCPStack
+    bool pin_threads = true;    //!< Pin worker `i` to the `i`th CPU that it may run on (see pin_current_thread())
+    TCPConfig tcp{};            //!< Config for every connection
+    ListenConfig listen{};      //!< Config for every shard's listener
+    unsigned int tick_ms = 10;  //!< Longest time a worker waits for an event before ticking its connections
+};
+
+//! \brief N worker threads, each running its own listening TCPStack
+//! \details Each worker owns one adapter (made on the worker's own thread by the AdapterFactory),
+//! one EventLoop and one TCPStack, so the packet path never touches another worker's state or
+//! takes a lock. The shard that owns a connection is chosen by the kernel with a hash of the flow:
+//! e.g. every worker's UDP socket is bound to the same address with `SO_REUSEPORT`, and each
+//! datagram is delivered to the socket picked by a hash of its addresses (see reuseport_udp_adapter()).
+//! All of a connection's segments therefore go to the same worker, and its data stays in that
+//! CPU's cache.
+//!
+//! The application runs on the workers too: the SetupHandler is called once on each worker (e.g.
+//! to add rules for its own file descriptors to the worker's EventLoop), and the ServiceHandler
+//! after every event or tick (e.g. to accept() connections and move their data).
+//!
+//! \note Connections opened with TCPStack::connect() only work if the kernel happens to deliver the
+//! peer's replies to the same shard, so a ShardedStack is meant for accepting connections.
+template <typename AdaptT>
+class ShardedStack {
+  public:
+    //! Makes the adapter for shard `index` (called on that shard's thread)
+    using AdapterFactory = std::function<AdaptT(size_t index)>;
+    //! Called once on each worker, before its first event
+    using SetupHandler = std::function<void(size_t index, TCPStack<AdaptT> &stack, EventLoop &loop)>;
+    //! Called on each worker after every event or tick
+    using ServiceHandler = std::function<void(size_t index, TCPStack<AdaptT> &stack)>;
+
+  private:
+    ShardedStackConfig _config;
+    AdapterFactory _make_adapter;
+    SetupHandler _setup;
+    ServiceHandler _service;
+
+    std::atomic<bool> _stop{false};
+    std::vector<std::thread> _workers{};
+    std::vector<std::exception_ptr> _errors{};  //!< What ended each worker, if it threw (read after joining it)
+
+    //! The body of each worker thread
+    void _worker_main(const size_t index);
+
+  public:
+    //! Start `config.shards` workers
+    ShardedStack(const ShardedStackConfig &config,
+                 AdapterFactory make_adapter,
+                 ServiceHandler service,
+                 SetupHandler setup = {});
+
+    //! \brief Stop and join the workers (each stack's connections are destroyed with it)
+    //! \details If a worker stopped early because of an exception (e.g. from the AdapterFactory or a
+    //! handler), it is rethrown here, once all of the workers have been joined.
+    void stop();
+
+    //! Number of shards
+    size_t shards() const { return _config.shards; }
+
+    ~ShardedStack();
+
+    //! \name
+    //! This object cannot be safely moved or copied, since it is in use by the worker threads
+
+    //!@{
+    ShardedStack(const ShardedStack &) = delete;
+    ShardedStack(ShardedStack &&) = delete;
+    ShardedStack &operator=(const ShardedStack &) = delete;
+    ShardedStack &operator=(ShardedStack &&) = delete;
+    //!@}
+};
+
+//! A TCPOverUDPSocketAdapter whose socket is bound to `address` with `SO_REUSEPORT` (for use as an AdapterFactory)
+TCPOverUDPSocketAdapter reuseport_udp_adapter(const Address &address);
+
+using ShardedTCPOverUDPStack = ShardedStack<TCPOverUDPSocketAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_SHARDED_STACK_HH
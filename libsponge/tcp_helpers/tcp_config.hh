@@ -16,10 +16,12 @@ class TCPConfig {
     static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
     static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
 
-    uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
-    size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
-    size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
+    uint16_t rt_timeout = TIMEOUT_DFLT;          //!< Initial value of the retransmission timeout, in milliseconds
+    size_t recv_capacity = DEFAULT_CAPACITY;     //!< Receive capacity, in bytes
+    size_t send_capacity = DEFAULT_CAPACITY;     //!< Sender capacity, in bytes
+    size_t max_payload_size = MAX_PAYLOAD_SIZE;  //!< Largest payload of a segment (the MSS), in bytes
     std::optional<WrappingInt32> fixed_isn{};
+    bool measure_latency = false;  //!< Time each write() until it is acknowledged (see TCPStats::write_latency)
 };
 
 //! Config for classes derived from FdAdapter
@@ -32,4 +34,33 @@ class FdAdapterConfig {
     uint16_t loss_rate_up = 0;  //!< Uplink loss rate (for LossyFdAdapter)
 };
 
+//! Config for a NetworkEmulator (and the NetemFdAdapter that uses one)
+class NetemConfig {
+  public:
+    static constexpr size_t DEFAULT_QUEUE_BYTES = 256 * 1024;  //!< Default capacity of the bottleneck queue
+
+    //! How the bottleneck queue decides which segments to drop
+    enum class QueueDiscipline {
+        DropTail,  //!< Drop arriving segments that don't fit
+        CoDel,     //!< Also drop departing segments that waited too long (RFC 8289)
+    };
+
+    uint64_t delay_ms = 0;                              //!< One-way propagation delay, in milliseconds
+    uint64_t jitter_ms = 0;                             //!< Largest variation of a segment's delay, either way
+    double loss = 0;                                    //!< Probability that a segment is dropped
+    double duplicate = 0;                               //!< Probability that a segment is sent twice
+    double reorder = 0;                                 //!< Probability that a segment skips the delay
+    uint64_t rate_bps = 0;                              //!< Bottleneck bandwidth, in bits/s (zero: unlimited)
+    size_t queue_bytes = DEFAULT_QUEUE_BYTES;           //!< Capacity of the bottleneck queue, in bytes
+    QueueDiscipline queue = QueueDiscipline::DropTail;  //!< How the bottleneck queue drops segments
+    uint64_t codel_target_us = 5000;                    //!< CoDel's acceptable queueing delay
+    uint64_t codel_interval_us = 100000;                //!< CoDel's sliding window (about a worst-case RTT)
+    uint32_t seed = 0;                                  //!< Seed of the random choices (same seed, same run)
+
+    //! Does this config leave segments alone?
+    bool transparent() const {
+        return delay_ms == 0 and jitter_ms == 0 and loss == 0 and duplicate == 0 and reorder == 0 and rate_bps == 0;
+    }
+};
+
 #endif  // SPONGE_LIBSPONGE_TCP_CONFIG_HH
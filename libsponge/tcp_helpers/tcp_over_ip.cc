@@ -3,6 +3,7 @@
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
+#include "tcp_trace.hh"
 
 #include <arpa/inet.h>
 #include <stdexcept>
@@ -23,7 +24,8 @@ using namespace std;
 //! `_listen` flag and records the source and destination addresses and port numbers
 //! from the TCP header; it uses this information to filter future reads.
 //! \returns a std::optional<TCPSegment> that is empty if the segment was invalid or unrelated
-optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram) {
+optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram &ip_dgram,
+                                                          const bool checksum_verified) {
     // is the IPv4 datagram for us?
     // Note: it's valid to bind to address "0" (INADDR_ANY) and reply from actual address contacted
     if (not listening() and (ip_dgram.header().dst != config().source.ipv4_numeric())) {
@@ -42,7 +44,9 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
 
     // is the payload a valid TCP segment?
     TCPSegment tcp_seg;
-    if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
+    const ParseResult result = checksum_verified ? tcp_seg.parse_unchecked(ip_dgram.payload())
+                                                 : tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum());
+    if (ParseResult::NoError != result) {
         return {};
     }
 
@@ -67,9 +71,19 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentReceived, tcp_seg, ip_dgram.header().src, ip_dgram.header().dst);
+    }
     return tcp_seg;
 }
 
+//! \param[in,out] ip_dgram is the datagram whose payload is set
+//! \param[in] seg is the TCP segment to serialize
+void TCPOverIPv4Adapter::_set_payload(InternetDatagram &ip_dgram, const TCPSegment &seg) const {
+    const uint32_t pseudo_cksum = ip_dgram.header().pseudo_cksum();
+    ip_dgram.payload() = _checksum_offload ? seg.serialize_partial_checksum(pseudo_cksum) : seg.serialize(pseudo_cksum);
+}
+
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
@@ -81,10 +95,66 @@ InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
     InternetDatagram ip_dgram;
     ip_dgram.header().src = config().source.ipv4_numeric();
     ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + as_const(seg).payload().size();
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentSent, seg, ip_dgram.header().src, ip_dgram.header().dst);
+    }
 
     // set payload, calculating TCP checksum using information from IP header
-    ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
+    _set_payload(ip_dgram, seg);
+
+    return ip_dgram;
+}
+
+//! \details Unlike unwrap_tcp_in_ip(), this accepts segments from any peer, and doesn't look at
+//! the listening flag. The datagram's destination address and the segment's destination port must
+//! match the configured source address and port (either can be 0, to accept any value).
+//! \returns a std::optional<AddressedSegment> that is empty if the segment was invalid or not for us
+optional<AddressedSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip_from(const InternetDatagram &ip_dgram,
+                                                                      const bool checksum_verified) {
+    const uint32_t local_ip = config().source.ipv4_numeric();
+    if (local_ip != 0 and ip_dgram.header().dst != local_ip) {
+        return {};
+    }
+
+    if (ip_dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return {};
+    }
+
+    TCPSegment tcp_seg;
+    const ParseResult result = checksum_verified ? tcp_seg.parse_unchecked(ip_dgram.payload())
+                                                 : tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum());
+    if (ParseResult::NoError != result) {
+        return {};
+    }
+
+    const uint16_t local_port = config().source.port();
+    if (local_port != 0 and tcp_seg.header().dport != local_port) {
+        return {};
+    }
+
+    const FourTuple flow{ip_dgram.header().src, ip_dgram.header().dst, tcp_seg.header().sport, tcp_seg.header().dport};
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentReceived, tcp_seg, flow.src_ip, flow.dst_ip);
+    }
+    return AddressedSegment{flow, move(tcp_seg)};
+}
+
+//! \param[in] seg is the TCP segment to convert (its ports are set from `flow`)
+//! \param[in] flow is the connection the segment belongs to
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg, const FourTuple &flow) {
+    seg.header().sport = flow.dst_port;
+    seg.header().dport = flow.src_port;
+
+    InternetDatagram ip_dgram;
+    ip_dgram.header().src = flow.dst_ip;
+    ip_dgram.header().dst = flow.src_ip;
+    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + as_const(seg).payload().size();
+    if (Tracer::enabled()) {
+        Tracer::segment(TraceEvent::SegmentSent, seg, flow.dst_ip, flow.src_ip);
+    }
+
+    _set_payload(ip_dgram, seg);
 
     return ip_dgram;
 }
@@ -3,6 +3,7 @@
 
 #include "buffer.hh"
 #include "fd_adapter.hh"
+#include "four_tuple.hh"
 #include "ipv4_datagram.hh"
 #include "tcp_segment.hh"
 
@@ -10,10 +11,30 @@
 
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase {
+  private:
+    bool _checksum_offload{false};  //!< Leave TCP checksums of outgoing segments for the kernel to finish?
+
+    //! Serialize `seg` into the payload of `ip_dgram`, whose header is complete
+    void _set_payload(InternetDatagram &ip_dgram, const TCPSegment &seg) const;
+
   public:
-    std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
+    //! \param[in] checksum_verified skips the TCP checksum (e.g. the kernel has verified it, or never computed it)
+    std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram, const bool checksum_verified = false);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! Parse a TCP segment addressed to the local address and port, from any peer
+    std::optional<AddressedSegment> unwrap_tcp_in_ip_from(const InternetDatagram &ip_dgram,
+                                                          const bool checksum_verified = false);
+
+    //! Wrap a TCP segment for the connection `flow`
+    InternetDatagram wrap_tcp_in_ip(TCPSegment &seg, const FourTuple &flow);
+
+    //! Write only the pseudo-header part of the TCP checksum (for a TUN device with `IFF_VNET_HDR`)
+    void set_checksum_offload(const bool enabled) { _checksum_offload = enabled; }
+
+    //! Is the TCP checksum left for the kernel to finish?
+    bool checksum_offload() const { return _checksum_offload; }
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
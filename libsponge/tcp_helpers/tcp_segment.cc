@@ -7,6 +7,9 @@
 
 using namespace std;
 
+//! Offset of the checksum field in a serialized TCPHeader
+static constexpr size_t TCP_CHECKSUM_OFFSET = 16;
+
 //! \param[in] buffer string/Buffer to be parsed
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer_checksum) {
@@ -16,9 +19,15 @@ ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer
         return ParseResult::BadChecksum;
     }
 
+    return parse_unchecked(buffer);
+}
+
+//! \param[in] buffer string/Buffer to be parsed
+ParseResult TCPSegment::parse_unchecked(const Buffer buffer) {
     NetParser p{buffer};
     _header.parse(p);
     _payload = p.buffer();
+    _payload_sum.reset();
     return p.get_error();
 }
 
@@ -26,16 +35,43 @@ size_t TCPSegment::length_in_sequence_space() const {
     return payload().str().size() + (header().syn ? 1 : 0) + (header().fin ? 1 : 0);
 }
 
+uint16_t TCPSegment::_sum_of_payload() const {
+    if (_payload_sum.has_value()) {
+        return *_payload_sum;
+    }
+    InternetChecksum check;
+    check.add(_payload);
+    return static_cast<uint16_t>(~check.value());
+}
+
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The header is serialized once, with a zero checksum, and the checksum is then patched in.
+//! The header always has an even length, so the payload's sum can be computed (or cached) separately.
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
     TCPHeader header_out = _header;
     header_out.cksum = 0;
+    string header_bytes = header_out.serialize();
 
     // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    InternetChecksum check(datagram_layer_checksum + _sum_of_payload());
+    check.add(header_bytes);
+    const uint16_t cksum = check.value();
+    header_bytes[TCP_CHECKSUM_OFFSET] = static_cast<char>(cksum >> 8);
+    header_bytes[TCP_CHECKSUM_OFFSET + 1] = static_cast<char>(cksum & 0xff);
+
+    BufferList ret;
+    ret.append(move(header_bytes));
+    ret.append(_payload);
+
+    return ret;
+}
+
+//! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+//! \details The checksum field holds just the folded sum of the pseudo-header (as for a Linux
+//! `CHECKSUM_PARTIAL` packet), and whoever finishes the checksum adds in the TCP header and payload.
+BufferList TCPSegment::serialize_partial_checksum(const uint32_t datagram_layer_checksum) const {
+    TCPHeader header_out = _header;
+    header_out.cksum = static_cast<uint16_t>(~InternetChecksum(datagram_layer_checksum).value());
 
     BufferList ret;
     ret.append(header_out.serialize());
@@ -5,6 +5,7 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <optional>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
@@ -12,20 +13,41 @@ class TCPSegment {
     TCPHeader _header{};
     Buffer _payload{};
 
+    //! Folded one's-complement sum of the payload, if cached (see cache_payload_checksum())
+    std::optional<uint16_t> _payload_sum{};
+
+    //! \returns the folded one's-complement sum of the payload (from the cache, if set)
+    uint16_t _sum_of_payload() const;
+
   public:
     //! \brief Parse the segment from a string
     ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
 
+    //! \brief Parse the segment from a string without verifying its checksum (e.g. the kernel already has)
+    ParseResult parse_unchecked(const Buffer buffer);
+
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Serialize the segment, leaving the checksum for the kernel or NIC to finish
+    BufferList serialize_partial_checksum(const uint32_t datagram_layer_checksum) const;
+
+    //! \brief Sum the payload now (if not already cached), so that serialize() only has to checksum the header
+    //! \details Meant for a segment that is serialized more than once, e.g. one being retransmitted: copies
+    //! made afterwards keep the cached sum, and serializing one only fills in the header and its checksum.
+    //! The cache is dropped whenever the payload is accessed for modification.
+    void cache_payload_checksum() { _payload_sum = _sum_of_payload(); }
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
     TCPHeader &header() { return _header; }
 
     const Buffer &payload() const { return _payload; }
-    Buffer &payload() { return _payload; }
+    Buffer &payload() {
+        _payload_sum.reset();
+        return _payload;
+    }
     //!@}
 
     //! \brief Segment's length in sequence space
@@ -4,14 +4,17 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iostream>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
+#include <thread>
 #include <unistd.h>
 #include <utility>
 
@@ -19,42 +22,95 @@ using namespace std;
 
 static constexpr size_t TCP_TICK_MS = 10;
 
+//! \name Indices of the handlers in the event loop of the TCPConnection thread
+//!@{
+static constexpr size_t DATAGRAM_HANDLER = 0;       //!< The adapter (segments in and out)
+static constexpr size_t OWNER_HANDLER = 1;          //!< The owner's socket (bytes in and out)
+static constexpr size_t OUTBOUND_RING_HANDLER = 2;  //!< The outbound ring's wakeups (shared-memory data path only)
+static constexpr size_t INBOUND_RING_HANDLER = 3;   //!< The inbound ring's wakeups (shared-memory data path only)
+//!@}
+
+//! \details Interest is a function of the TCPConnection's state and of the flags that track the owner's
+//! streams, so it only needs updating after something that can change them: a callback, a tick, or the
+//! shared rings' pump. Nothing is called to decide what to poll in between, however often the loop spins.
+template <typename AdaptT>
+template <typename LoopT>
+void TCPSpongeSocket<AdaptT>::_update_interest(LoopT &loop) {
+    const bool active = _tcp->active();
+    const ByteStream &inbound = _tcp->inbound_stream();
+
+    loop.set_interest(DATAGRAM_HANDLER, Direction::In, active);
+    loop.set_interest(DATAGRAM_HANDLER, Direction::Out, not _tcp->segments_out().empty());
+    loop.set_interest(OWNER_HANDLER,
+                      Direction::In,
+                      (not _outbound_ring) and active and (not _outbound_shutdown) and
+                          _tcp->outbound_stream().writable());
+    loop.set_interest(OWNER_HANDLER,
+                      Direction::Out,
+                      (not _inbound_ring) and (not _inbound_shutdown) and
+                          (_inbound_ready or inbound.eof() or inbound.error()));
+
+    if constexpr (LoopT::size > INBOUND_RING_HANDLER) {
+        loop.set_interest(OUTBOUND_RING_HANDLER, Direction::In, active and not _outbound_shutdown);
+        loop.set_interest(INBOUND_RING_HANDLER, Direction::In, not _inbound_shutdown);
+    }
+}
+
+//! \param[in] loop polls the handlers set up by _tcp_loop()
 //! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
+template <typename LoopT>
+void TCPSpongeSocket<AdaptT>::_run_loop(LoopT &loop, const function<bool()> &condition) {
     auto base_time = timestamp_ms();
+    unsigned int idle_rounds = 0;  // consecutive empty polls, in busy-poll mode
+    _update_interest(loop);
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        int timeout_ms = TCP_TICK_MS;
+        if (_busy_poll and idle_rounds < _busy_poll->spin_rounds + _busy_poll->yield_rounds) {
+            if (idle_rounds >= _busy_poll->spin_rounds) {
+                this_thread::yield();
+            }
+            timeout_ms = 0;
+        }
+
+        auto ret = loop.wait_next_event(timeout_ms);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
+        bool changed = ret != EventLoop::Result::Timeout;  // by a callback
+        if (changed) {
+            idle_rounds = 0;
+        } else if (_busy_poll and idle_rounds < _busy_poll->spin_rounds + _busy_poll->yield_rounds) {
+            ++idle_rounds;
+        }
 
-        if (_tcp.value().active()) {
-            const auto next_time = timestamp_ms();
+        // nothing arrived for a whole tick, so don't hold back inbound bytes below the watermark any longer
+        if (ret == EventLoop::Result::Timeout and not _inbound_ready and not _tcp->inbound_stream().buffer_empty()) {
+            _inbound_ready = true;
+            changed = true;
+        }
+
+        if (_outbound_ring and _pump_shared_rings()) {
+            changed = true;
+        }
+
+        const auto next_time = timestamp_ms();
+        if (_tcp.value().active() and next_time != base_time) {
             _tcp.value().tick(next_time - base_time);
             _datagram_adapter.tick(next_time - base_time);
             base_time = next_time;
+            changed = true;
         }
-    }
-}
 
-//! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
-//! \param[in] datagram_interface is the interface for reading and writing datagrams
-template <typename AdaptT>
-TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
-                                         AdaptT &&datagram_interface)
-    : LocalStreamSocket(move(data_socket_pair.first))
-    , _thread_data(move(data_socket_pair.second))
-    , _datagram_adapter(move(datagram_interface)) {
-    _thread_data.set_blocking(false);
+        if (changed) {
+            _update_interest(loop);
+        }
+    }
 }
 
+//! \param[in] condition is a function returning true if loop should continue
 template <typename AdaptT>
-void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
-    _tcp.emplace(config);
-
-    // Set up the event loop
-
+void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     // There are four possible events to handle:
     //
     // 1) Incoming datagram received (needs to be given to
@@ -71,95 +127,168 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     // 4) Outbound segment generated by TCP (needs to be
     //    given to underlying datagram socket)
 
-    // rule 1: read from filtered packet stream and dump into TCPConnection
-    _eventloop.add_rule(
-        _datagram_adapter,
-        Direction::In,
-        [&] {
-            auto seg = _datagram_adapter.read();
-            if (seg) {
-                _tcp->segment_received(move(seg.value()));
-            }
+    // rules 1 and 4: datagrams in and out
+    FdHandler datagrams{_datagram_adapter, [&] { _datagrams_readable(); }, [&] { _datagrams_writable(); }};
 
-            // debugging output:
-            if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
-                cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
-                     << " has been fully acknowledged.\n";
-                _fully_acked = true;
-            }
-        },
-        [&] { return _tcp->active(); });
-
-    // rule 2: read from pipe into outbound buffer
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::In,
-        [&] {
-            const auto data = _thread_data.read(_tcp->remaining_outbound_capacity());
-            const auto len = data.size();
-            const auto amount_written = _tcp->write(move(data));
-            if (amount_written != len) {
-                throw runtime_error("TCPConnection::write() accepted less than advertised length");
-            }
+    // rules 2 and 3: the owner's bytes in and out
+    FdHandler owner{_thread_data, [&] { _owner_readable(); }, [&] { _owner_writable(); }, [&] { _owner_hangup(); }};
+
+    if (not _outbound_ring) {
+        StaticEventLoop loop{datagrams, owner};
+        _run_loop(loop, condition);
+        return;
+    }
+
+    // rules 2 and 3, shared-memory version: the rings' wakeup counters only need to be reset here,
+    // because _run_loop moves bytes between the rings and the TCPConnection after every event
+    FdHandler outbound_ring{_outbound_ring->readable_fd(), [&] { _outbound_ring->wait_readable(); }};
+    FdHandler inbound_ring{_inbound_ring->writable_fd(), [&] { _inbound_ring->wait_writable(); }};
+    StaticEventLoop loop{datagrams, owner, outbound_ring, inbound_ring};
+    _run_loop(loop, condition);
+}
+
+//! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
+//! \param[in] datagram_interface is the interface for reading and writing datagrams
+template <typename AdaptT>
+TCPSpongeSocket<AdaptT>::TCPSpongeSocket(pair<FileDescriptor, FileDescriptor> data_socket_pair,
+                                         AdaptT &&datagram_interface)
+    : LocalStreamSocket(move(data_socket_pair.first))
+    , _thread_data(move(data_socket_pair.second))
+    , _datagram_adapter(move(datagram_interface)) {
+    _thread_data.set_blocking(false);
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
+    _tcp.emplace(config);
+
+    // wake for the owner's bytes (in either direction) only when there is a worthwhile amount to move
+    _tcp->outbound_stream().set_writable_watermark(OUTBOUND_WATERMARK);
+    _tcp->inbound_stream().set_readable_watermark(INBOUND_WATERMARK, [&] { _inbound_ready = true; });
+}
+
+//! rule 1: read from filtered packet stream and dump into TCPConnection
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_datagrams_readable() {
+    _datagram_adapter.read_many(_segment_batch, MAX_SEGMENT_BATCH);
+    for (const auto &seg : _segment_batch) {
+        if (not _tcp->active()) {
+            break;
+        }
+        _tcp->segment_received(seg);
+    }
+
+    // a partial batch means the adapter has been drained: deliver what the peer has sent so far
+    if (_segment_batch.size() < MAX_SEGMENT_BATCH and not _tcp->inbound_stream().buffer_empty()) {
+        _inbound_ready = true;
+    }
+    _segment_batch.clear();
+
+    // debugging output:
+    if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
+        cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
+             << " has been fully acknowledged.\n";
+        _fully_acked = true;
+    }
+}
+
+//! rule 2: read from pipe straight into the outbound buffer's free space
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_owner_readable() {
+    _tcp->commit_write(_thread_data.readv(_tcp->outbound_stream().writable_iovecs()));
+
+    if (_thread_data.eof()) {
+        _tcp->end_input_stream();
+        _outbound_shutdown = true;
 
-            if (_thread_data.eof()) {
+        // debugging output:
+        cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string() << " finished ("
+             << _tcp.value().bytes_in_flight() << " byte" << (_tcp.value().bytes_in_flight() == 1 ? "" : "s")
+             << " still in flight).\n";
+    }
+}
+
+//! rule 3: read from inbound buffer into pipe
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_owner_writable() {
+    ByteStream &inbound = _tcp->inbound_stream();
+    // Write from the inbound_stream into
+    // the pipe, handling the possibility of a partial
+    // write (i.e., only pop what was actually written).
+    const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
+    const std::string buffer = inbound.peek_output(amount_to_write);
+    const auto bytes_written = _thread_data.write(move(buffer), false);
+    inbound.pop_output(bytes_written);
+    _inbound_ready = not inbound.buffer_empty();
+
+    if (inbound.eof() or inbound.error()) {
+        _thread_data.shutdown(SHUT_WR);
+        _inbound_shutdown = true;
+
+        // debugging output:
+        cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string() << " finished "
+             << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
+        if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
+            cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
+        }
+    }
+}
+
+//! \details The loop stops polling a socket that has hung up, so neither stream can move through it again
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_owner_hangup() {
+    if (not _outbound_shutdown) {
+        _tcp->end_input_stream();
+        _outbound_shutdown = true;
+    }
+    _inbound_shutdown = true;
+}
+
+//! rule 4: read outbound segments from TCPConnection and send as datagrams
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::_datagrams_writable() {
+    while (_tcp->drain_segments(_segment_batch, MAX_SEGMENT_BATCH) > 0) {
+        _datagram_adapter.write_many(_segment_batch);
+        _segment_batch.clear();
+    }
+}
+
+//! \details Outbound bytes go straight from the ring into the TCPConnection (as much as it will take), and
+//! inbound bytes straight from the TCPConnection's inbound stream into the ring (as much as fits). The end of
+//! either stream is passed along once everything before it has been moved.
+template <typename AdaptT>
+bool TCPSpongeSocket<AdaptT>::_pump_shared_rings() {
+    bool moved = false;
+    while (not _outbound_shutdown and _tcp->remaining_outbound_capacity() > 0) {
+        const string_view chunk = _outbound_ring->peek();
+        if (chunk.empty()) {
+            if (_outbound_ring->closed() and _outbound_ring->empty()) {
                 _tcp->end_input_stream();
                 _outbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Outbound stream to " << _datagram_adapter.config().destination.to_string()
-                     << " finished (" << _tcp.value().bytes_in_flight() << " byte"
-                     << (_tcp.value().bytes_in_flight() == 1 ? "" : "s") << " still in flight).\n";
-            }
-        },
-        [&] { return (_tcp->active()) and (not _outbound_shutdown) and (_tcp->remaining_outbound_capacity() > 0); },
-        [&] {
-            _tcp->end_input_stream();
-            _outbound_shutdown = true;
-        });
-
-    // rule 3: read from inbound buffer into pipe
-    _eventloop.add_rule(
-        _thread_data,
-        Direction::Out,
-        [&] {
-            ByteStream &inbound = _tcp->inbound_stream();
-            // Write from the inbound_stream into
-            // the pipe, handling the possibility of a partial
-            // write (i.e., only pop what was actually written).
-            const size_t amount_to_write = min(size_t(65536), inbound.buffer_size());
-            const std::string buffer = inbound.peek_output(amount_to_write);
-            const auto bytes_written = _thread_data.write(move(buffer), false);
-            inbound.pop_output(bytes_written);
-
-            if (inbound.eof() or inbound.error()) {
-                _thread_data.shutdown(SHUT_WR);
-                _inbound_shutdown = true;
-
-                // debugging output:
-                cerr << "DEBUG: Inbound stream from " << _datagram_adapter.config().destination.to_string()
-                     << " finished " << (inbound.error() ? "with an error/reset.\n" : "cleanly.\n");
-                if (_tcp.value().state() == TCPState::State::TIME_WAIT) {
-                    cerr << "DEBUG: Waiting for lingering segments (e.g. retransmissions of FIN) from peer...\n";
-                }
-            }
-        },
-        [&] {
-            return (not _tcp->inbound_stream().buffer_empty()) or
-                   ((_tcp->inbound_stream().eof() or _tcp->inbound_stream().error()) and not _inbound_shutdown);
-        });
-
-    // rule 4: read outbound segments from TCPConnection and send as datagrams
-    _eventloop.add_rule(
-        _datagram_adapter,
-        Direction::Out,
-        [&] {
-            while (not _tcp->segments_out().empty()) {
-                _datagram_adapter.write(_tcp->segments_out().front());
-                _tcp->segments_out().pop();
+                moved = true;
             }
-        },
-        [&] { return not _tcp->segments_out().empty(); });
+            break;
+        }
+        _outbound_ring->pop(_tcp->write(chunk));
+        moved = true;
+    }
+
+    ByteStream &inbound = _tcp->inbound_stream();
+    while (not _inbound_shutdown and not inbound.buffer_empty()) {
+        const string_view chunk = inbound.peek_contiguous();
+        const size_t pushed = _inbound_ring->push(chunk);
+        inbound.pop_output(pushed);
+        moved |= pushed > 0;
+        if (pushed < chunk.size()) {
+            break;
+        }
+    }
+    if (not _inbound_shutdown and inbound.buffer_empty() and (inbound.eof() or inbound.error())) {
+        _inbound_ring->close();
+        _inbound_shutdown = true;
+        moved = true;
+    }
+    return moved;
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -190,9 +319,102 @@ TCPSpongeSocket<AdaptT>::~TCPSpongeSocket() {
     }
 }
 
+//! \param[in] capacity is the minimum size of each ring, in bytes
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::enable_shared_rings(const size_t capacity) {
+    if (_tcp) {
+        throw runtime_error("enable_shared_rings() with TCPConnection already initialized");
+    }
+    _outbound_ring = make_unique<SPSCRing>(capacity);
+    _inbound_ring = make_unique<SPSCRing>(capacity);
+}
+
+//! \param[in] config sets when to back off from spinning, and which CPU to pin the TCPConnection thread to
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::enable_busy_poll(const BusyPollConfig &config) {
+    if (_tcp) {
+        throw runtime_error("enable_busy_poll() with TCPConnection already initialized");
+    }
+    _busy_poll = config;
+
+    // with one CPU, spinning only delays the thread we're waiting for, so yield from the start
+    if (thread::hardware_concurrency() <= 1) {
+        _busy_poll->spin_rounds = 0;
+    }
+}
+
+//! \param[in] data is the bytes to write
+template <typename AdaptT>
+size_t TCPSpongeSocket<AdaptT>::send(string_view data) {
+    if (not _outbound_ring) {
+        throw runtime_error("TCPSpongeSocket::send() without enable_shared_rings()");
+    }
+    size_t total_sent = 0;
+    while (total_sent < data.size()) {
+        const size_t sent = _outbound_ring->push(data.substr(total_sent));
+        total_sent += sent;
+        if (sent == 0) {
+            if (_outbound_ring->closed()) {
+                break;
+            }
+            _outbound_ring->wait_writable();
+        }
+    }
+    return total_sent;
+}
+
+//! \param[out] buffer receives the bytes read
+//! \param[in] length is the largest number of bytes to read
+template <typename AdaptT>
+size_t TCPSpongeSocket<AdaptT>::recv(char *buffer, const size_t length) {
+    if (not _inbound_ring) {
+        throw runtime_error("TCPSpongeSocket::recv() without enable_shared_rings()");
+    }
+    while (length > 0) {
+        const size_t received = _inbound_ring->pop(buffer, length);
+        if (received > 0 or (_inbound_ring->closed() and _inbound_ring->empty())) {
+            return received;
+        }
+        _inbound_ring->wait_readable();
+    }
+    return 0;
+}
+
+//! \param[in] limit is the largest number of bytes to read
+template <typename AdaptT>
+string TCPSpongeSocket<AdaptT>::recv(const size_t limit) {
+    if (not _inbound_ring) {
+        throw runtime_error("TCPSpongeSocket::recv() without enable_shared_rings()");
+    }
+    string ret;
+    while (true) {
+        for (string_view chunk = _inbound_ring->peek(); ret.size() < limit and not chunk.empty();
+             chunk = _inbound_ring->peek()) {
+            const size_t len = min(chunk.size(), limit - ret.size());
+            ret.append(chunk.data(), len);
+            _inbound_ring->pop(len);
+        }
+        if (not ret.empty() or limit == 0 or (_inbound_ring->closed() and _inbound_ring->empty())) {
+            return ret;
+        }
+        _inbound_ring->wait_readable();
+    }
+}
+
+template <typename AdaptT>
+void TCPSpongeSocket<AdaptT>::shutdown_send() {
+    if (not _outbound_ring) {
+        throw runtime_error("TCPSpongeSocket::shutdown_send() without enable_shared_rings()");
+    }
+    _outbound_ring->close();
+}
+
 template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::wait_until_closed() {
     shutdown(SHUT_RDWR);
+    if (_outbound_ring) {
+        _outbound_ring->close();
+    }
     if (_tcp_thread.joinable()) {
         cerr << "DEBUG: Waiting for clean shutdown... ";
         _tcp_thread.join();
@@ -257,12 +479,21 @@ void TCPSpongeSocket<AdaptT>::_tcp_main() {
         if (not _tcp.has_value()) {
             throw runtime_error("no TCP");
         }
+        if (_busy_poll and _busy_poll->cpu >= 0 and not pin_current_thread(_busy_poll->cpu)) {
+            cerr << "DEBUG: could not pin TCPConnection thread to CPU " << _busy_poll->cpu << "\n";
+        }
         _tcp_loop([] { return true; });
         shutdown(SHUT_RDWR);
+        if (_outbound_ring) {
+            // wake up an owner blocked in send() or recv()
+            _outbound_ring->close();
+            _inbound_ring->close();
+        }
         if (not _tcp.value().active()) {
             cerr << "DEBUG: TCP connection finished "
                  << (_tcp.value().state() == TCPState::State::RESET ? "uncleanly" : "cleanly.\n");
         }
+        _final_stats = _tcp->stats();
         _tcp.reset();
     } catch (const exception &e) {
         cerr << "Exception in TCPConnection runner thread: " << e.what() << "\n";
@@ -282,6 +513,9 @@ template class TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 //! Specialization of TCPSpongeSocket for LossyTCPOverIPv4OverTunFdAdapter
 template class TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! Specialization of TCPSpongeSocket for NetemTCPOverUDPSocketAdapter
+template class TCPSpongeSocket<NetemTCPOverUDPSocketAdapter>;
+
 CS144TCPSocket::CS144TCPSocket() : TCPOverIPv4SpongeSocket(TCPOverIPv4OverTunFdAdapter(TunFD("tun144"))) {}
 
 void CS144TCPSocket::connect(const Address &address) {
@@ -2,9 +2,10 @@
 #define SPONGE_LIBSPONGE_TCP_SPONGE_SOCKET_HH
 
 #include "byte_stream.hh"
-#include "eventloop.hh"
 #include "fd_adapter.hh"
 #include "file_descriptor.hh"
+#include "spsc_ring.hh"
+#include "static_eventloop.hh"
 #include "tcp_config.hh"
 #include "tcp_connection.hh"
 #include "tcp_over_ip.hh"
@@ -12,10 +13,18 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <thread>
 #include <vector>
 
+//! Config for the busy-poll mode of TCPSpongeSocket (see TCPSpongeSocket::enable_busy_poll)
+struct BusyPollConfig {
+    unsigned int spin_rounds = 100000;  //!< Empty polls before the thread starts yielding the CPU between polls
+    unsigned int yield_rounds = 10000;  //!< Further empty polls (each after a yield) before blocking as usual
+    int cpu = -1;                       //!< CPU to pin the TCPConnection thread to, or -1 to leave it unpinned
+};
+
 //! Multithreaded wrapper around TCPConnection that approximates the Unix sockets API
 template <typename AdaptT>
 class TCPSpongeSocket : public LocalStreamSocket {
@@ -23,6 +32,35 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Stream socket for reads and writes between owner and TCP thread
     LocalStreamSocket _thread_data;
 
+    //! Largest number of segments received, or sent, per event-loop wakeup
+    static constexpr size_t MAX_SEGMENT_BATCH = 32;
+
+    //! Reused storage for batches of segments moving between the TCPConnection and the adapter
+    std::vector<TCPSegment> _segment_batch{};
+
+    //! Free space in the outbound stream before the owner's socket is read again
+    static constexpr size_t OUTBOUND_WATERMARK = 16384;
+
+    //! Bytes in the inbound stream before they are written to the owner's socket (unless the peer pauses first)
+    static constexpr size_t INBOUND_WATERMARK = 16384;
+
+    //! Should the inbound stream be written to the owner's socket? Set when the stream becomes readable
+    //! (see ByteStream::set_readable_watermark()) or the peer pauses, and cleared once it has been drained
+    bool _inbound_ready{false};
+
+    //! \name Shared-memory data path (see enable_shared_rings())
+    //!@{
+    std::unique_ptr<SPSCRing> _outbound_ring{};  //!< Bytes written by the owner, on their way to the TCPConnection
+    std::unique_ptr<SPSCRing> _inbound_ring{};   //!< Bytes received by the TCPConnection, on their way to the owner
+
+    //! Move bytes between the rings and the TCPConnection (called by the TCPConnection thread)
+    //! \returns `true` if anything was moved, or either stream was ended
+    bool _pump_shared_rings();
+    //!@}
+
+    //! If set, the event loop polls without blocking (see enable_busy_poll())
+    std::optional<BusyPollConfig> _busy_poll{};
+
     //! Adapter to underlying datagram socket (e.g., UDP or IP)
     AdaptT _datagram_adapter;
 
@@ -32,8 +70,25 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! TCP state machine
     std::optional<TCPConnection> _tcp{};
 
-    //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
-    EventLoop _eventloop{};
+    //! The TCPConnection's statistics when it finished
+    TCPStats _final_stats{};
+
+    //! \name Callbacks of the event loop (see _tcp_loop())
+    //!@{
+    void _datagrams_readable();  //!< Give the datagrams that have arrived to the TCPConnection
+    void _datagrams_writable();  //!< Send the TCPConnection's segments as datagrams
+    void _owner_readable();      //!< Read the owner's bytes into the outbound stream
+    void _owner_writable();      //!< Write the inbound stream to the owner
+    void _owner_hangup();        //!< Give up on the owner's socket, in both directions
+
+    //! Poll each of `loop`'s handlers in the directions in which it can make progress right now
+    template <typename LoopT>
+    void _update_interest(LoopT &loop);
+
+    //! Process events from `loop` while `condition` is true
+    template <typename LoopT>
+    void _run_loop(LoopT &loop, const std::function<bool()> &condition);
+    //!@}
 
     //! Process events while specified condition is true
     void _tcp_loop(const std::function<bool()> &condition);
@@ -70,9 +125,46 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
     void listen_and_accept(const TCPConfig &c_tcp, const FdAdapterConfig &c_ad);
 
+    //! \brief Statistics of the TCPConnection, as they were when it finished
+    //! \note Only meaningful after wait_until_closed()
+    const TCPStats &stats() const { return _final_stats; }
+
     //! When a connected socket is destructed, it will send a RST
     ~TCPSpongeSocket();
 
+    //! \name Shared-memory data path
+    //! Instead of the Unix-domain socket, the owner can exchange bytes with the TCPConnection thread through a pair
+    //! of lock-free SPSCRing buffers. Call enable_shared_rings() before connect() or listen_and_accept(), then use
+    //! send(), recv() and shutdown_send() in place of write(), read() and shutdown(SHUT_WR).
+
+    //!@{
+
+    //! Use a pair of SPSCRing buffers, each of at least `capacity` bytes, for the owner's data
+    void enable_shared_rings(const size_t capacity = TCPConfig::DEFAULT_CAPACITY);
+
+    //! Write `data` to the connection, blocking until all of it has been queued
+    //! \returns the number of bytes queued (less than `data.size()` only if the connection has ended)
+    size_t send(std::string_view data);
+
+    //! Read up to `length` bytes from the connection, blocking until at least one is available
+    //! \returns the number of bytes read, or zero at the end of the inbound stream
+    size_t recv(char *buffer, const size_t length);
+
+    //! Read up to `limit` bytes from the connection, blocking until at least one is available
+    std::string recv(const size_t limit = 65536);
+
+    //! Signal the end of the outbound stream
+    void shutdown_send();
+    //!@}
+
+    //! \brief Have the TCPConnection thread busy-poll its file descriptors instead of sleeping in poll(2)
+    //! \details Call before connect() or listen_and_accept(). The thread polls with a zero timeout, so a
+    //! segment or the owner's data is handled as soon as it arrives, without a wakeup. After
+    //! BusyPollConfig::spin_rounds empty polls it yields the CPU between polls, and after a further
+    //! BusyPollConfig::yield_rounds it goes back to blocking, until the next event. Best combined with
+    //! enable_shared_rings() and a dedicated CPU.
+    void enable_busy_poll(const BusyPollConfig &config = {});
+
     //! \name
     //! This object cannot be safely moved or copied, since it is in use by two threads simultaneously
 
@@ -98,6 +190,7 @@ using TCPOverUDPSpongeSocket = TCPSpongeSocket<TCPOverUDPSocketAdapter>;
 using TCPOverIPv4SpongeSocket = TCPSpongeSocket<TCPOverIPv4OverTunFdAdapter>;
 using LossyTCPOverUDPSpongeSocket = TCPSpongeSocket<LossyTCPOverUDPSocketAdapter>;
 using LossyTCPOverIPv4SpongeSocket = TCPSpongeSocket<LossyTCPOverIPv4OverTunFdAdapter>;
+using NetemTCPOverUDPSpongeSocket = TCPSpongeSocket<NetemTCPOverUDPSocketAdapter>;
 
 //! \class TCPSpongeSocket
 //! This class involves the simultaneous operation of two threads.
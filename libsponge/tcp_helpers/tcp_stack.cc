@@ -0,0 +1,281 @@
+#include "tcp_stack.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+using namespace std;
+
+//! \param[in] adapter is the interface through which every connection reads and writes segments
+//! \param[in] config is the TCPConfig for each new connection
+template <typename AdaptT>
+TCPStack<AdaptT>::TCPStack(AdaptT &&adapter, const TCPConfig &config)
+    : _adapter(move(adapter)), _config(config), _cookie_key(SipHashKey::random()) {}
+
+//! \param[in] flow identifies the connection
+//! \param[in] connection is the connection whose segments_out() should be drained
+template <typename AdaptT>
+void TCPStack<AdaptT>::_flush(const FourTuple &flow, TCPConnection &connection) {
+    while (connection.drain_segments(_out_batch, MAX_SEGMENT_BATCH) > 0) {
+        _adapter.write_many_to(flow, _out_batch);
+        _out_batch.clear();
+    }
+}
+
+template <typename AdaptT>
+optional<FourTuple> TCPStack<AdaptT>::accept() {
+    if (_accept_queue.empty()) {
+        return {};
+    }
+    const FourTuple flow = _accept_queue.front();
+    _accept_queue.pop_front();
+    _connections.find(flow)->stage = Stage::Accepted;
+    return flow;
+}
+
+//! \param[in] flow identifies the new connection (its source is the peer to connect to)
+template <typename AdaptT>
+TCPConnection *TCPStack<AdaptT>::connect(const FourTuple &flow) {
+    auto [entry, inserted] = _connections.insert(flow, {make_unique<TCPConnection>(_config), Stage::Accepted});
+    if (not inserted) {
+        return nullptr;
+    }
+    entry->connection->connect();
+    _flush(flow, *entry->connection);
+    return entry->connection.get();
+}
+
+//! \param[in] flow identifies the connection
+template <typename AdaptT>
+TCPConnection *TCPStack<AdaptT>::find(const FourTuple &flow) {
+    const Entry *entry = _connections.find(flow);
+    return entry and entry->stage == Stage::Accepted ? entry->connection.get() : nullptr;
+}
+
+//! \param[in] flow identifies the connection
+//! \param[in] data is the bytes to write
+template <typename AdaptT>
+size_t TCPStack<AdaptT>::write(const FourTuple &flow, string_view data) {
+    TCPConnection *connection = find(flow);
+    if (not connection) {
+        return 0;
+    }
+    const size_t written = connection->write(data);
+    _flush(flow, *connection);
+    return written;
+}
+
+//! \param[in] flow identifies the connection
+template <typename AdaptT>
+void TCPStack<AdaptT>::flush(const FourTuple &flow) {
+    if (TCPConnection *connection = find(flow)) {
+        _flush(flow, *connection);
+    }
+}
+
+//! \param[in] flow identifies the connection
+//! \param[in] entry is the connection's entry in the table
+template <typename AdaptT>
+void TCPStack<AdaptT>::_maybe_establish(const FourTuple &flow, Entry &entry) {
+    if (entry.stage != Stage::SynReceived or _accept_queue.size() >= _listen_config->accept_backlog) {
+        return;
+    }
+    if (not entry.connection->active() or entry.connection->state() == TCPState::State::SYN_RCVD) {
+        return;
+    }
+    --_syn_received;
+    entry.stage = Stage::AcceptQueue;
+    _accept_queue.push_back(flow);
+}
+
+//! \param[in] flow identifies the peer
+//! \param[in] peer_isn is the sequence number of the peer's SYN
+//! \param[in] period is the number of SYN_COOKIE_PERIOD_MS periods since the stack was created
+//! \details The top five bits of the cookie hold the period (so that old cookies can be rejected),
+//! and the other 27 bits hold the SipHash of the flow, `peer_isn` and `period` under the stack's
+//! secret key, so that a peer cannot forge a cookie for a SYN it did not send (except by guessing).
+template <typename AdaptT>
+WrappingInt32 TCPStack<AdaptT>::_syn_cookie(const FourTuple &flow,
+                                            const WrappingInt32 peer_isn,
+                                            const uint64_t period) const {
+    const uint32_t isn = peer_isn.raw_value();
+    char input[24];
+    memcpy(input, &flow.src_ip, 4);
+    memcpy(input + 4, &flow.dst_ip, 4);
+    memcpy(input + 8, &flow.src_port, 2);
+    memcpy(input + 10, &flow.dst_port, 2);
+    memcpy(input + 12, &isn, 4);
+    memcpy(input + 16, &period, 8);
+    const uint64_t h = siphash24(_cookie_key, {input, sizeof(input)});
+    return WrappingInt32{static_cast<uint32_t>((period & 0x1f) << 27 | (h & 0x07ffffff))};
+}
+
+//! \param[in] flow identifies the peer
+//! \param[in] syn is the peer's SYN
+template <typename AdaptT>
+void TCPStack<AdaptT>::_send_syn_cookie(const FourTuple &flow, const TCPSegment &syn) {
+    TCPSegment syn_ack;
+    auto &header = syn_ack.header();
+    header.syn = true;
+    header.ack = true;
+    header.seqno = _syn_cookie(flow, syn.header().seqno, _time_ms / SYN_COOKIE_PERIOD_MS);
+    header.ackno = syn.header().seqno + 1;
+    header.win = min(_config.recv_capacity, size_t{numeric_limits<uint16_t>::max()});
+    _adapter.write_to(flow, syn_ack);
+}
+
+//! \param[in] flow identifies the peer
+//! \param[in] ack is a segment from the peer, which is not a SYN and does not belong to any connection
+//! \details A valid cookie must have been issued in the current period or the one before. The new
+//! connection is brought to SYN_RCVD by replaying the peer's SYN (the SYN-ACK that this generates
+//! was already sent by _send_syn_cookie()), and then given the ACK.
+template <typename AdaptT>
+void TCPStack<AdaptT>::_accept_syn_cookie(const FourTuple &flow, const TCPSegment &ack) {
+    if (_accept_queue.size() >= _listen_config->accept_backlog) {
+        return;
+    }
+
+    const WrappingInt32 peer_isn = ack.header().seqno - 1;
+    const WrappingInt32 cookie = ack.header().ackno - 1;
+    const uint64_t now = _time_ms / SYN_COOKIE_PERIOD_MS;
+    const uint64_t cookie_period = cookie.raw_value() >> 27;
+    uint64_t period = now;
+    if ((now & 0x1f) != cookie_period) {
+        if (now == 0 or ((now - 1) & 0x1f) != cookie_period) {
+            return;
+        }
+        period = now - 1;
+    }
+    if (_syn_cookie(flow, peer_isn, period) != cookie) {
+        return;
+    }
+
+    TCPConfig config = _config;
+    config.fixed_isn = cookie;
+    auto connection = make_unique<TCPConnection>(config);
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = peer_isn;
+    connection->segment_received(syn);
+    connection->segments_out() = {};
+
+    connection->segment_received(ack);
+    _flush(flow, *connection);
+    _connections.insert(flow, {move(connection), Stage::AcceptQueue});
+    _accept_queue.push_back(flow);
+}
+
+//! \param[in] flow identifies the peer
+//! \param[in] segment is a segment that does not belong to any connection
+template <typename AdaptT>
+void TCPStack<AdaptT>::_receive_unknown(const FourTuple &flow, const TCPSegment &segment) {
+    const auto &header = segment.header();
+    if (not _listen_config or header.rst) {
+        return;
+    }
+
+    const ListenConfig &listen_config = *_listen_config;
+    if (not header.syn) {
+        if (header.ack and listen_config.syn_cookies != SynCookies::Never) {
+            _accept_syn_cookie(flow, segment);
+        }
+        return;
+    }
+
+    // as in Linux, a SYN is dropped if the handshake could not complete for lack of room
+    if (header.ack or _accept_queue.size() >= listen_config.accept_backlog) {
+        return;
+    }
+
+    if (listen_config.syn_cookies == SynCookies::Always or _syn_received >= listen_config.syn_backlog) {
+        if (listen_config.syn_cookies != SynCookies::Never) {
+            _send_syn_cookie(flow, segment);
+        }
+        return;
+    }
+
+    Entry &entry = *_connections.insert(flow, {make_unique<TCPConnection>(_config), Stage::SynReceived}).first;
+    ++_syn_received;
+    entry.connection->segment_received(segment);
+    _flush(flow, *entry.connection);
+}
+
+//! \param[in] flow identifies the connection
+template <typename AdaptT>
+bool TCPStack<AdaptT>::release(const FourTuple &flow) {
+    const TCPConnection *connection = find(flow);
+    if (not connection or connection->active()) {
+        return false;
+    }
+    return _connections.erase(flow);
+}
+
+template <typename AdaptT>
+void TCPStack<AdaptT>::receive() {
+    _adapter.read_from(_batch, MAX_SEGMENT_BATCH);
+    for (auto &[flow, segment] : _batch) {
+        Entry *entry = _connections.find(flow);
+        if (not entry) {
+            _receive_unknown(flow, segment);
+            continue;
+        }
+
+        if (entry->connection->active()) {
+            entry->connection->segment_received(segment);
+            _flush(flow, *entry->connection);
+            _maybe_establish(flow, *entry);
+        }
+    }
+    _batch.clear();
+}
+
+//! \param[in] ms_since_last_tick is the number of milliseconds since the last call to tick()
+template <typename AdaptT>
+void TCPStack<AdaptT>::tick(const size_t ms_since_last_tick) {
+    _time_ms += ms_since_last_tick;
+    _connections.for_each([&](const FourTuple &flow, Entry &entry) {
+        entry.connection->tick(ms_since_last_tick);
+        _flush(flow, *entry.connection);
+        _maybe_establish(flow, entry);
+    });
+    _adapter.tick(ms_since_last_tick);
+
+    _connections.erase_if([&](const FourTuple &flow, const Entry &entry) {
+        if (entry.connection->active()) {
+            return false;
+        }
+        // the owner may not have read everything the peer sent before closing (or resetting)
+        if (entry.stage == Stage::Accepted and not entry.connection->inbound_stream().buffer_empty()) {
+            return false;
+        }
+        if (entry.stage == Stage::SynReceived) {
+            --_syn_received;
+        } else if (entry.stage == Stage::AcceptQueue) {
+            _accept_queue.erase(std::find(_accept_queue.begin(), _accept_queue.end(), flow));
+        }
+        return true;
+    });
+}
+
+//! \param[in] loop is the EventLoop that will service the adapter
+template <typename AdaptT>
+void TCPStack<AdaptT>::add_rules(EventLoop &loop) {
+    loop.add_rule(_adapter, Direction::In, [&] { receive(); });
+}
+
+//! Specialization of TCPStack for TCPOverUDPSocketAdapter
+template class TCPStack<TCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPStack for TCPOverIPv4OverTunFdAdapter
+template class TCPStack<TCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPStack for LossyTCPOverUDPSocketAdapter
+template class TCPStack<LossyTCPOverUDPSocketAdapter>;
+
+//! Specialization of TCPStack for LossyTCPOverIPv4OverTunFdAdapter
+template class TCPStack<LossyTCPOverIPv4OverTunFdAdapter>;
+
+//! Specialization of TCPStack for MemoryAdapter
+template class TCPStack<MemoryAdapter>;
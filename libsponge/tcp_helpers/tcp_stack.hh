@@ -0,0 +1,183 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STACK_HH
+#define SPONGE_LIBSPONGE_TCP_STACK_HH
+
+#include "connection_table.hh"
+#include "eventloop.hh"
+#include "fd_adapter.hh"
+#include "four_tuple.hh"
+#include "memory_adapter.hh"
+#include "siphash.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tuntap_adapter.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+//! How a listening TCPStack uses SYN cookies
+enum class SynCookies {
+    Never,     //!< SYNs beyond the SYN backlog are dropped
+    WhenFull,  //!< SYNs beyond the SYN backlog are answered with a cookie (the default, as in Linux)
+    Always     //!< Every SYN is answered with a cookie, and no state is kept until the handshake completes
+};
+
+//! Config for a listening TCPStack
+struct ListenConfig {
+    size_t syn_backlog = 128;                       //!< Most half-open connections (SYN received, not yet ACKed)
+    size_t accept_backlog = 128;                    //!< Most established connections waiting for accept()
+    SynCookies syn_cookies = SynCookies::WhenFull;  //!< When to answer a SYN without keeping any state
+};
+
+//! \brief Many TCPConnections sharing one FD adapter, demultiplexed by FourTuple
+//! \details A TCPStack reads segments from any peer through the adapter's addressed interface
+//! (`read_from()`/`write_to()`), looks up each segment's connection in a ConnectionTable, and hands
+//! it over.
+//!
+//! A listening stack keeps the usual two queues. A SYN for an unknown flow creates a half-open
+//! connection (counted against ListenConfig::syn_backlog); once the peer ACKs our SYN, the
+//! connection moves to the accept queue (bounded by ListenConfig::accept_backlog), and accept()
+//! hands it to the owner. When the SYN backlog is full (or always, depending on
+//! ListenConfig::syn_cookies), a SYN is instead answered statelessly: the ISN of the SYN-ACK
+//! encodes a keyed hash of the flow, and the connection is only created when an ACK carrying a
+//! valid cookie arrives. Any other segment for an unknown flow is dropped.
+//!
+//! A TCPStack is single-threaded: the owner calls receive() when the adapter is readable (see
+//! add_rules()) and tick() periodically, and reads and writes each connection's byte streams on the
+//! same thread. Connections that are no longer active are removed by tick(), except that an accepted
+//! connection is kept until the owner has read all of its inbound stream (or calls release()).
+template <typename AdaptT>
+class TCPStack {
+  public:
+    //! Largest number of segments read from the adapter per call to receive()
+    static constexpr size_t MAX_SEGMENT_BATCH = 32;
+
+    //! A cookie is valid for one to two periods of this many milliseconds
+    static constexpr uint64_t SYN_COOKIE_PERIOD_MS = 64000;
+
+  private:
+    //! Where a connection is in its life, from the owner's point of view
+    enum class Stage : uint8_t {
+        SynReceived,  //!< Passively opened, waiting for the ACK of our SYN
+        AcceptQueue,  //!< Established, waiting for accept()
+        Accepted      //!< Visible to the owner (all actively opened connections are here)
+    };
+
+    struct Entry {
+        std::unique_ptr<TCPConnection> connection{};  //!< A std::unique_ptr keeps it in place as the table grows
+        Stage stage{Stage::Accepted};
+    };
+
+    AdaptT _adapter;
+    TCPConfig _config;
+
+    ConnectionTable<Entry> _connections{};
+
+    //! Set if the stack is listening
+    std::optional<ListenConfig> _listen_config{};
+
+    //! Flows in Stage::AcceptQueue, oldest first
+    std::deque<FourTuple> _accept_queue{};
+
+    //! Number of connections in Stage::SynReceived
+    size_t _syn_received{0};
+
+    //! Key for the SYN-cookie hash
+    SipHashKey _cookie_key;
+
+    //! Milliseconds of tick() so far (the clock for SYN cookies)
+    uint64_t _time_ms{0};
+
+    //! Reused storage for segments read from the adapter
+    std::vector<AddressedSegment> _batch{};
+
+    //! Reused storage for one connection's segments on their way to the adapter
+    std::vector<TCPSegment> _out_batch{};
+
+    //! Send whatever segments `connection` has queued
+    void _flush(const FourTuple &flow, TCPConnection &connection);
+
+    //! Handle a segment for a flow with no connection
+    void _receive_unknown(const FourTuple &flow, const TCPSegment &segment);
+
+    //! Move a half-open connection to the accept queue if its handshake is done and there is room
+    void _maybe_establish(const FourTuple &flow, Entry &entry);
+
+    //! The cookie for a SYN from `flow` with sequence number `peer_isn`, at cookie period `period`
+    WrappingInt32 _syn_cookie(const FourTuple &flow, const WrappingInt32 peer_isn, const uint64_t period) const;
+
+    //! Reply to a SYN with a SYN-ACK whose ISN is a cookie
+    void _send_syn_cookie(const FourTuple &flow, const TCPSegment &syn);
+
+    //! If `ack` completes a handshake started with _send_syn_cookie(), create the connection
+    void _accept_syn_cookie(const FourTuple &flow, const TCPSegment &ack);
+
+  public:
+    //! Construct from an adapter; every connection is created with `config`
+    explicit TCPStack(AdaptT &&adapter, const TCPConfig &config = {});
+
+    //! Accept connections from any peer
+    void listen(const ListenConfig &config = {}) { _listen_config = config; }
+
+    //! Take the oldest established connection from the accept queue
+    //! \returns its flow (use find() to get the connection), or nothing if the queue is empty
+    std::optional<FourTuple> accept();
+
+    //! Open a connection (sending a SYN) for `flow`
+    //! \returns the new connection, or `nullptr` if `flow` is already in use
+    TCPConnection *connect(const FourTuple &flow);
+
+    //! \returns the accepted or actively opened connection for `flow`, or `nullptr`
+    TCPConnection *find(const FourTuple &flow);
+
+    //! Write to the connection for `flow`, and send what the connection can
+    //! \returns the number of bytes accepted (zero if there is no such connection)
+    size_t write(const FourTuple &flow, std::string_view data);
+
+    //! Send the segments that the connection for `flow` has queued (e.g. after writing to its streams directly)
+    void flush(const FourTuple &flow);
+
+    //! Remove the connection for `flow`, which is no longer active, without waiting for its inbound stream
+    //! to be read
+    //! \returns `false` if there is no such accepted connection, or if it is still active
+    bool release(const FourTuple &flow);
+
+    //! Read a batch of segments from the adapter and deliver each to its connection
+    void receive();
+
+    //! Tell every connection (and the adapter) that time has passed, then remove closed connections (see release())
+    void tick(const size_t ms_since_last_tick);
+
+    //! Have `loop` call receive() whenever the adapter is readable
+    void add_rules(EventLoop &loop);
+
+    //! Call `f(flow, connection)` on every accepted or actively opened connection
+    template <typename F>
+    void for_each_connection(F &&f) {
+        _connections.for_each([&](const FourTuple &flow, Entry &entry) {
+            if (entry.stage == Stage::Accepted) {
+                f(flow, *entry.connection);
+            }
+        });
+    }
+
+    //! Number of connections in any stage
+    size_t size() const { return _connections.size(); }
+
+    size_t syn_received() const { return _syn_received; }             //!< Number of half-open connections
+    size_t accept_queue_size() const { return _accept_queue.size(); }  //!< Number of connections awaiting accept()
+
+    //! The underlying adapter
+    AdaptT &adapter() { return _adapter; }
+};
+
+using TCPOverUDPStack = TCPStack<TCPOverUDPSocketAdapter>;
+using TCPOverIPv4Stack = TCPStack<TCPOverIPv4OverTunFdAdapter>;
+using LossyTCPOverUDPStack = TCPStack<LossyTCPOverUDPSocketAdapter>;
+using LossyTCPOverIPv4Stack = TCPStack<LossyTCPOverIPv4OverTunFdAdapter>;
+
+#endif  // SPONGE_LIBSPONGE_TCP_STACK_HH
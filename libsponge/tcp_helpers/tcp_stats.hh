@@ -0,0 +1,58 @@
+#ifndef SPONGE_LIBSPONGE_TCP_STATS_HH
+#define SPONGE_LIBSPONGE_TCP_STATS_HH
+
+#include "latency_histogram.hh"
+
+#include <cstddef>
+#include <cstdint>
+
+//! \brief Counters and gauges kept by a TCPSender
+//! \details Counters only grow; gauges (marked as such) describe the sender when stats() was called.
+struct TCPSenderStats {
+    uint64_t segments_sent{0};        //!< Segments sent, including retransmissions and empty ACKs
+    uint64_t bytes_sent{0};           //!< Payload bytes sent, including retransmissions
+    uint64_t retransmissions{0};      //!< Segments retransmitted
+    uint64_t bytes_retransmitted{0};  //!< Payload bytes retransmitted
+    uint64_t rto_expirations{0};      //!< Times the retransmission timer expired with segments in flight
+    uint64_t zero_window_events{0};   //!< Times the peer's window closed (went from nonzero to zero)
+    uint64_t rtt_samples{0};          //!< Round-trip times measured (never from a retransmitted segment)
+
+    //! Time (sampled at each tick) during which unsent data waited for the peer's window to open
+    uint64_t window_limited_ms{0};
+    //! Time (sampled at each tick) during which the sender was open but had nothing to send
+    uint64_t sender_limited_ms{0};
+
+    double srtt_ms{0};            //!< Gauge: smoothed round-trip time, as in [RFC 6298](\ref rfc::rfc6298)
+    double rttvar_ms{0};          //!< Gauge: round-trip time variation, as in [RFC 6298](\ref rfc::rfc6298)
+    uint64_t rto_ms{0};           //!< Gauge: current retransmission timeout (including any backoff)
+    uint64_t peer_window{0};      //!< Gauge: window most recently advertised by the peer
+    uint64_t bytes_in_flight{0};  //!< Gauge: sequence numbers sent but not yet acknowledged
+};
+
+//! \brief Counters and gauges kept by a TCPReceiver (and its StreamReassembler)
+struct TCPReceiverStats {
+    uint64_t segments_received{0};      //!< Segments given to the receiver (after the SYN)
+    uint64_t bytes_received{0};         //!< Payload bytes in those segments, including duplicates
+    uint64_t duplicate_segments{0};     //!< Segments that had already been entirely acknowledged
+    uint64_t out_of_order_segments{0};  //!< Segments that arrived ahead of the ackno
+
+    uint64_t out_of_order_bytes{0};  //!< Gauge: bytes held by the reassembler, waiting for a gap to fill
+    uint64_t window{0};              //!< Gauge: window that the receiver advertises
+};
+
+//! \brief Statistics of a TCPConnection, like Linux's `TCP_INFO`
+//! \details Every segment the connection sends goes through its sender, but a pure ACK can bypass
+//! the receiver, so the number of segments received is counted by the connection itself.
+//!
+//! If TCPConfig::measure_latency is set, `write_latency` holds, for each call to TCPConnection::write(),
+//! the time until the peer acknowledged the last byte written. The peer only acknowledges bytes that
+//! are readable from its inbound stream, so this is the time from the application's write to the
+//! peer application being able to read, plus the time for the ACK to come back.
+struct TCPStats {
+    uint64_t segments_received{0};     //!< Segments received, including pure ACKs and RSTs
+    TCPSenderStats sender{};           //!< The sender's statistics
+    TCPReceiverStats receiver{};       //!< The receiver's statistics
+    LatencyHistogram write_latency{};  //!< Write-to-acknowledgment latencies (if measured), in ns
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_STATS_HH
@@ -0,0 +1,221 @@
+#include "tcp_trace.hh"
+
+#include "file_descriptor.hh"
+#include "util.hh"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+using namespace std::chrono;
+
+atomic<bool> Tracer::_enabled{false};
+
+//! A single-producer/single-consumer ring of TraceRecords (the producer is the thread that owns it)
+struct TraceRing {
+    static constexpr size_t CACHE_LINE = 64;
+
+    unique_ptr<TraceRecord[]> records;
+    size_t mask;
+
+    alignas(CACHE_LINE) atomic<uint64_t> head{0};  //!< Records ever pushed (written by the producer)
+    atomic<uint64_t> dropped{0};                   //!< Records dropped for lack of room (written by the producer)
+    alignas(CACHE_LINE) atomic<uint64_t> tail{0};  //!< Records ever drained (written by the consumer)
+
+    explicit TraceRing(const size_t capacity) : records(make_unique<TraceRecord[]>(capacity)), mask(capacity - 1) {}
+};
+
+//! Everything shared by the threads that record and the thread that writes the file
+struct TraceSink {
+    mutex lock{};                             //!< Guards everything below, except the atomics
+    vector<shared_ptr<TraceRing>> rings{};    //!< Every thread's ring
+    size_t ring_records{0};                   //!< Capacity of new rings
+    optional<FileDescriptor> file{};          //!< The trace file
+    thread flusher{};                         //!< Drains the rings into the file
+    condition_variable wakeup{};              //!< Wakes the flusher early (to stop)
+    bool stopping{false};                     //!< Tells the flusher to stop
+    uint64_t dropped_by_finished_threads{0};  //!< Records dropped by rings that were discarded
+    string buffer{};                          //!< Records on their way to the file
+
+    atomic<uint32_t> generation{0};          //!< Incremented by each start(), so that stale rings are replaced
+    atomic<uint32_t> next_connection_id{1};  //!< The next connection id to hand out
+};
+
+static TraceSink &sink() {
+    static TraceSink the_sink;
+    return the_sink;
+}
+
+static uint64_t monotonic_ns() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//! Move every record from every ring to the file (the caller holds `sink().lock`)
+static void drain(TraceSink &s) {
+    for (auto it = s.rings.begin(); it != s.rings.end();) {
+        TraceRing &ring = **it;
+        // if the ring's thread has finished, nothing more will be pushed, and the ring can go once drained
+        const bool finished = it->use_count() == 1;
+
+        const uint64_t tail = ring.tail.load(memory_order_relaxed);
+        const uint64_t head = ring.head.load(memory_order_acquire);
+        for (uint64_t i = tail; i < head; ++i) {
+            s.buffer.append(reinterpret_cast<const char *>(&ring.records[i & ring.mask]), sizeof(TraceRecord));
+        }
+        ring.tail.store(head, memory_order_release);
+
+        if (finished) {
+            s.dropped_by_finished_threads += ring.dropped.load(memory_order_relaxed);
+            it = s.rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (not s.buffer.empty() and s.file) {
+        s.file->write(s.buffer);
+    }
+    s.buffer.clear();
+}
+
+//! \param[in] path is the trace file to create (or truncate)
+//! \param[in] ring_records is the number of records in each thread's ring (rounded up to a power of two)
+void Tracer::start(const string &path, const size_t ring_records) {
+    TraceSink &s = sink();
+    unique_lock<mutex> guard{s.lock};
+    if (s.file) {
+        throw runtime_error("Tracer::start: already tracing");
+    }
+
+    s.file.emplace(SystemCall("open", ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)));
+    TraceFileHeader header;
+    header.realtime_offset_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count() -
+                                static_cast<int64_t>(monotonic_ns());
+    s.file->write(string_view{reinterpret_cast<const char *>(&header), sizeof(header)});
+
+    s.ring_records = 1;
+    while (s.ring_records < ring_records) {
+        s.ring_records *= 2;
+    }
+    s.rings.clear();
+    s.dropped_by_finished_threads = 0;
+    s.stopping = false;
+    s.generation.fetch_add(1, memory_order_release);
+
+    s.flusher = thread([&s] {
+        unique_lock<mutex> flusher_guard{s.lock};
+        while (not s.stopping) {
+            s.wakeup.wait_for(flusher_guard, milliseconds(FLUSH_INTERVAL_MS));
+            drain(s);
+        }
+    });
+
+    _enabled.store(true, memory_order_release);
+}
+
+uint64_t Tracer::stop() {
+    TraceSink &s = sink();
+    _enabled.store(false, memory_order_release);
+    {
+        lock_guard<mutex> guard{s.lock};
+        if (not s.file) {
+            return 0;
+        }
+        s.stopping = true;
+    }
+    s.wakeup.notify_one();
+    s.flusher.join();
+
+    lock_guard<mutex> guard{s.lock};
+    drain(s);
+    uint64_t dropped = s.dropped_by_finished_threads;
+    for (const auto &ring : s.rings) {
+        dropped += ring->dropped.load(memory_order_relaxed);
+    }
+    s.rings.clear();
+    s.file.reset();
+    return dropped;
+}
+
+//! \param[in] record is the event to record (its time is set here)
+void Tracer::record(TraceRecord record) {
+    thread_local shared_ptr<TraceRing> ring{};
+    thread_local uint32_t ring_generation{0};
+
+    TraceSink &s = sink();
+    const uint32_t generation = s.generation.load(memory_order_acquire);
+    if (not ring or ring_generation != generation) {
+        lock_guard<mutex> guard{s.lock};
+        if (not s.file) {
+            return;  // tracing was stopped in the meantime
+        }
+        ring = make_shared<TraceRing>(s.ring_records);
+        ring_generation = generation;
+        s.rings.push_back(ring);
+    }
+
+    record.time_ns = monotonic_ns();
+    const uint64_t head = ring->head.load(memory_order_relaxed);
+    if (head - ring->tail.load(memory_order_acquire) > ring->mask) {
+        ring->dropped.store(ring->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        return;
+    }
+    ring->records[head & ring->mask] = record;
+    ring->head.store(head + 1, memory_order_release);
+}
+
+//! \param[in] event is TraceEvent::SegmentSent or TraceEvent::SegmentReceived
+//! \param[in] seg is the segment (with its ports set)
+//! \param[in] src_ip is the source address of the segment, in host byte order (or zero if unknown)
+//! \param[in] dst_ip is the destination address of the segment, in host byte order (or zero if unknown)
+void Tracer::segment(const TraceEvent event, const TCPSegment &seg, const uint32_t src_ip, const uint32_t dst_ip) {
+    const TCPHeader &header = seg.header();
+    TraceRecord record;
+    record.event = event;
+    record.flags = (header.urg ? 0x20 : 0) | (header.ack ? 0x10 : 0) | (header.psh ? 0x08 : 0) |
+                   (header.rst ? 0x04 : 0) | (header.syn ? 0x02 : 0) | (header.fin ? 0x01 : 0);
+    record.win = header.win;
+    record.seqno = header.seqno.raw_value();
+    record.ackno = header.ackno.raw_value();
+    record.length = seg.payload().size();
+    record.src_ip = src_ip;
+    record.dst_ip = dst_ip;
+    record.sport = header.sport;
+    record.dport = header.dport;
+    Tracer::record(record);
+}
+
+uint32_t Tracer::next_connection_id() { return sink().next_connection_id.fetch_add(1, memory_order_relaxed); }
+
+//! \param[in] path is the trace file to read
+//! \param[out] header is set to the file's header
+vector<TraceRecord> read_trace_file(const string &path, TraceFileHeader &header) {
+    FileDescriptor file{SystemCall("open", ::open(path.c_str(), O_RDONLY | O_CLOEXEC))};
+    string contents, chunk;
+    while (not file.eof()) {
+        file.read(chunk);
+        contents += chunk;
+    }
+
+    if (contents.size() < sizeof(header)) {
+        throw runtime_error(path + ": too short to be a trace file");
+    }
+    memcpy(&header, contents.data(), sizeof(header));
+    if (header.magic != TraceFileHeader::MAGIC or header.version != TraceFileHeader::VERSION or
+        header.record_size != sizeof(TraceRecord)) {
+        throw runtime_error(path + ": not a trace file (or not from a compatible version)");
+    }
+
+    const size_t count = (contents.size() - sizeof(header)) / sizeof(TraceRecord);
+    vector<TraceRecord> records(count);
+    memcpy(records.data(), contents.data() + sizeof(header), count * sizeof(TraceRecord));
+    return records;
+}
@@ -0,0 +1,97 @@
+#ifndef SPONGE_LIBSPONGE_TCP_TRACE_HH
+#define SPONGE_LIBSPONGE_TCP_TRACE_HH
+
+#include "tcp_segment.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! Kinds of events recorded by the Tracer
+enum class TraceEvent : uint8_t {
+    SegmentSent = 1,        //!< An adapter sent a segment (`length` is its payload size)
+    SegmentReceived,        //!< An adapter received a valid segment addressed to it
+    RetransmissionTimeout,  //!< A connection's retransmission timer fired (`value` is the new RTO in ms)
+    WindowUpdate,           //!< The window advertised to a connection changed (`value` is the new window)
+    StateChange,            //!< A connection changed state (`value` is a TCPState::State, or 255 if unofficial)
+};
+
+//! \brief One fixed-size, binary trace event
+//! \details Segment events come from the adapters, which know the addresses but not the connection
+//! (so `connection` is zero); the other events come from a TCPConnection, identified by `connection`,
+//! and give the sequence numbers of the segment involved (if any).
+struct TraceRecord {
+    uint64_t time_ns{0};     //!< When the event happened (`CLOCK_MONOTONIC`)
+    uint32_t connection{0};  //!< The connection's id (see Tracer::next_connection_id()), or zero
+    TraceEvent event{};      //!< What happened
+    uint8_t flags{0};        //!< TCP flags, as in the header (URG 0x20, ACK 0x10, ... FIN 0x01)
+    uint16_t win{0};         //!< Window field of the segment
+    uint32_t seqno{0};       //!< Sequence number of the segment
+    uint32_t ackno{0};       //!< Acknowledgment number of the segment
+    uint32_t length{0};      //!< Payload length of the segment
+    uint32_t value{0};       //!< Event-specific value (see TraceEvent)
+    uint32_t src_ip{0};      //!< Source IPv4 address (host byte order), or zero if unknown
+    uint32_t dst_ip{0};      //!< Destination IPv4 address (host byte order), or zero if unknown
+    uint16_t sport{0};       //!< Source port of the segment
+    uint16_t dport{0};       //!< Destination port of the segment
+    uint32_t reserved{0};    //!< Zero (makes the size a multiple of 8, with no padding)
+};
+
+static_assert(sizeof(TraceRecord) == 48, "TraceRecord is written to trace files as is");
+
+//! \brief Records TraceRecords into a lock-free ring per thread, and writes them to a trace file
+//! \details While tracing is off, each trace point costs one relaxed load of an atomic flag. While it
+//! is on, recording an event fills in a TraceRecord and copies it into the calling thread's ring,
+//! without locks or system calls (the ring is created, under a lock, by the thread's first event).
+//! If a ring is full, the event is dropped and counted.
+//!
+//! Between start() and stop(), a background thread drains every ring into the trace file every
+//! FLUSH_INTERVAL_MS. The file holds a TraceFileHeader and then the records, as they are in memory
+//! (see apps/trace_convert.cc to turn them into pcapng or CSV). Records from different threads are
+//! not interleaved in time order.
+class Tracer {
+  public:
+    static constexpr size_t DEFAULT_RING_RECORDS = 1 << 16;  //!< Default size of each thread's ring
+    static constexpr unsigned int FLUSH_INTERVAL_MS = 100;   //!< Time between drains of the rings
+
+  private:
+    static std::atomic<bool> _enabled;
+
+  public:
+    //! Start writing events to a new trace file at `path`, with rings of `ring_records` records
+    static void start(const std::string &path, const size_t ring_records = DEFAULT_RING_RECORDS);
+
+    //! Stop tracing, write out the remaining events, and close the trace file
+    //! \returns the number of events that were dropped because a ring was full
+    static uint64_t stop();
+
+    //! Is tracing on?
+    static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+    //! Record `record`, stamping it with the current time
+    static void record(TraceRecord record);
+
+    //! Record a segment sent or received by an adapter
+    static void segment(const TraceEvent event, const TCPSegment &seg, const uint32_t src_ip, const uint32_t dst_ip);
+
+    //! A new id for a TCPConnection (never zero)
+    static uint32_t next_connection_id();
+};
+
+//! The header of a trace file
+struct TraceFileHeader {
+    static constexpr uint64_t MAGIC = 0x31435254474e5053;  //!< "SPNGTRC1" (as written by a little-endian machine)
+    static constexpr uint32_t VERSION = 1;                  //!< Version of the file format
+
+    uint64_t magic{MAGIC};                      //!< Identifies a trace file
+    uint32_t version{VERSION};                  //!< Version of the file format
+    uint32_t record_size{sizeof(TraceRecord)};  //!< Size of each record
+    int64_t realtime_offset_ns{0};              //!< Add to a record's time to get the time since the Unix epoch
+};
+
+//! Read every record in the trace file at `path` (throws std::runtime_error if it isn't one)
+std::vector<TraceRecord> read_trace_file(const std::string &path, TraceFileHeader &header);
+
+#endif  // SPONGE_LIBSPONGE_TCP_TRACE_HH
@@ -1,6 +1,89 @@
 #include "tuntap_adapter.hh"
 
+#include <cstdint>
+#include <cstring>
+
 using namespace std;
 
+//! Offset of the checksum field within a TCP header
+static constexpr uint16_t TCP_CHECKSUM_OFFSET = 16;
+
+static_assert(sizeof(VirtioNetHeader) <= TCPOverIPv4OverTunFdAdapter::VNET_SLOT_SIZE - 65536,
+              "VNET_SLOT_SIZE must leave room for the VirtioNetHeader");
+
+//! \param[in] tun is the TUN device (or one queue of a multiqueue device); with `vnet_hdr`, checksum offload is used
+TCPOverIPv4OverTunFdAdapter::TCPOverIPv4OverTunFdAdapter(TunFD &&tun)
+    : _tun(move(tun))
+    , _read_pool(_tun.vnet_hdr() ? VNET_SLOT_COUNT : BufferPool::DEFAULT_SLOT_COUNT,
+                 _tun.vnet_hdr() ? VNET_SLOT_SIZE : BufferPool::DEFAULT_SLOT_SIZE) {
+    set_checksum_offload(_tun.vnet_hdr());
+}
+
+//! \param[out] ip_dgram receives the datagram
+//! \param[out] checksum_verified is set if the kernel vouches for the TCP checksum (or will never compute it)
+bool TCPOverIPv4OverTunFdAdapter::_read_datagram(InternetDatagram &ip_dgram, bool &checksum_verified) {
+    Buffer frame = _tun.read(_read_pool);
+    checksum_verified = false;
+
+    if (_tun.vnet_hdr()) {
+        VirtioNetHeader vnet{};
+        if (frame.size() < sizeof(vnet)) {
+            return false;
+        }
+        memcpy(&vnet, frame.str().data(), sizeof(vnet));
+        frame.remove_prefix(sizeof(vnet));
+        // NEEDS_CSUM: from a local socket, with only the pseudo-header summed; DATA_VALID: already verified
+        checksum_verified = vnet.flags & (VirtioNetHeader::F_NEEDS_CSUM | VirtioNetHeader::F_DATA_VALID);
+    }
+
+    return ip_dgram.parse(move(frame)) == ParseResult::NoError;
+}
+
+//! \param[in] ip_dgram is the datagram to write
+void TCPOverIPv4OverTunFdAdapter::_write_datagram(const InternetDatagram &ip_dgram) {
+    if (not _tun.vnet_hdr()) {
+        _tun.write(ip_dgram.serialize());
+        return;
+    }
+
+    // ask the kernel to finish the TCP checksum (see TCPSegment::serialize_partial_checksum)
+    VirtioNetHeader vnet{};
+    vnet.flags = VirtioNetHeader::F_NEEDS_CSUM;
+    vnet.gso_type = VirtioNetHeader::GSO_NONE;
+    vnet.csum_start = ip_dgram.header().hlen * 4;
+    vnet.csum_offset = TCP_CHECKSUM_OFFSET;
+
+    BufferList frame{string(reinterpret_cast<const char *>(&vnet), sizeof(vnet))};
+    frame.append(ip_dgram.serialize());
+    _tun.write(frame);
+}
+
+optional<TCPSegment> TCPOverIPv4OverTunFdAdapter::read() {
+    InternetDatagram ip_dgram;
+    bool checksum_verified = false;
+    if (not _read_datagram(ip_dgram, checksum_verified)) {
+        return {};
+    }
+    return unwrap_tcp_in_ip(ip_dgram, checksum_verified);
+}
+
+//! \param[out] segments is replaced by the TCP segment received (if any), tagged with its flow
+//! \param[in] max_segments is the largest number of segments to read (at most one is read)
+void TCPOverIPv4OverTunFdAdapter::read_from(vector<AddressedSegment> &segments, const size_t max_segments) {
+    segments.clear();
+    if (max_segments == 0) {
+        return;
+    }
+    InternetDatagram ip_dgram;
+    bool checksum_verified = false;
+    if (not _read_datagram(ip_dgram, checksum_verified)) {
+        return;
+    }
+    auto seg = unwrap_tcp_in_ip_from(ip_dgram, checksum_verified);
+    if (seg) {
+        segments.push_back(move(seg.value()));
+    }
+}
+
 //! Specialize LossyFdAdapter to TCPOverIPv4OverTunFdAdapter
 template class LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
@@ -7,27 +7,78 @@
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
+//! \details If the TunFD was opened with `vnet_hdr`, every packet carries a VirtioNetHeader.
+//! On reads, the kernel may then hand over TCP frames larger than the MTU (coalesced by GRO, or sent
+//! by a local socket with TSO) whose checksum is only partial or was already verified; such frames
+//! are accepted without checking the TCP checksum. On writes, the adapter only computes the
+//! pseudo-header part of each TCP checksum and asks the kernel to finish it.
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
+  public:
+    //! Room for the largest IPv4 datagram, plus its VirtioNetHeader, in `vnet_hdr` mode
+    static constexpr size_t VNET_SLOT_SIZE = 65536 + 16;
+    //! Number of read buffers in `vnet_hdr` mode
+    static constexpr size_t VNET_SLOT_COUNT = 64;
+
   private:
     TunFD _tun;
 
+    //! Storage for datagrams read from the TUN device; a datagram longer than the slot size
+    //! (BufferPool::DEFAULT_SLOT_SIZE, or VNET_SLOT_SIZE in `vnet_hdr` mode) is truncated, fails to parse, and
+    //! is dropped
+    BufferPool _read_pool;
+
+    //! Read one datagram, stripping its VirtioNetHeader (if any)
+    //! \returns `false` if it could not be parsed; sets `checksum_verified` if the TCP checksum needn't be checked
+    bool _read_datagram(InternetDatagram &ip_dgram, bool &checksum_verified);
+
+    //! Write one datagram, adding a VirtioNetHeader (if needed)
+    void _write_datagram(const InternetDatagram &ip_dgram);
+
   public:
     //! Construct from a TunFD
-    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun) : _tun(std::move(tun)) {}
+    explicit TCPOverIPv4OverTunFdAdapter(TunFD &&tun);
 
     //! Attempts to read and parse an IPv4 datagram containing a TCP segment related to the current connection
-    std::optional<TCPSegment> read() {
-        InternetDatagram ip_dgram;
-        if (ip_dgram.parse(_tun.read()) != ParseResult::NoError) {
-            return {};
+    std::optional<TCPSegment> read();
+
+    //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
+    void write(TCPSegment &seg) { _write_datagram(wrap_tcp_in_ip(seg)); }
+
+    //! \brief Batch version of read()
+    //! \note A TUN device delivers one datagram per [read(2)](\ref man2::read), so this reads at most one segment
+    void read_many(std::vector<TCPSegment> &segments, const size_t max_segments) {
+        segments.clear();
+        if (max_segments == 0) {
+            return;
+        }
+        auto seg = read();
+        if (seg) {
+            segments.push_back(std::move(seg.value()));
         }
-        return unwrap_tcp_in_ip(ip_dgram);
     }
 
-    //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    //! \brief Addressed version of read_many() (see TCPOverIPv4Adapter::unwrap_tcp_in_ip_from)
+    void read_from(std::vector<AddressedSegment> &segments, const size_t max_segments);
+
+    //! Writes a TCP segment for the connection `flow` to the TUN device
+    void write_to(const FourTuple &flow, TCPSegment &seg) { _write_datagram(wrap_tcp_in_ip(seg, flow)); }
+
+    //! Batch version of write(); writes each segment in turn
+    void write_many(std::vector<TCPSegment> &segments) {
+        for (auto &seg : segments) {
+            write(seg);
+        }
+    }
+
+    //! Addressed version of write_many(); writes each segment in turn
+    void write_many_to(const FourTuple &flow, std::vector<TCPSegment> &segments) {
+        for (auto &seg : segments) {
+            write_to(flow, seg);
+        }
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -12,6 +12,7 @@ using namespace std;
 
 void TCPReceiver::segment_received(const TCPSegment &seg) {
     const auto &header = seg.header();
+    const bool had_isn = _isn.has_value();
 
     if (!_isn) {  // _isn not set, in LISTEN state, waiting for SYN
         if (header.syn) {
@@ -42,9 +43,37 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     if (cur_abs_seqno + header.syn == 0)
         return;
 
+    ++_stats.segments_received;
+    _stats.bytes_received += seg.payload().size();
+    if (had_isn and seg.length_in_sequence_space() > 0) {
+        const uint64_t abs_ackno = abs_ack_no - 1 + _reassembler.stream_out().input_ended();
+        if (cur_abs_seqno + seg.length_in_sequence_space() <= abs_ackno) {
+            ++_stats.duplicate_segments;
+        } else if (cur_abs_seqno > abs_ackno) {
+            ++_stats.out_of_order_segments;
+        }
+    }
+
     _reassembler.push_substring(seg.payload().copy(), stream_index, header.fin);
 }
 
+bool TCPReceiver::segment_received_in_order(const TCPSegment &seg) {
+    const auto &header = seg.header();
+    if (not _isn or header.syn or header.fin) {
+        return false;
+    }
+    const uint64_t stream_index = _reassembler.stream_out().bytes_written();
+    if (header.seqno != wrap(stream_index + 1, *_isn)) {
+        return false;
+    }
+    if (not _reassembler.push_in_order(seg.payload().str(), stream_index)) {
+        return false;
+    }
+    ++_stats.segments_received;
+    _stats.bytes_received += seg.payload().size();
+    return true;
+}
+
 optional<WrappingInt32> TCPReceiver::ackno() const {
     if (!_isn) {
         return std::nullopt;
@@ -57,3 +86,10 @@ optional<WrappingInt32> TCPReceiver::ackno() const {
 }
 
 size_t TCPReceiver::window_size() const { return _capacity - _reassembler.stream_out().buffer_size(); }
+
+TCPReceiverStats TCPReceiver::stats() const {
+    TCPReceiverStats stats = _stats;
+    stats.out_of_order_bytes = _reassembler.unassembled_bytes();
+    stats.window = window_size();
+    return stats;
+}
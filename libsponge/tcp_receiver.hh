@@ -4,6 +4,7 @@
 #include "byte_stream.hh"
 #include "stream_reassembler.hh"
 #include "tcp_segment.hh"
+#include "tcp_stats.hh"
 #include "wrapping_integers.hh"
 
 #include <optional>
@@ -22,6 +23,9 @@ class TCPReceiver {
 
     std::optional<WrappingInt32> _isn;
 
+    //! counters for stats()
+    TCPReceiverStats _stats{};
+
   public:
     //! \brief Construct a TCP receiver
     //!
@@ -55,9 +59,17 @@ class TCPReceiver {
     //! \brief number of bytes stored but not yet reassembled
     size_t unassembled_bytes() const { return _reassembler.unassembled_bytes(); }
 
+    //! \brief Counters and gauges describing what the receiver has received
+    TCPReceiverStats stats() const;
+
     //! \brief handle an inbound segment
     void segment_received(const TCPSegment &seg);
 
+    //! \brief Fast path of segment_received() for the next in-order segment, carrying neither SYN nor FIN
+    //! \returns `false` (having done nothing) unless the segment starts at the ackno, fits in the window,
+    //! and there is nothing waiting to be reassembled
+    bool segment_received_in_order(const TCPSegment &seg);
+
     //! \name "Output" interface for the reader
     //!@{
     ByteStream &stream_out() { return _reassembler.stream_out(); }
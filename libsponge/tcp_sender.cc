@@ -2,6 +2,7 @@
 
 #include "tcp_config.hh"
 
+#include <cmath>
 #include <random>
 
 // Dummy implementation of a TCP sender
@@ -19,11 +20,16 @@ using namespace std;
 //! \param[in] capacity the capacity of the outgoing byte stream
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
-TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
+//! \param[in] max_payload_size the largest payload to put in a segment
+TCPSender::TCPSender(const size_t capacity,
+                     const uint16_t retx_timeout,
+                     const std::optional<WrappingInt32> fixed_isn,
+                     const size_t max_payload_size)
     : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
     , _initial_retransmission_timeout{retx_timeout}
     , ticker(_initial_retransmission_timeout)
-    , _stream(capacity) {}
+    , _stream(capacity)
+    , _max_payload_size(max_payload_size) {}
 
 uint64_t TCPSender::bytes_in_flight() const { return _flight_bytes_num; }
 
@@ -41,7 +47,7 @@ void TCPSender::fill_window() {
         /* payload_max_size is the maximal number of bytes can be sent in a seg, it is ok for _stream not to have
          * sufficient bytes to read, that is to say, payload_max_size >= payload.size()*/
         const size_t payload_max_size = /* remember to leave space for SYN */
-            min(TCPConfig::MAX_PAYLOAD_SIZE,
+            min(_max_payload_size,
                 actual_window_size - _flight_bytes_num - static_cast<size_t>(seg.header().syn));
         string payload = this->_stream.read(payload_max_size);
 
@@ -57,11 +63,18 @@ void TCPSender::fill_window() {
             ticker.reset_restart();
         }
 
-        // send & update
+        // send & update (the copy in `_flight_seg` shares the payload, and is kept for retransmission)
+        const size_t seg_length = seg.length_in_sequence_space();
+        _count_sent(seg);
         _segments_out.push(seg);
-        _flight_bytes_num += seg.length_in_sequence_space();
-        _flight_seg.insert(std::make_pair(next_seqno_absolute(), seg));
-        _next_seqno += seg.length_in_sequence_space();
+        _flight_bytes_num += seg_length;
+        _flight_seg.emplace(next_seqno_absolute(), std::move(seg));
+        _next_seqno += seg_length;
+
+        if (_rtt_ackno == 0) {  // time the round trip of this segment
+            _rtt_ackno = _next_seqno;
+            _rtt_sent_ms = _time_ms;
+        }
 
         if (_is_fin_set) {
             break;
@@ -92,6 +105,14 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
     }
     _consecutive_retransmissions_count = 0;
 
+    if (_rtt_ackno != 0 and abs_seqno >= _rtt_ackno) {
+        _sample_rtt(_time_ms - _rtt_sent_ms);
+        _rtt_ackno = 0;
+    }
+    if (window_size == 0 and _last_window_size != 0) {
+        ++_stats.zero_window_events;
+    }
+
     _last_window_size = window_size;
     fill_window();
 }
@@ -99,6 +120,16 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPSender::tick(const size_t ms_since_last_tick) {
     ticker.tick(ms_since_last_tick);
+    _time_ms += ms_since_last_tick;
+
+    // data (or a FIN) that is not yet sent is waiting for the window, since fill_window() sends all it can
+    if (syn_acked() and not _is_fin_set) {
+        if (not _stream.buffer_empty() or _stream.input_ended()) {
+            _stats.window_limited_ms += ms_since_last_tick;
+        } else {
+            _stats.sender_limited_ms += ms_since_last_tick;
+        }
+    }
 
     if (!_flight_seg.empty() && ticker.triggered()) {  // retransmission
         auto &first_segment = *_flight_seg.begin();
@@ -112,8 +143,14 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
         if (_last_window_size > 0 || first_segment.second.header().syn)
             ticker.grow();
 
-        // resend
+        // resend (summing the payload once, so that this and any later retransmission only checksum the header)
+        first_segment.second.cache_payload_checksum();
+        _count_sent(first_segment.second);
         _segments_out.push(first_segment.second);
+        ++_stats.rto_expirations;
+        ++_stats.retransmissions;
+        _stats.bytes_retransmitted += first_segment.second.payload().size();
+        _rtt_ackno = 0;  // Karn's algorithm: the ACK of a retransmitted segment is ambiguous
 
         // restart counter
         ticker.restart();  //_since_last_resend_time = 0;
@@ -125,14 +162,48 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
 
 unsigned int TCPSender::consecutive_retransmissions() const { return _consecutive_retransmissions_count; }
 
+optional<size_t> TCPSender::time_until_retransmission() const {
+    if (_flight_seg.empty()) {
+        return {};
+    }
+    return ticker.triggered() ? 0 : ticker._rto - ticker._since_last_resend_time;
+}
+
 void TCPSender::send_empty_segment() {
     TCPSegment empty_segment;
     // set correct sequence number
     empty_segment.header().seqno = next_seqno();
     // send & do not trace as "outstanding"
+    _count_sent(empty_segment);
     _segments_out.push(empty_segment);
 }
 
+void TCPSender::_count_sent(const TCPSegment &seg) {
+    ++_stats.segments_sent;
+    _stats.bytes_sent += seg.payload().size();
+}
+
+//! \param[in] rtt_ms is the time between sending a segment and receiving its acknowledgment
+void TCPSender::_sample_rtt(const uint64_t rtt_ms) {
+    const double rtt = rtt_ms;
+    if (_stats.rtt_samples == 0) {
+        _stats.srtt_ms = rtt;
+        _stats.rttvar_ms = rtt / 2;
+    } else {
+        _stats.rttvar_ms = 0.75 * _stats.rttvar_ms + 0.25 * abs(_stats.srtt_ms - rtt);
+        _stats.srtt_ms = 0.875 * _stats.srtt_ms + 0.125 * rtt;
+    }
+    ++_stats.rtt_samples;
+}
+
+TCPSenderStats TCPSender::stats() const {
+    TCPSenderStats stats = _stats;
+    stats.rto_ms = ticker._rto;
+    stats.peer_window = _last_window_size;
+    stats.bytes_in_flight = _flight_bytes_num;
+    return stats;
+}
+
 TCPSender::_SenderState TCPSender::_state() const {
     if (stream_in().error()) {
         return _SenderState::ERROR;
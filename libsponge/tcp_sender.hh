@@ -4,6 +4,7 @@
 #include "byte_stream.hh"
 #include "tcp_config.hh"
 #include "tcp_segment.hh"
+#include "tcp_stats.hh"
 #include "wrapping_integers.hh"
 
 #include <functional>
@@ -66,14 +67,36 @@ class TCPSender {
     //! outgoing stream of bytes that have not yet been sent
     ByteStream _stream;
 
+    //! largest payload of a segment
+    size_t _max_payload_size;
+
     //! the (absolute) sequence number for the next byte to be sent
     uint64_t _next_seqno{0};
 
+    //! counters for stats()
+    TCPSenderStats _stats{};
+
+    //! milliseconds since the sender was created (the sum of every tick)
+    uint64_t _time_ms{0};
+
+    //! the (absolute) ackno that will complete the round trip being timed, or zero if none is
+    uint64_t _rtt_ackno{0};
+
+    //! when the segment being timed was sent
+    uint64_t _rtt_sent_ms{0};
+
+    //! \brief Count a segment that is about to be sent
+    void _count_sent(const TCPSegment &seg);
+
+    //! \brief Update the smoothed round-trip time with a new measurement
+    void _sample_rtt(const uint64_t rtt_ms);
+
   public:
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
-              const std::optional<WrappingInt32> fixed_isn = {});
+              const std::optional<WrappingInt32> fixed_isn = {},
+              const size_t max_payload_size = TCPConfig::MAX_PAYLOAD_SIZE);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -108,6 +131,23 @@ class TCPSender {
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const;
 
+    //! \brief Milliseconds until tick() will retransmit, or empty if nothing is in flight
+    std::optional<size_t> time_until_retransmission() const;
+
+    //! \brief Has the SYN been acknowledged?
+    bool syn_acked() const { return _next_seqno > _flight_bytes_num; }
+
+    //! \brief Has the FIN been sent?
+    bool fin_sent() const { return _is_fin_set; }
+
+    //! \brief The window size most recently advertised by the receiver
+    size_t window_size() const { return _last_window_size; }
+
+    //! \brief Counters and gauges describing what the sender has done
+    //! \note The round-trip time is measured for information only: the retransmission timeout
+    //! starts from TCPConfig::rt_timeout, whatever the measurements
+    TCPSenderStats stats() const;
+
     //! \brief TCPSegments that the TCPSender has enqueued for transmission.
     //! \note These must be dequeued and sent by the TCPConnection,
     //! which will need to fill in the fields that are set by the TCPReceiver
@@ -116,10 +116,22 @@ uint32_t Address::ipv4_numeric() const {
     return be32toh(ipv4_addr.sin_addr.s_addr);
 }
 
-Address Address::from_ipv4_numeric(const uint32_t ip_address) {
+//! \details For an IPv4 address, the port is read directly from the sockaddr, without
+//! the [getnameinfo(3)](\ref man3::getnameinfo) call made by ip_port().
+uint16_t Address::port() const {
+    if (_address.storage.ss_family == AF_INET and _size == sizeof(sockaddr_in)) {
+        sockaddr_in ipv4_addr{};
+        memcpy(&ipv4_addr, &_address.storage, _size);
+        return be16toh(ipv4_addr.sin_port);
+    }
+    return ip_port().second;
+}
+
+Address Address::from_ipv4_numeric(const uint32_t ip_address, const uint16_t port) {
     sockaddr_in ipv4_addr{};
     ipv4_addr.sin_family = AF_INET;
     ipv4_addr.sin_addr.s_addr = htobe32(ip_address);
+    ipv4_addr.sin_port = htobe16(port);
 
     return {reinterpret_cast<sockaddr *>(&ipv4_addr), sizeof(ipv4_addr)};
 }
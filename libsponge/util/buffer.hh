@@ -1,6 +1,8 @@
 #ifndef SPONGE_LIBSPONGE_BUFFER_HH
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
+#include "buffer_pool.hh"
+
 #include <algorithm>
 #include <deque>
 #include <memory>
@@ -12,10 +14,13 @@
 #include <vector>
 
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \note The bytes live either in a heap-allocated std::string or in a slot of a BufferPool.
 class Buffer {
   private:
     std::shared_ptr<std::string> _storage{};
+    PacketBuffer _packet{};
     size_t _starting_offset{};
+    size_t _ending_offset{};  //!< Number of bytes discarded from the back
 
   public:
     Buffer() = default;
@@ -23,13 +28,19 @@ class Buffer {
     //! \brief Construct by taking ownership of a string
     Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
 
+    //! \brief Construct by taking over a (filled) slot from a BufferPool, without copying
+    Buffer(PacketBuffer &&packet) noexcept : _packet(std::move(packet)) {}
+
     //! \name Expose contents as a std::string_view
     //!@{
     std::string_view str() const {
+        if (_packet) {
+            return {_packet.data() + _starting_offset, _packet.size() - _starting_offset - _ending_offset};
+        }
         if (not _storage) {
             return {};
         }
-        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset};
+        return {_storage->data() + _starting_offset, _storage->size() - _starting_offset - _ending_offset};
     }
 
     operator std::string_view() const { return str(); }
@@ -47,6 +58,10 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Discard the last `n` bytes of the string (does not require a copy or move)
+    //! \note Used to carve one Buffer into several, e.g. to split a coalesced UDP datagram into its segments
+    void remove_suffix(const size_t n);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
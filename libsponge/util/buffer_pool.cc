@@ -0,0 +1,144 @@
+#include "buffer_pool.hh"
+
+#include "util.hh"
+
+#include <limits>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+//! \brief Bookkeeping for a BufferPool, stored at the start of the mapped region
+//! \details Keeping this state inside the mapping (rather than in the BufferPool object) lets
+//! PacketBuffer handles outlive both moves and destruction of the BufferPool that made them.
+struct BufferPool::Slab {
+    PacketBuffer::Slot *free_list;  //!< Recycled slots, most recently freed first
+    size_t slot_count;              //!< Total number of slots in the region
+    size_t slot_size;               //!< Payload capacity of each slot
+    size_t stride;                  //!< Distance between consecutive slot headers
+    size_t untouched;               //!< Index of the first slot that has never been handed out
+    size_t outstanding;             //!< Number of slots currently referenced by a PacketBuffer
+    size_t mapping_size;            //!< Length of the mapping, for munmap(2)
+    bool hugepages;                 //!< Whether the mapping uses MAP_HUGETLB
+    bool pool_alive;                //!< Whether the owning BufferPool still exists
+
+    //! Bytes reserved at the start of the mapping for the Slab itself (one cache line)
+    static constexpr size_t HEADER_SIZE = 64;
+
+    PacketBuffer::Slot *slot(const size_t n) {
+        return reinterpret_cast<PacketBuffer::Slot *>(reinterpret_cast<char *>(this) + HEADER_SIZE + n * stride);
+    }
+
+    void unmap() { ::munmap(this, mapping_size); }
+};
+
+//! \param[in] size is a number of bytes
+//! \param[in] alignment is a power of two
+//! \returns `size` rounded up to a multiple of `alignment`
+static constexpr size_t round_up(const size_t size, const size_t alignment) {
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+//! \param[in] slot_count is the number of slots in the pool
+//! \param[in] slot_size is the capacity of each slot, in bytes
+//! \param[in] hugepages requests a [MAP_HUGETLB](\ref man2::mmap) mapping. If no huge pages are
+//!                      available, the pool falls back to ordinary pages (and asks for transparent
+//!                      huge pages with [madvise(2)](\ref man2::madvise)).
+//!
+//! The memory is reserved with [mmap(2)](\ref man2::mmap) and is not touched here, so a pool only
+//! costs resident memory for the slots that are actually used.
+BufferPool::BufferPool(const size_t slot_count, const size_t slot_size, const bool hugepages) : _slab(nullptr) {
+    static_assert(sizeof(Slab) <= Slab::HEADER_SIZE, "Slab header must fit in its reserved space");
+    if (slot_count == 0 or slot_size == 0 or slot_size > numeric_limits<uint32_t>::max()) {
+        throw runtime_error("BufferPool: invalid slot count or size");
+    }
+
+    constexpr size_t CACHE_LINE = 64;
+    constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+    const size_t stride = round_up(sizeof(PacketBuffer::Slot) + slot_size, CACHE_LINE);
+    const size_t length = Slab::HEADER_SIZE + slot_count * stride;
+
+    size_t mapping_size = round_up(length, HUGE_PAGE);
+    void *region = MAP_FAILED;
+    if (hugepages) {
+        region =
+            ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    const bool got_hugepages = region != MAP_FAILED;
+    if (not got_hugepages) {
+        mapping_size = round_up(length, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        region = ::mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (region == MAP_FAILED) {
+            throw unix_error("mmap");
+        }
+        if (hugepages) {
+            ::madvise(region, mapping_size, MADV_HUGEPAGE);  // best effort
+        }
+    }
+
+    _slab = static_cast<Slab *>(region);
+    *_slab = {nullptr, slot_count, slot_size, stride, 0, 0, mapping_size, got_hugepages, true};
+}
+
+BufferPool::~BufferPool() {
+    if (not _slab) {
+        return;
+    }
+    _slab->pool_alive = false;
+    if (_slab->outstanding == 0) {
+        _slab->unmap();
+    }
+}
+
+BufferPool &BufferPool::operator=(BufferPool &&other) noexcept {
+    if (this != &other) {
+        BufferPool old{move(*this)};
+        _slab = other._slab;
+        other._slab = nullptr;
+    }
+    return *this;
+}
+
+PacketBuffer BufferPool::allocate() {
+    if (not _slab) {
+        throw runtime_error("BufferPool::allocate on a moved-from pool");
+    }
+
+    PacketBuffer::Slot *slot = nullptr;
+    if (_slab->free_list) {
+        slot = _slab->free_list;
+        _slab->free_list = slot->next_free;
+    } else if (_slab->untouched < _slab->slot_count) {
+        slot = _slab->slot(_slab->untouched++);
+        slot->slab = _slab;
+        slot->capacity = static_cast<uint32_t>(_slab->slot_size);
+    } else {
+        return {};  // pool exhausted
+    }
+
+    slot->next_free = nullptr;
+    slot->refcount = 1;
+    slot->length = 0;
+    ++_slab->outstanding;
+    return PacketBuffer{slot};
+}
+
+size_t BufferPool::slot_size() const { return _slab ? _slab->slot_size : 0; }
+
+size_t BufferPool::slot_count() const { return _slab ? _slab->slot_count : 0; }
+
+size_t BufferPool::available() const { return _slab ? _slab->slot_count - _slab->outstanding : 0; }
+
+bool BufferPool::uses_hugepages() const { return _slab and _slab->hugepages; }
+
+//! \param[in] slot is a slot whose reference count has dropped to zero
+void PacketBuffer::_recycle(Slot *slot) {
+    auto *slab = static_cast<BufferPool::Slab *>(slot->slab);
+    slot->next_free = slab->free_list;
+    slab->free_list = slot;
+    --slab->outstanding;
+
+    if (not slab->pool_alive and slab->outstanding == 0) {
+        slab->unmap();
+    }
+}
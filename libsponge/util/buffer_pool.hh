@@ -0,0 +1,151 @@
+#ifndef SPONGE_LIBSPONGE_BUFFER_POOL_HH
+#define SPONGE_LIBSPONGE_BUFFER_POOL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+//! \brief A reference-counted handle to one fixed-size slot of a BufferPool
+//! \details Copies of a PacketBuffer share the same slot, and the slot goes back to its
+//! pool when the last copy is destroyed. The reference count is deliberately *not* atomic:
+//! a PacketBuffer (and any Buffer built from it) must stay on the thread that uses its BufferPool.
+class PacketBuffer {
+  public:
+    //! \brief Header placed in front of the bytes of every slot
+    struct Slot {
+        void *slab;         //!< The slab (see BufferPool) this slot was carved from
+        Slot *next_free;    //!< Next slot on the slab's free list (only meaningful while free)
+        uint32_t refcount;  //!< Number of PacketBuffer handles sharing this slot
+        uint32_t length;    //!< Number of valid bytes in the slot
+        uint32_t capacity;  //!< Number of bytes the slot can hold
+        uint32_t reserved;  //!< Padding (keeps the payload 8-byte aligned)
+
+        char *data() { return reinterpret_cast<char *>(this + 1); }                    //!< Start of the payload
+        const char *data() const { return reinterpret_cast<const char *>(this + 1); }  //!< Start of the payload
+    };
+
+  private:
+    Slot *_slot{nullptr};
+
+    //! Drop this handle's reference, recycling the slot if it was the last one
+    void _release() {
+        if (_slot and --_slot->refcount == 0) {
+            _recycle(_slot);
+        }
+        _slot = nullptr;
+    }
+
+    //! Return a slot with no remaining references to its pool
+    static void _recycle(Slot *slot);
+
+  public:
+    PacketBuffer() = default;
+
+    //! \brief Take ownership of one reference to `slot` (used by BufferPool::allocate)
+    explicit PacketBuffer(Slot *slot) : _slot(slot) {}
+
+    //! \name Copy/move constructor/assignment operators
+    //! Copying shares the slot (and bumps its reference count); moving transfers the reference
+    //!@{
+    PacketBuffer(const PacketBuffer &other) : _slot(other._slot) {
+        if (_slot) {
+            ++_slot->refcount;
+        }
+    }
+    PacketBuffer &operator=(const PacketBuffer &other) {
+        if (this != &other) {
+            PacketBuffer copy{other};
+            std::swap(_slot, copy._slot);
+        }
+        return *this;
+    }
+    PacketBuffer(PacketBuffer &&other) noexcept : _slot(other._slot) { other._slot = nullptr; }
+    PacketBuffer &operator=(PacketBuffer &&other) noexcept {
+        if (this != &other) {
+            _release();
+            _slot = other._slot;
+            other._slot = nullptr;
+        }
+        return *this;
+    }
+    ~PacketBuffer() { _release(); }
+    //!@}
+
+    //! \returns `true` if the handle refers to a slot
+    explicit operator bool() const { return _slot != nullptr; }
+
+    //! \name Access to the slot's bytes
+    //!@{
+    char *data() { return _slot->data(); }
+    const char *data() const { return _slot->data(); }
+    size_t size() const { return _slot ? _slot->length : 0; }
+    size_t capacity() const { return _slot ? _slot->capacity : 0; }
+    std::string_view str() const { return _slot ? std::string_view{_slot->data(), _slot->length} : std::string_view{}; }
+    //!@}
+
+    //! \brief Set the number of valid bytes (e.g. after a read(2) into data()); does not initialize anything
+    void resize(const size_t n) {
+        if (n > capacity()) {
+            throw std::out_of_range("PacketBuffer::resize");
+        }
+        _slot->length = n;
+    }
+};
+
+//! \brief A slab of fixed-size, reference-counted packet buffers
+//! \details A BufferPool maps one contiguous region (optionally backed by huge pages) and hands
+//! out its slots as PacketBuffer objects, so that receiving a packet costs a free-list pop instead
+//! of a heap allocation for the payload and another for a std::shared_ptr control block.
+//!
+//! Slots that have never been used are handed out in address order; recycled slots are kept on a
+//! LIFO free list so that recently-touched (cache-warm) memory is reused first. When every slot is
+//! in use, allocate() returns an empty PacketBuffer and callers are expected to fall back to an
+//! ordinary heap-allocated Buffer.
+//!
+//! Like PacketBuffer, a BufferPool is not thread-safe. If the pool is destroyed while some of its
+//! buffers are still alive, the mapping is released when the last of those buffers goes away.
+class BufferPool {
+  public:
+    static constexpr size_t DEFAULT_SLOT_SIZE = 2048;  //!< Room for one Ethernet-MTU packet
+    static constexpr size_t DEFAULT_SLOT_COUNT = 256;  //!< Number of slots in a default pool
+
+  private:
+    friend class PacketBuffer;
+
+    struct Slab;
+    Slab *_slab;  //!< Bookkeeping for the mapped region; lives at the start of the region itself
+
+  public:
+    //! Map a pool of `slot_count` slots of `slot_size` bytes, using huge pages if requested and available
+    explicit BufferPool(const size_t slot_count = DEFAULT_SLOT_COUNT,
+                        const size_t slot_size = DEFAULT_SLOT_SIZE,
+                        const bool hugepages = false);
+
+    //! Unmap the pool (deferred until the last outstanding PacketBuffer is released)
+    ~BufferPool();
+
+    //! \brief Take a slot from the pool
+    //! \returns a PacketBuffer of size 0, or an empty PacketBuffer if every slot is in use
+    PacketBuffer allocate();
+
+    //! \name Accessors
+    //!@{
+    size_t slot_size() const;     //!< Capacity of each slot, in bytes
+    size_t slot_count() const;    //!< Total number of slots
+    size_t available() const;     //!< Number of slots not currently in use
+    bool uses_hugepages() const;  //!< Whether the slab is backed by explicit huge pages
+    //!@}
+
+    //! \name Copy/move constructor/assignment operators
+    //! BufferPool can be moved, but cannot be copied
+    //!@{
+    BufferPool(const BufferPool &other) = delete;
+    BufferPool &operator=(const BufferPool &other) = delete;
+    BufferPool(BufferPool &&other) noexcept : _slab(other._slab) { other._slab = nullptr; }
+    BufferPool &operator=(BufferPool &&other) noexcept;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_BUFFER_POOL_HH
@@ -0,0 +1,26 @@
+#include "event_fd.hh"
+
+#include "util.hh"
+
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+EventFD::EventFD() : FileDescriptor(SystemCall("eventfd", ::eventfd(0, EFD_CLOEXEC))) {}
+
+//! \note Safe to call from a thread other than the one that reads (or polls) the eventfd, since unlike
+//! FileDescriptor::write it does not touch the FileDescriptor's (non-atomic) write count.
+void EventFD::notify() {
+    const uint64_t one = 1;
+    SystemCall("write", ::write(fd_num(), &one, sizeof(one)));
+}
+
+uint64_t EventFD::consume() {
+    uint64_t count = 0;
+    if (read(reinterpret_cast<char *>(&count), sizeof(count)) != sizeof(count)) {
+        throw runtime_error("EventFD: short read");
+    }
+    return count;
+}
@@ -0,0 +1,22 @@
+#ifndef SPONGE_LIBSPONGE_EVENT_FD_HH
+#define SPONGE_LIBSPONGE_EVENT_FD_HH
+
+#include "file_descriptor.hh"
+
+#include <cstdint>
+
+//! A FileDescriptor to a Linux [eventfd](\ref man2::eventfd) counter, used as a cross-thread wakeup
+class EventFD : public FileDescriptor {
+  public:
+    //! Create an eventfd whose counter starts at zero
+    EventFD();
+
+    //! Add one to the counter, making the eventfd readable
+    void notify();
+
+    //! Wait until the counter is nonzero (unless the eventfd is non-blocking), then reset it
+    //! \returns the value of the counter before it was reset
+    uint64_t consume();
+};
+
+#endif  // SPONGE_LIBSPONGE_EVENT_FD_HH
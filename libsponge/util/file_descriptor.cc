@@ -46,21 +46,52 @@ FileDescriptor FileDescriptor::duplicate() const { return FileDescriptor(_intern
 
 //! \param[in] limit is the maximum number of bytes to read; fewer bytes may be returned
 //! \param[out] str is the string to be read
+//! \details The bytes land in a per-thread scratch buffer and are then copied into `str`, so that
+//! a short read does not pay for zero-filling a large string first.
 void FileDescriptor::read(std::string &str, const size_t limit) {
-    constexpr size_t BUFFER_SIZE = 1024 * 1024;  // maximum size of a read
-    const size_t size_to_read = min(BUFFER_SIZE, limit);
-    str.resize(size_to_read);
+    constexpr size_t BUFFER_SIZE = 64 * 1024;  // maximum size of a read
+    thread_local array<char, BUFFER_SIZE> scratch;
 
-    ssize_t bytes_read = SystemCall("read", ::read(fd_num(), str.data(), size_to_read));
-    if (limit > 0 && bytes_read == 0) {
+    const size_t bytes_read = read(scratch.data(), min(BUFFER_SIZE, limit));
+    str.assign(scratch.data(), bytes_read);
+}
+
+//! \param[out] buffer receives the bytes read
+//! \param[in] length is the maximum number of bytes to read; fewer bytes may be returned
+//! \returns the number of bytes read
+size_t FileDescriptor::read(char *buffer, const size_t length) {
+    const ssize_t bytes_read = SystemCall("read", ::read(fd_num(), buffer, length));
+    if (length > 0 && bytes_read == 0) {
         _internal_fd->_eof = true;
     }
-    if (bytes_read > static_cast<ssize_t>(size_to_read)) {
+    if (bytes_read > static_cast<ssize_t>(length)) {
         throw runtime_error("read() read more than requested");
     }
-    str.resize(bytes_read);
 
     register_read();
+
+    return bytes_read;
+}
+
+//! \param[in] buffers are filled in order; e.g., the result of ByteStream::writable_iovecs()
+//! \returns the total number of bytes read
+size_t FileDescriptor::readv(const vector<iovec> &buffers) {
+    size_t total_length = 0;
+    for (const auto &buffer : buffers) {
+        total_length += buffer.iov_len;
+    }
+
+    const ssize_t bytes_read = SystemCall("readv", ::readv(fd_num(), buffers.data(), buffers.size()));
+    if (total_length > 0 && bytes_read == 0) {
+        _internal_fd->_eof = true;
+    }
+    if (bytes_read > static_cast<ssize_t>(total_length)) {
+        throw runtime_error("readv() read more than requested");
+    }
+
+    register_read();
+
+    return bytes_read;
 }
 
 //! \param[in] limit is the maximum number of bytes to read; fewer bytes may be returned
@@ -73,6 +104,19 @@ string FileDescriptor::read(const size_t limit) {
     return ret;
 }
 
+//! \param[in] pool supplies the storage for the bytes read
+//! \returns a Buffer that shares a slot of `pool`; if the pool is exhausted, the bytes are read into
+//!          an ordinary heap-allocated Buffer instead
+Buffer FileDescriptor::read(BufferPool &pool) {
+    PacketBuffer packet = pool.allocate();
+    if (not packet) {
+        return read(pool.slot_size());
+    }
+
+    packet.resize(read(packet.data(), packet.capacity()));
+    return packet;
+}
+
 size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     size_t total_bytes_written = 0;
 
@@ -7,6 +7,8 @@
 #include <cstddef>
 #include <limits>
 #include <memory>
+#include <sys/uio.h>
+#include <vector>
 
 //! A reference-counted handle to a file descriptor
 class FileDescriptor {
@@ -61,6 +63,15 @@ class FileDescriptor {
     //! Read up to `limit` bytes into `str` (caller can allocate storage)
     void read(std::string &str, const size_t limit = std::numeric_limits<size_t>::max());
 
+    //! Read up to `length` bytes into caller-provided storage, without initializing it first
+    size_t read(char *buffer, const size_t length);
+
+    //! Read into a sequence of caller-provided regions (see [readv(2)](\ref man2::readv))
+    size_t readv(const std::vector<iovec> &buffers);
+
+    //! Read up to one slot's worth of bytes into a Buffer drawn from `pool`
+    Buffer read(BufferPool &pool);
+
     //! Write a string, possibly blocking until all is written
     size_t write(const char *str, const bool write_all = true) { return write(BufferViewList(str), write_all); }
 
@@ -0,0 +1,88 @@
+#include "latency_histogram.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+//! \details Values below 2 * SUB_BUCKETS are their own bucket. A larger value, whose highest set bit
+//! is bit k, is in the (k - SUB_BUCKET_BITS + 1)th group of SUB_BUCKETS buckets, each 2^(k - SUB_BUCKET_BITS)
+//! wide; its position in the group is given by the SUB_BUCKET_BITS bits below its highest one.
+size_t LatencyHistogram::bucket_of(const uint64_t value) {
+    const uint64_t clamped = std::min(value, (uint64_t{1} << MAX_VALUE_BITS) - 1);
+    if (clamped < 2 * SUB_BUCKETS) {
+        return clamped;
+    }
+    const unsigned int top_bit = 63 - __builtin_clzll(clamped);
+    const unsigned int shift = top_bit - SUB_BUCKET_BITS;
+    return SUB_BUCKETS * (shift + 1) + ((clamped >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::highest_in_bucket(const size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+    const unsigned int shift = bucket / SUB_BUCKETS - 1;
+    const uint64_t lowest = uint64_t{bucket % SUB_BUCKETS + SUB_BUCKETS} << shift;
+    return lowest + (uint64_t{1} << shift) - 1;
+}
+
+//! \param[in] value_ns is the latency to count
+void LatencyHistogram::record(const uint64_t value_ns) {
+    if (_counts.empty()) {
+        _counts.resize(BUCKETS);
+        _min = value_ns;
+    }
+    ++_counts[bucket_of(value_ns)];
+    ++_count;
+    _min = std::min(_min, value_ns);
+    _max = std::max(_max, value_ns);
+    _sum += value_ns;
+}
+
+//! \param[in] other is the histogram whose samples are added
+void LatencyHistogram::merge(const LatencyHistogram &other) {
+    if (other._count == 0) {
+        return;
+    }
+    if (_count == 0) {
+        *this = other;
+        return;
+    }
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        _counts[i] += other._counts[i];
+    }
+    _count += other._count;
+    _min = std::min(_min, other._min);
+    _max = std::max(_max, other._max);
+    _sum += other._sum;
+}
+
+//! \param[in] percent is between 0 and 100
+//! \details As in HdrHistogram, the answer is the highest value that is equivalent (falls in the same
+//! bucket) to the sample at that rank, though never more than the largest sample.
+uint64_t LatencyHistogram::percentile(const double percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+    const double clamped = std::min(100.0, std::max(0.0, percent));
+    const uint64_t rank = std::max(uint64_t{1}, static_cast<uint64_t>(ceil(clamped / 100 * _count)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += _counts[i];
+        if (seen >= rank) {
+            return std::min(highest_in_bucket(i), _max);
+        }
+    }
+    return _max;
+}
+
+string LatencyHistogram::summary() const {
+    ostringstream ss;
+    ss << fixed << setprecision(1) << "n=" << _count << " p50=" << percentile(50) / 1e3
+       << "us p99=" << percentile(99) / 1e3 << "us p99.9=" << percentile(99.9) / 1e3 << "us max=" << _max / 1e3
+       << "us";
+    return ss.str();
+}
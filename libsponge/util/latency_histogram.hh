@@ -0,0 +1,60 @@
+#ifndef SPONGE_LIBSPONGE_LATENCY_HISTOGRAM_HH
+#define SPONGE_LIBSPONGE_LATENCY_HISTOGRAM_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! \brief A log-linear histogram of latencies, in the style of HdrHistogram
+//! \details Values (in nanoseconds) below 2 * SUB_BUCKETS are counted exactly. Above that, each
+//! power-of-two range [2^k, 2^(k+1)) is split into SUB_BUCKETS equal buckets, so that any value is
+//! known to within 1/SUB_BUCKETS (about 3%) of itself, whatever its magnitude. Values of 2^MAX_VALUE_BITS
+//! ns (about 18 minutes) or more are counted in the last bucket.
+//!
+//! Recording a value is a few arithmetic operations and an increment. The buckets are only allocated
+//! when the first value is recorded, so an empty histogram is cheap to keep and to copy.
+class LatencyHistogram {
+  public:
+    static constexpr unsigned int SUB_BUCKET_BITS = 5;                   //!< log2 of SUB_BUCKETS
+    static constexpr size_t SUB_BUCKETS = size_t{1} << SUB_BUCKET_BITS;  //!< Buckets per power of two
+    static constexpr unsigned int MAX_VALUE_BITS = 40;                   //!< Values are clamped below 2^this
+    //! Total number of buckets
+    static constexpr size_t BUCKETS = SUB_BUCKETS * (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1);
+
+  private:
+    std::vector<uint64_t> _counts{};  //!< Samples per bucket (empty until the first sample)
+    uint64_t _count{0};               //!< Total number of samples
+    uint64_t _min{0};                 //!< Smallest sample (if any)
+    uint64_t _max{0};                 //!< Largest sample
+    double _sum{0};                   //!< Sum of every sample
+
+    //! The bucket that counts `value`
+    static size_t bucket_of(const uint64_t value);
+
+    //! The largest value counted by `bucket`
+    static uint64_t highest_in_bucket(const size_t bucket);
+
+  public:
+    //! Count one sample of `value_ns` nanoseconds
+    void record(const uint64_t value_ns);
+
+    //! Add every sample of `other` to this histogram
+    void merge(const LatencyHistogram &other);
+
+    //! \name Accessors
+    //!@{
+    uint64_t count() const { return _count; }
+    uint64_t min() const { return _min; }
+    uint64_t max() const { return _max; }
+    double mean() const { return _count ? _sum / _count : 0; }
+
+    //! The value that `percent` percent of the samples are at or below (to within a bucket), or zero if empty
+    uint64_t percentile(const double percent) const;
+
+    //! A one-line summary, in microseconds (e.g. "n=1000 p50=12.1us p99=40.3us p99.9=95.2us max=101.0us")
+    std::string summary() const;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_LATENCY_HISTOGRAM_HH
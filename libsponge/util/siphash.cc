@@ -0,0 +1,78 @@
+#include "siphash.hh"
+
+#include <cstddef>
+#include <random>
+
+using namespace std;
+
+static inline uint64_t rotl(const uint64_t x, const unsigned int bits) { return x << bits | x >> (64 - bits); }
+
+//! The little-endian 64-bit word at `p`
+static inline uint64_t load_le64(const unsigned char *p) {
+    uint64_t word = 0;
+    for (unsigned int i = 0; i < 8; ++i) {
+        word |= uint64_t{p[i]} << (8 * i);
+    }
+    return word;
+}
+
+//! One SipRound on the state `v`
+static inline void sip_round(uint64_t (&v)[4]) {
+    v[0] += v[1];
+    v[1] = rotl(v[1], 13);
+    v[1] ^= v[0];
+    v[0] = rotl(v[0], 32);
+    v[2] += v[3];
+    v[3] = rotl(v[3], 16);
+    v[3] ^= v[2];
+    v[0] += v[3];
+    v[3] = rotl(v[3], 21);
+    v[3] ^= v[0];
+    v[2] += v[1];
+    v[1] = rotl(v[1], 17);
+    v[1] ^= v[2];
+    v[2] = rotl(v[2], 32);
+}
+
+SipHashKey SipHashKey::random() {
+    random_device rd;
+    const auto next = [&] { return uint64_t{rd()} << 32 | rd(); };
+    SipHashKey key;
+    key.k0 = next();
+    key.k1 = next();
+    return key;
+}
+
+//! \param[in] key is the secret key
+//! \param[in] data is the message
+//! \returns the 64-bit tag, as defined by the reference implementation
+uint64_t siphash24(const SipHashKey &key, const string_view data) {
+    uint64_t v[4] = {key.k0 ^ 0x736f6d6570736575, key.k1 ^ 0x646f72616e646f6d, key.k0 ^ 0x6c7967656e657261,
+                     key.k1 ^ 0x7465646279746573};
+
+    const auto *bytes = reinterpret_cast<const unsigned char *>(data.data());
+    const size_t whole_words = data.size() / 8;
+    for (size_t i = 0; i < whole_words; ++i) {
+        const uint64_t m = load_le64(bytes + 8 * i);
+        v[3] ^= m;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= m;
+    }
+
+    // the last word holds the leftover bytes, and the length (mod 256) in its top byte
+    uint64_t last = uint64_t{data.size() & 0xff} << 56;
+    for (size_t i = 8 * whole_words; i < data.size(); ++i) {
+        last |= uint64_t{bytes[i]} << (8 * (i - 8 * whole_words));
+    }
+    v[3] ^= last;
+    sip_round(v);
+    sip_round(v);
+    v[0] ^= last;
+
+    v[2] ^= 0xff;
+    for (unsigned int i = 0; i < 4; ++i) {
+        sip_round(v);
+    }
+    return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
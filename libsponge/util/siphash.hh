@@ -0,0 +1,22 @@
+#ifndef SPONGE_LIBSPONGE_SIPHASH_HH
+#define SPONGE_LIBSPONGE_SIPHASH_HH
+
+#include <cstdint>
+#include <string_view>
+
+//! A 128-bit key for siphash24()
+struct SipHashKey {
+    uint64_t k0{};  //!< First half (bytes 0 to 7, little-endian)
+    uint64_t k1{};  //!< Second half (bytes 8 to 15, little-endian)
+
+    //! A key drawn from std::random_device
+    static SipHashKey random();
+};
+
+//! \brief SipHash-2-4 of `data` under `key`
+//! \details SipHash (Aumasson and Bernstein, 2012) is a keyed pseudorandom function: without the key,
+//! its output can neither be predicted nor steered, so it is safe to use on input chosen by a remote
+//! peer (e.g. for hash-table buckets, or for SYN cookies). It is fast on short inputs.
+uint64_t siphash24(const SipHashKey &key, std::string_view data);
+
+#endif  // SPONGE_LIBSPONGE_SIPHASH_HH
@@ -2,7 +2,11 @@
 
 #include "util.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstddef>
+#include <cstring>
+#include <netinet/udp.h>
 #include <stdexcept>
 #include <unistd.h>
 
@@ -112,6 +116,132 @@ UDPSocket::received_datagram UDPSocket::recv(const size_t mtu) {
     return ret;
 }
 
+//! \note A datagram too large for one slot of `pool` is consumed and returned with an empty payload.
+//! If the pool is exhausted, the payload is received into an ordinary heap-allocated Buffer.
+UDPSocket::pooled_datagram UDPSocket::recv(BufferPool &pool) {
+    PacketBuffer packet = pool.allocate();
+    if (not packet) {
+        auto datagram = recv();
+        if (datagram.payload.size() > pool.slot_size()) {
+            datagram.payload.clear();
+        }
+        return {datagram.source_address, move(datagram.payload)};
+    }
+
+    Address::Raw datagram_source_address;
+    socklen_t fromlen = sizeof(datagram_source_address);
+
+    const ssize_t recv_len = SystemCall(
+        "recvfrom",
+        ::recvfrom(fd_num(), packet.data(), packet.capacity(), MSG_TRUNC, datagram_source_address, &fromlen));
+
+    register_read();
+
+    if (recv_len > ssize_t(packet.capacity())) {
+        return {{datagram_source_address, fromlen}, {}};
+    }
+
+    packet.resize(recv_len);
+    return {{datagram_source_address, fromlen}, move(packet)};
+}
+
+//! \param[out] datagrams is replaced by the datagrams received, in order
+//! \param[in] pool supplies the storage for the payloads
+//! \param[in] max_datagrams is the largest number of datagrams to return (capped at UDPSocket::MAX_BATCH)
+//! \details Blocks (if the socket is blocking) until one datagram is available, then collects whatever
+//! else is already queued, all with one [recvmmsg(2)](\ref man2::recvmmsg) call.
+//! As with recv(BufferPool&), a datagram too large for one slot has an empty payload. If the pool
+//! cannot supply even one slot, this falls back to a single recv().
+//!
+//! With GRO enabled (see set_gro()), each coalesced datagram is split back into the datagrams it was
+//! made of (all sharing one slot), so more than `max_datagrams` datagrams may be returned.
+void UDPSocket::recv_many(vector<pooled_datagram> &datagrams, BufferPool &pool, const size_t max_datagrams) {
+    datagrams.clear();
+
+    array<PacketBuffer, MAX_BATCH> packets;
+    size_t batch_size = 0;
+    for (; batch_size < min(max_datagrams, MAX_BATCH); batch_size++) {
+        packets[batch_size] = pool.allocate();
+        if (not packets[batch_size]) {
+            break;
+        }
+    }
+
+    if (batch_size == 0) {
+        if (max_datagrams > 0) {
+            datagrams.push_back(recv(pool));
+        }
+        return;
+    }
+
+    // room for the UDP_GRO control message, suitably aligned
+    union GROControl {
+        char buf[CMSG_SPACE(sizeof(int))];
+        cmsghdr align;
+    };
+
+    array<Address::Raw, MAX_BATCH> source_addresses;
+    array<iovec, MAX_BATCH> iovecs;
+    array<GROControl, MAX_BATCH> controls;
+    array<mmsghdr, MAX_BATCH> messages;
+    for (size_t i = 0; i < batch_size; i++) {
+        iovecs[i] = {packets[i].data(), packets[i].capacity()};
+        messages[i] = {};
+        messages[i].msg_hdr.msg_name = static_cast<sockaddr *>(source_addresses[i]);
+        messages[i].msg_hdr.msg_namelen = sizeof(source_addresses[i]);
+        messages[i].msg_hdr.msg_iov = &iovecs[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+        if (_gro) {
+            messages[i].msg_hdr.msg_control = controls[i].buf;
+            messages[i].msg_hdr.msg_controllen = sizeof(controls[i].buf);
+        }
+    }
+
+    const int received =
+        SystemCall("recvmmsg", ::recvmmsg(fd_num(), messages.data(), batch_size, MSG_WAITFORONE, nullptr));
+
+    register_read();
+
+    for (int i = 0; i < received; i++) {
+        msghdr &header = messages[i].msg_hdr;
+        const Address source_address{source_addresses[i], header.msg_namelen};
+        if (header.msg_flags & MSG_TRUNC) {
+            datagrams.push_back({source_address, {}});
+            continue;
+        }
+
+        size_t segment_size = 0;
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP and cmsg->cmsg_type == UDP_GRO) {
+                int gso_size = 0;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                segment_size = gso_size;
+            }
+        }
+
+        const size_t length = messages[i].msg_len;
+        packets[i].resize(length);
+        Buffer payload{move(packets[i])};
+        if (segment_size == 0 or length <= segment_size) {
+            datagrams.push_back({source_address, move(payload)});
+            continue;
+        }
+
+        for (size_t offset = 0; offset < length; offset += segment_size) {
+            Buffer segment = payload;
+            segment.remove_prefix(offset);
+            segment.remove_suffix(length - min(length, offset + segment_size));
+            datagrams.push_back({source_address, move(segment)});
+        }
+    }
+}
+
+//! \param[in] enabled is `true` to have the kernel coalesce consecutive datagrams from the same flow
+void UDPSocket::set_gro(const bool enabled) {
+    setsockopt(SOL_UDP, UDP_GRO, int(enabled));
+    _gro = enabled;
+}
+
 void sendmsg_helper(const int fd_num,
                     const sockaddr *destination_address,
                     const socklen_t destination_address_len,
@@ -141,6 +271,81 @@ void UDPSocket::send(const BufferViewList &payload) {
     register_write();
 }
 
+//! \param[in] destination is the Address to which every datagram is sent
+//! \param[in] payloads are the datagram payloads, sent in order
+//! \details Datagrams are handed to the kernel up to UDPSocket::MAX_BATCH messages at a time with
+//! [sendmmsg(2)](\ref man2::sendmmsg); like sendto(), this throws if any datagram cannot be sent whole.
+//!
+//! With GSO enabled (see set_gso()), each run of consecutive equal-sized payloads (plus an optional
+//! shorter one ending the run) becomes a single message carrying a UDP_SEGMENT control message, and
+//! the kernel splits it back into separate datagrams.
+void UDPSocket::send_many(const Address &destination, const vector<BufferViewList> &payloads) {
+    // room for the UDP_SEGMENT control message, suitably aligned
+    union GSOControl {
+        char buf[CMSG_SPACE(sizeof(uint16_t))];
+        cmsghdr align;
+    };
+
+    array<vector<iovec>, MAX_BATCH> iovecs;
+    array<GSOControl, MAX_BATCH> controls;
+    array<size_t, MAX_BATCH> message_sizes;
+    array<size_t, MAX_BATCH> message_counts;
+    array<mmsghdr, MAX_BATCH> messages;
+
+    size_t sent = 0;
+    while (sent < payloads.size()) {
+        // group the unsent payloads into messages
+        size_t batch_size = 0;
+        for (size_t next = sent; batch_size < MAX_BATCH and next < payloads.size(); batch_size++) {
+            const size_t segment_size = payloads[next].size();
+            size_t count = 0;
+            size_t total_size = 0;
+            iovecs[batch_size].clear();
+            do {
+                const size_t size = payloads[next].size();
+                const auto payload_iovecs = payloads[next].as_iovecs();
+                iovecs[batch_size].insert(iovecs[batch_size].end(), payload_iovecs.begin(), payload_iovecs.end());
+                total_size += size;
+                count++;
+                next++;
+                if (size < segment_size) {
+                    break;  // a shorter datagram can only end a run
+                }
+            } while (_gso and next < payloads.size() and count < MAX_GSO_SEGMENTS and segment_size > 0 and
+                     payloads[next].size() <= segment_size and total_size + payloads[next].size() <= MAX_GSO_BYTES);
+
+            messages[batch_size] = {};
+            msghdr &header = messages[batch_size].msg_hdr;
+            header.msg_name = const_cast<sockaddr *>(static_cast<const sockaddr *>(destination));
+            header.msg_namelen = destination.size();
+            header.msg_iov = iovecs[batch_size].data();
+            header.msg_iovlen = iovecs[batch_size].size();
+            if (count > 1) {
+                header.msg_control = controls[batch_size].buf;
+                header.msg_controllen = sizeof(controls[batch_size].buf);
+                cmsghdr *cmsg = CMSG_FIRSTHDR(&header);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const auto gso_size = static_cast<uint16_t>(segment_size);
+                memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+            }
+            message_sizes[batch_size] = total_size;
+            message_counts[batch_size] = count;
+        }
+
+        const int batch_sent = SystemCall("sendmmsg", ::sendmmsg(fd_num(), messages.data(), batch_size, 0));
+        register_write();
+
+        for (int i = 0; i < batch_sent; i++) {
+            if (messages[i].msg_len != message_sizes[i]) {
+                throw runtime_error("datagram payload too big for sendmmsg()");
+            }
+            sent += message_counts[i];
+        }
+    }
+}
+
 // mark the socket as listening for incoming connections
 //! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
 void TCPSocket::listen(const int backlog) { SystemCall("listen", ::listen(fd_num(), backlog)); }
@@ -166,3 +371,10 @@ void Socket::setsockopt(const int level, const int option, const option_type &op
 // allow local address to be reused sooner, at the cost of some robustness
 //! \note Using `SO_REUSEADDR` may reduce the robustness of your application
 void Socket::set_reuseaddr() { setsockopt(SOL_SOCKET, SO_REUSEADDR, int(true)); }
+
+// the kernel picks one socket of the group for each datagram or connection, by a hash of its addresses
+void Socket::set_reuseport() { setsockopt(SOL_SOCKET, SO_REUSEPORT, int(true)); }
+
+// a socket shared by many peers (e.g. a TCPStack's) can overflow the default buffer when they all send at once
+//! \param[in] bytes is the requested size of the receive buffer
+void Socket::set_receive_buffer_size(const int bytes) { setsockopt(SOL_SOCKET, SO_RCVBUF, bytes); }
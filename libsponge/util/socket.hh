@@ -8,6 +8,7 @@
 #include <functional>
 #include <string>
 #include <sys/socket.h>
+#include <vector>
 
 //! \brief Base class for network sockets (TCP, UDP, etc.)
 //! \details Socket is generally used via a subclass. See TCPSocket and UDPSocket for usage examples.
@@ -45,10 +46,20 @@ class Socket : public FileDescriptor {
 
     //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
     void set_reuseaddr();
+
+    //! Let several sockets bind the same address via [SO_REUSEPORT](\ref man7::socket), spreading flows among them
+    void set_reuseport();
+
+    //! Ask for a kernel receive buffer of `bytes` via [SO_RCVBUF](\ref man7::socket) (capped by `rmem_max`)
+    void set_receive_buffer_size(const int bytes);
 };
 
 //! A wrapper around [UDP sockets](\ref man7::udp)
 class UDPSocket : public Socket {
+  private:
+    bool _gso{false};  //!< Does send_many() coalesce equal-sized datagrams with UDP_SEGMENT?
+    bool _gro{false};  //!< Has UDP_GRO been enabled (so that recv_many() must split coalesced datagrams)?
+
   protected:
     //! \brief Construct from FileDescriptor (used by TCPOverUDPSocketAdapter)
     //! \param[in] fd is the FileDescriptor from which to construct
@@ -70,11 +81,50 @@ class UDPSocket : public Socket {
     //! Receive a datagram and the Address of its sender (caller can allocate storage)
     void recv(received_datagram &datagram, const size_t mtu = 65536);
 
+    //! Returned by UDPSocket::recv when reading into a BufferPool; the payload shares a slot of the pool
+    struct pooled_datagram {
+        Address source_address;  //!< Address from which this datagram was received
+        Buffer payload;          //!< UDP datagram payload (empty if it did not fit in a slot)
+    };
+
+    //! Receive a datagram, and the Address of its sender, into a Buffer drawn from `pool`
+    pooled_datagram recv(BufferPool &pool);
+
+    //! Largest number of datagrams moved by one call to [recvmmsg(2)](\ref man2::recvmmsg) or
+    //! [sendmmsg(2)](\ref man2::sendmmsg)
+    static constexpr size_t MAX_BATCH = 64;
+
+    //! Receive up to `max_datagrams` datagrams (at least one) into Buffers drawn from `pool`
+    void recv_many(std::vector<pooled_datagram> &datagrams, BufferPool &pool, const size_t max_datagrams = MAX_BATCH);
+
     //! Send a datagram to specified Address
     void sendto(const Address &destination, const BufferViewList &payload);
 
     //! Send datagram to the socket's connected address (must call connect() first)
     void send(const BufferViewList &payload);
+
+    //! Send a sequence of datagrams to specified Address, with as few system calls as possible
+    void send_many(const Address &destination, const std::vector<BufferViewList> &payloads);
+
+    //! \name Segmentation offload (see [udp(7)](\ref man7::udp))
+    //!@{
+
+    //! Largest number of datagrams coalesced into one UDP_SEGMENT send (the kernel's UDP_MAX_SEGMENTS)
+    static constexpr size_t MAX_GSO_SEGMENTS = 64;
+
+    //! Largest total payload of one UDP_SEGMENT send
+    static constexpr size_t MAX_GSO_BYTES = 65000;
+
+    //! Let send_many() hand runs of equal-sized datagrams to the kernel as one UDP_SEGMENT send
+    void set_gso(const bool enabled) { _gso = enabled; }
+
+    //! Ask the kernel to coalesce received datagrams with UDP_GRO; recv_many() splits them up again
+    //! \note With GRO enabled, use recv_many(): the other recv() calls would return coalesced payloads
+    void set_gro(const bool enabled);
+
+    bool gso() const { return _gso; }  //!< Is UDP_SEGMENT in use by send_many()?
+    bool gro() const { return _gro; }  //!< Is UDP_GRO enabled?
+    //!@}
 };
 
 //! \class UDPSocket
@@ -0,0 +1,95 @@
+#include "spsc_ring.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+// The indices are accessed with sequentially-consistent operations: a side that publishes its own
+// index and then reads the other side's must not have those two reordered, or a producer and a
+// consumer could each conclude that the other will send the wakeup.
+
+//! \param[in] capacity is the minimum number of bytes the ring must hold
+SPSCRing::SPSCRing(const size_t capacity) : _data(), _mask(0) {
+    if (capacity == 0) {
+        throw runtime_error("SPSCRing: capacity must be positive");
+    }
+    size_t rounded = 1;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    _data = make_unique<char[]>(rounded);
+    _mask = rounded - 1;
+}
+
+//! \param[in] data is the bytes to append to the ring
+size_t SPSCRing::push(string_view data) {
+    if (_closed.load()) {
+        return 0;
+    }
+
+    const size_t head = _head.load(memory_order_relaxed);
+    const size_t free_space = capacity() - (head - _tail.load());
+    const size_t len = min(data.size(), free_space);
+    if (len == 0) {
+        return 0;
+    }
+
+    const size_t offset = head & _mask;
+    const size_t first_part = min(len, capacity() - offset);
+    memcpy(_data.get() + offset, data.data(), first_part);
+    memcpy(_data.get(), data.data() + first_part, len - first_part);
+
+    _head.store(head + len);
+    if (_tail.load() == head) {  // the consumer had drained everything, and may be asleep
+        _readable.notify();
+    }
+    return len;
+}
+
+string_view SPSCRing::peek() const {
+    const size_t tail = _tail.load(memory_order_relaxed);
+    const size_t available = _head.load() - tail;
+    const size_t offset = tail & _mask;
+    return {_data.get() + offset, min(available, capacity() - offset)};
+}
+
+//! \param[in] n is the number of bytes to discard from the front of the ring
+void SPSCRing::pop(const size_t n) {
+    const size_t tail = _tail.load(memory_order_relaxed);
+    if (n > _head.load() - tail) {
+        throw out_of_range("SPSCRing::pop");
+    }
+    if (n == 0) {
+        return;
+    }
+
+    _tail.store(tail + n);
+    if (_head.load() - tail == capacity()) {  // the producer had filled the ring, and may be asleep
+        _writable.notify();
+    }
+}
+
+//! \param[out] buffer receives the bytes
+//! \param[in] length is the largest number of bytes to copy
+size_t SPSCRing::pop(char *buffer, const size_t length) {
+    size_t copied = 0;
+    while (copied < length) {
+        const string_view chunk = peek();
+        const size_t len = min(chunk.size(), length - copied);
+        if (len == 0) {
+            break;
+        }
+        memcpy(buffer + copied, chunk.data(), len);
+        pop(len);
+        copied += len;
+    }
+    return copied;
+}
+
+void SPSCRing::close() {
+    _closed.store(true);
+    _readable.notify();
+    _writable.notify();
+}
@@ -0,0 +1,96 @@
+#ifndef SPONGE_LIBSPONGE_SPSC_RING_HH
+#define SPONGE_LIBSPONGE_SPSC_RING_HH
+
+#include "event_fd.hh"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+//! \brief A lock-free single-producer/single-consumer byte ring, with eventfd wakeups
+//! \details One thread (the producer) calls push(); another (the consumer) calls peek()/pop().
+//! Neither side ever takes a lock or makes a system call on the fast path: the producer notifies
+//! readable_fd() only when it adds bytes to a ring that the consumer has seen empty, and the
+//! consumer notifies writable_fd() only when it frees space in a ring that the producer has seen
+//! full. A side that finds the ring empty (or full) can therefore sleep on the corresponding
+//! EventFD (by polling it, or with wait_readable() and wait_writable()) without missing a wakeup.
+//!
+//! Either side may close() the ring. After that, push() accepts nothing, and the consumer can
+//! drain what is left before seeing end-of-stream (closed() and empty()).
+class SPSCRing {
+  private:
+    //! Keep the producer's and the consumer's indices on separate cache lines
+    static constexpr size_t CACHE_LINE = 64;
+
+    std::unique_ptr<char[]> _data;  //!< The bytes of the ring
+    size_t _mask;                   //!< Capacity minus one (the capacity is a power of two)
+
+    alignas(CACHE_LINE) std::atomic<size_t> _head{0};  //!< Total bytes ever pushed (written by the producer)
+    alignas(CACHE_LINE) std::atomic<size_t> _tail{0};  //!< Total bytes ever popped (written by the consumer)
+    alignas(CACHE_LINE) std::atomic<bool> _closed{false};
+
+    EventFD _readable{};  //!< Notified when bytes arrive in an empty ring, or on close()
+    EventFD _writable{};  //!< Notified when space opens up in a full ring, or on close()
+
+  public:
+    //! Allocate a ring of at least `capacity` bytes (rounded up to a power of two)
+    explicit SPSCRing(const size_t capacity);
+
+    //! \name Producer interface
+    //!@{
+
+    //! Copy as much of `data` into the ring as fits
+    //! \returns the number of bytes accepted (zero if the ring is full or closed)
+    size_t push(std::string_view data);
+
+    //! Block until the consumer has made space (or closed the ring)
+    void wait_writable() { _writable.consume(); }
+
+    //! Becomes readable when the consumer frees space that the producer may be waiting for
+    const EventFD &writable_fd() const { return _writable; }
+    //!@}
+
+    //! \name Consumer interface
+    //!@{
+
+    //! \returns a view of the next contiguous run of bytes in the ring (possibly not all of them)
+    std::string_view peek() const;
+
+    //! Discard `n` bytes that were returned by peek()
+    void pop(const size_t n);
+
+    //! Copy up to `length` bytes out of the ring and discard them
+    //! \returns the number of bytes copied
+    size_t pop(char *buffer, const size_t length);
+
+    //! Block until the producer has added bytes (or closed the ring)
+    void wait_readable() { _readable.consume(); }
+
+    //! Becomes readable when bytes arrive that the consumer may be waiting for
+    const EventFD &readable_fd() const { return _readable; }
+    //!@}
+
+    //! Mark the end of the stream (and wake up both sides)
+    void close();
+
+    //! \name Accessors (exact for the calling side; a snapshot for the other one)
+    //!@{
+    bool closed() const { return _closed.load(); }
+    size_t size() const { return _head.load() - _tail.load(); }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return _mask + 1; }
+    //!@}
+
+    //! \name
+    //! An SPSCRing is shared by two threads, so it cannot be copied or moved
+
+    //!@{
+    SPSCRing(const SPSCRing &) = delete;
+    SPSCRing &operator=(const SPSCRing &) = delete;
+    SPSCRing(SPSCRing &&) = delete;
+    SPSCRing &operator=(SPSCRing &&) = delete;
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_SPSC_RING_HH
@@ -0,0 +1,160 @@
+#ifndef SPONGE_LIBSPONGE_STATIC_EVENTLOOP_HH
+#define SPONGE_LIBSPONGE_STATIC_EVENTLOOP_HH
+
+#include "eventloop.hh"
+#include "file_descriptor.hh"
+#include "util.hh"
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <poll.h>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+//! \brief An EventLoop whose handlers are known at compile time
+//! \details Each handler is an object with an `fd_num()` method and `on_readable()`, `on_writable()`
+//! and `on_hangup()` methods (see FdHandler). Handler `i` is polled on `fd_num()` for the directions
+//! enabled with set_interest(); all of them start out uninterested.
+//!
+//! Unlike EventLoop, nothing is called to decide what to poll: the pollfds live in one array that the
+//! owner updates with set_interest() when its state changes, and wait_next_event() passes that array
+//! straight to [poll(2)](\ref man2::poll). Dispatch is a direct (and usually inlined) call to each
+//! ready handler.
+//!
+//! A handler that is ready but not interested is skipped. A handler whose fd hangs up without being
+//! ready loses all interest, and its `on_hangup()` is called. As with EventLoop, a poll error throws
+//! std::runtime_error; unlike EventLoop, a callback that neither reads nor writes is not detected.
+template <typename... Handlers>
+class StaticEventLoop {
+  public:
+    //! Number of handlers
+    static constexpr size_t size = sizeof...(Handlers);
+
+  private:
+    std::tuple<Handlers &...> _handlers;
+    std::array<int, size> _fds{};         //!< Each handler's fd
+    std::array<pollfd, size> _pollfds{};  //!< What to poll; an uninterested handler has a negative fd
+    size_t _interested{0};                //!< Number of handlers with some interest
+
+    template <size_t I>
+    void _dispatch() {
+        pollfd &entry = _pollfds[I];
+        if (entry.revents == 0) {
+            return;
+        }
+        if (entry.revents & (POLLERR | POLLNVAL)) {
+            throw std::runtime_error("StaticEventLoop: error on polled file descriptor");
+        }
+
+        auto &handler = std::get<I>(_handlers);
+        const bool readable = entry.revents & POLLIN;
+        const bool writable = entry.revents & POLLOUT;
+        if (not readable and not writable and (entry.revents & POLLHUP)) {
+            set_interest(I, Direction::In, false);
+            set_interest(I, Direction::Out, false);
+            handler.on_hangup();
+            return;
+        }
+
+        // each check sees the current interest, in case an earlier callback changed it
+        if (readable and (entry.events & POLLIN)) {
+            handler.on_readable();
+        }
+        if (writable and (entry.events & POLLOUT)) {
+            handler.on_writable();
+        }
+    }
+
+    template <size_t... I>
+    void _dispatch_all(std::index_sequence<I...>) {
+        (_dispatch<I>(), ...);
+    }
+
+  public:
+    //! Poll each handler on its `fd_num()`
+    explicit StaticEventLoop(Handlers &... handlers) : _handlers(handlers...), _fds{handlers.fd_num()...} {
+        for (size_t i = 0; i < size; ++i) {
+            _pollfds[i] = {-1, 0, 0};
+        }
+    }
+
+    //! Start or stop polling handler `index` in `direction`
+    void set_interest(const size_t index, const Direction direction, const bool enabled) {
+        pollfd &entry = _pollfds[index];
+        const bool was_interested = entry.events != 0;
+        if (enabled) {
+            entry.events |= static_cast<short>(direction);
+        } else {
+            entry.events &= ~static_cast<short>(direction);
+        }
+        const bool interested = entry.events != 0;
+        entry.fd = interested ? _fds[index] : -1;
+        _interested += interested;
+        _interested -= was_interested;
+    }
+
+    //! Is handler `index` polled in `direction`?
+    bool interest(const size_t index, const Direction direction) const {
+        return _pollfds[index].events & static_cast<short>(direction);
+    }
+
+    //! Calls [poll(2)](\ref man2::poll) and then the callbacks of each ready handler, in order
+    //! \returns Result::Exit if no handler is interested (or a signal arrived), Result::Timeout if none was
+    //! ready after `timeout_ms`, and otherwise Result::Success
+    EventLoop::Result wait_next_event(const int timeout_ms) {
+        if (_interested == 0) {
+            return EventLoop::Result::Exit;
+        }
+
+        try {
+            if (0 == SystemCall("poll", ::poll(_pollfds.data(), size, timeout_ms))) {
+                return EventLoop::Result::Timeout;
+            }
+        } catch (unix_error const &e) {
+            if (e.code().value() == EINTR) {
+                return EventLoop::Result::Exit;
+            }
+            throw;
+        }
+
+        _dispatch_all(std::index_sequence_for<Handlers...>{});
+        return EventLoop::Result::Success;
+    }
+};
+
+//! Does nothing (the default for the callbacks of an FdHandler)
+struct NoOpCallback {
+    void operator()() const {}
+};
+
+//! \brief A handler for a StaticEventLoop made from an fd and up to three callables
+//! \details Because the callables' types (e.g. lambdas) are template parameters, calls to them can be inlined.
+template <typename ReadF, typename WriteF = NoOpCallback, typename HangupF = NoOpCallback>
+class FdHandler {
+  private:
+    int _fd_num;
+    ReadF _on_readable;
+    WriteF _on_writable;
+    HangupF _on_hangup;
+
+  public:
+    //! \param[in] fd is the file descriptor to poll (it must outlive the handler)
+    //! \param[in] on_readable is called when `fd` is readable
+    //! \param[in] on_writable is called when `fd` is writable
+    //! \param[in] on_hangup is called when `fd` hangs up
+    FdHandler(const FileDescriptor &fd, ReadF on_readable, WriteF on_writable = {}, HangupF on_hangup = {})
+        : _fd_num(fd.fd_num())
+        , _on_readable(std::move(on_readable))
+        , _on_writable(std::move(on_writable))
+        , _on_hangup(std::move(on_hangup)) {}
+
+    int fd_num() const { return _fd_num; }  //!< The file descriptor to poll
+
+    void on_readable() { _on_readable(); }  //!< Called when readable
+    void on_writable() { _on_writable(); }  //!< Called when writable
+    void on_hangup() { _on_hangup(); }      //!< Called on hangup
+};
+
+#endif  // SPONGE_LIBSPONGE_STATIC_EVENTLOOP_HH
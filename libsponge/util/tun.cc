@@ -10,22 +10,36 @@
 
 static constexpr const char *CLONEDEV = "/dev/net/tun";
 
+static_assert(sizeof(VirtioNetHeader) == 10, "VirtioNetHeader must match struct virtio_net_hdr");
+
 using namespace std;
 
 //! \param[in] devname is the name of the TUN or TAP device, specified at its creation.
 //! \param[in] is_tun is `true` for a TUN device (expects IP datagrams), or `false` for a TAP device (expects Ethernet frames)
+//! \param[in] multi_queue attaches one more queue to a multiqueue device, as `IFF_MULTI_QUEUE`
+//! \param[in] vnet_hdr prefixes every packet with a VirtioNetHeader, as `IFF_VNET_HDR`
 //!
 //! To create a TUN device, you should already have run
 //!
 //!     ip tuntap add mode tun user `username` name `devname`
 //!
-//! as root before calling this function.
+//! as root before calling this function (adding `multi_queue` for a device with several queues).
+//!
+//! With `vnet_hdr`, the kernel is also told that we handle partial checksums and TCP segmentation
+//! offload, so it can hand us TCP frames larger than the MTU and without a finished checksum (see
+//! TCPOverIPv4OverTunFdAdapter).
 
-TunTapFD::TunTapFD(const string &devname, const bool is_tun)
-    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))) {
+TunTapFD::TunTapFD(const string &devname, const bool is_tun, const bool multi_queue, const bool vnet_hdr)
+    : FileDescriptor(SystemCall("open", open(CLONEDEV, O_RDWR))), _vnet_hdr(vnet_hdr) {
     struct ifreq tun_req {};
 
     tun_req.ifr_flags = (is_tun ? IFF_TUN : IFF_TAP) | IFF_NO_PI;  // tun device with no packetinfo
+    if (multi_queue) {
+        tun_req.ifr_flags |= IFF_MULTI_QUEUE;
+    }
+    if (vnet_hdr) {
+        tun_req.ifr_flags |= IFF_VNET_HDR;
+    }
 
     // copy devname to ifr_name, making sure to null terminate
 
@@ -33,4 +47,23 @@ TunTapFD::TunTapFD(const string &devname, const bool is_tun)
     tun_req.ifr_name[IFNAMSIZ - 1] = '\0';
 
     SystemCall("ioctl", ioctl(fd_num(), TUNSETIFF, static_cast<void *>(&tun_req)));
+
+    if (vnet_hdr) {
+        int header_size = sizeof(VirtioNetHeader);
+        SystemCall("ioctl", ioctl(fd_num(), TUNSETVNETHDRSZ, &header_size));
+        SystemCall("ioctl", ioctl(fd_num(), TUNSETOFFLOAD, TUN_F_CSUM | TUN_F_TSO4));
+    }
+}
+
+//! \param[in] devname is the name of the TUN device, which must have been created with `multi_queue`
+//! \param[in] count is the number of queues to open
+//! \param[in] vnet_hdr enables `IFF_VNET_HDR` on every queue
+//! \details The kernel spreads packets among the queues by a hash of each packet's flow.
+vector<TunFD> TunFD::open_queues(const string &devname, const size_t count, const bool vnet_hdr) {
+    vector<TunFD> queues;
+    queues.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        queues.emplace_back(devname, true, vnet_hdr);
+    }
+    return queues;
 }
@@ -3,20 +3,55 @@
 
 #include "file_descriptor.hh"
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+//! \brief The header before every packet on a TUN/TAP device opened with `IFF_VNET_HDR`
+//! \details This is `struct virtio_net_hdr` from `<linux/virtio_net.h>` (which can't be included from
+//! C++), in host byte order.
+struct VirtioNetHeader {
+    static constexpr uint8_t F_NEEDS_CSUM = 1;  //!< Only the pseudo-header is summed; finish from csum_start
+    static constexpr uint8_t F_DATA_VALID = 2;  //!< The checksum has already been verified
+    static constexpr uint8_t GSO_NONE = 0;      //!< Not a segmentation-offload frame
+
+    uint8_t flags = 0;         //!< F_NEEDS_CSUM and/or F_DATA_VALID
+    uint8_t gso_type = 0;      //!< GSO_NONE, or the kind of oversized frame (e.g. TCPv4)
+    uint16_t hdr_len = 0;      //!< Length of the headers of an oversized frame
+    uint16_t gso_size = 0;     //!< Payload size of each segment of an oversized frame
+    uint16_t csum_start = 0;   //!< Where checksumming starts (for F_NEEDS_CSUM)
+    uint16_t csum_offset = 0;  //!< Where to store the checksum, relative to csum_start
+};
 
 //! A FileDescriptor to a [Linux TUN/TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunTapFD : public FileDescriptor {
+  private:
+    bool _vnet_hdr;  //!< Does every packet start with a VirtioNetHeader?
+
   public:
     //! Open an existing persistent [TUN or TAP device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-    explicit TunTapFD(const std::string &devname, const bool is_tun);
+    explicit TunTapFD(const std::string &devname,
+                      const bool is_tun,
+                      const bool multi_queue = false,
+                      const bool vnet_hdr = false);
+
+    //! Does every packet read or written start with a VirtioNetHeader (see TunFD::open_queues)?
+    bool vnet_hdr() const { return _vnet_hdr; }
 };
 
 //! A FileDescriptor to a [Linux TUN](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
 class TunFD : public TunTapFD {
   public:
     //! Open an existing persistent [TUN device](https://www.kernel.org/doc/Documentation/networking/tuntap.txt).
-    explicit TunFD(const std::string &devname) : TunTapFD(devname, true) {}
+    //! \param[in] devname is the name of the TUN device
+    //! \param[in] multi_queue opens one more queue of a device created with `multi_queue` (`IFF_MULTI_QUEUE`)
+    //! \param[in] vnet_hdr enables `IFF_VNET_HDR` along with checksum and TSO offloads
+    explicit TunFD(const std::string &devname, const bool multi_queue = false, const bool vnet_hdr = false)
+        : TunTapFD(devname, true, multi_queue, vnet_hdr) {}
+
+    //! Open `count` queues of the same multiqueue TUN device (e.g. one per worker thread)
+    static std::vector<TunFD> open_queues(const std::string &devname, const size_t count, const bool vnet_hdr = false);
 };
 
 //! A FileDescriptor to a [Linux TAP](https://www.kernel.org/doc/Documentation/networking/tuntap.txt) device
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <pthread.h>
+#include <sched.h>
 #include <sstream>
 #include <sys/socket.h>
 
@@ -69,6 +71,31 @@ mt19937 get_random_generator() {
     return mt19937(seed);
 }
 
+//! \param[in] cpu is the index of the CPU to run on, among those the thread is allowed to run on
+//! \details The allowed CPUs (e.g. set by `taskset`, or by a container's cpuset) need not be numbered
+//! from zero or be contiguous, so `cpu` counts only those, in increasing order.
+bool pin_current_thread(const unsigned int cpu) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 or CPU_COUNT(&allowed) == 0) {
+        return false;
+    }
+
+    unsigned int remaining = cpu % static_cast<unsigned int>(CPU_COUNT(&allowed));
+    for (int id = 0; id < CPU_SETSIZE; ++id) {
+        if (not CPU_ISSET(id, &allowed)) {
+            continue;
+        }
+        if (remaining-- == 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(id, &cpus);
+            return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+        }
+    }
+    return false;
+}
+
 //! \note This class returns the checksum in host byte order.
 //!       See https://commandcenter.blogspot.com/2012/04/byte-order-fallacy.html for rationale
 //! \details This class can be used to either check or compute an Internet checksum
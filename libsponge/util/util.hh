@@ -51,6 +51,10 @@ std::mt19937 get_random_generator();
 //! Get the time in milliseconds since the program began.
 uint64_t timestamp_ms();
 
+//! Pin the calling thread to the `cpu`th of the CPUs it may run on (modulo their number); best effort
+//! \returns `true` if the thread was pinned
+bool pin_current_thread(const unsigned int cpu);
+
 //! The internet checksum algorithm
 class InternetChecksum {
   private:
@@ -0,0 +1,157 @@
+#include "buffer_pool.hh"
+
+#include "buffer.hh"
+#include "test_should_be.hh"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//! Is the page holding `address` mapped?
+static bool mapped(const void *address) {
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    void *page = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(address) & ~(page_size - 1));
+    if (msync(page, page_size, MS_ASYNC) == 0) {
+        return true;
+    }
+    if (errno != ENOMEM) {
+        throw runtime_error("msync: "s + strerror(errno));
+    }
+    return false;
+}
+
+//! Fill `packet` with `contents`
+static void fill(PacketBuffer &packet, const string &contents) {
+    memcpy(packet.data(), contents.data(), contents.size());
+    packet.resize(contents.size());
+}
+
+int main() {
+    try {
+        // slots are handed out, and a released slot is the next one reused
+        {
+            BufferPool pool{4, 100};
+            test_should_be(pool.slot_count(), size_t{4});
+            test_should_be(pool.slot_size(), size_t{100});
+            test_should_be(pool.available(), size_t{4});
+
+            PacketBuffer a = pool.allocate();
+            PacketBuffer b = pool.allocate();
+            test_should_be(static_cast<bool>(a), true);
+            test_should_be(a.size(), size_t{0});
+            test_should_be(a.capacity(), size_t{100});
+            test_should_be(a.data() != b.data(), true);
+            test_should_be(pool.available(), size_t{2});
+
+            fill(a, "hello");
+            test_should_be(a.str() == "hello", true);
+            const char *a_data = a.data();
+            a = PacketBuffer{};
+            test_should_be(pool.available(), size_t{3});
+
+            PacketBuffer c = pool.allocate();
+            test_should_be(c.data() == a_data, true);
+            test_should_be(c.size(), size_t{0});
+
+            bool threw = false;
+            try {
+                c.resize(101);
+            } catch (const out_of_range &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+
+        // copies share a slot, which is only recycled when the last one goes away
+        {
+            BufferPool pool{2, 64};
+            PacketBuffer a = pool.allocate();
+            fill(a, "shared");
+            PacketBuffer copy = a;
+            Buffer buffer{move(a)};
+            test_should_be(pool.available(), size_t{1});
+            copy = PacketBuffer{};
+            test_should_be(pool.available(), size_t{1});
+            test_should_be(buffer.str() == "shared", true);
+            buffer.remove_prefix(2);
+            test_should_be(buffer.str() == "ared", true);
+            buffer = Buffer{};
+            test_should_be(pool.available(), size_t{2});
+        }
+
+        // when every slot is in use, allocate() returns an empty buffer until one is released
+        {
+            BufferPool pool{3, 32};
+            vector<PacketBuffer> held;
+            set<const char *> distinct;
+            for (unsigned int i = 0; i < 3; ++i) {
+                held.push_back(pool.allocate());
+                test_should_be(static_cast<bool>(held.back()), true);
+                distinct.insert(held.back().data());
+            }
+            test_should_be(distinct.size(), size_t{3});
+            test_should_be(pool.available(), size_t{0});
+
+            const PacketBuffer none = pool.allocate();
+            test_should_be(static_cast<bool>(none), false);
+            test_should_be(none.size(), size_t{0});
+            test_should_be(none.str().empty(), true);
+
+            held.pop_back();
+            test_should_be(static_cast<bool>(pool.allocate()), true);
+        }
+
+        // buffers outlive their pool, and the memory is unmapped when the last one is released
+        {
+            auto pool = make_unique<BufferPool>(8, 256);
+            PacketBuffer first = pool->allocate();
+            fill(first, "first");
+            Buffer second{pool->allocate()};
+            const char *address = first.data();
+
+            BufferPool moved{move(*pool)};
+            test_should_be(pool->available(), size_t{0});
+            test_should_be(moved.available(), size_t{6});
+            pool.reset();
+            test_should_be(mapped(address), true);
+
+            {
+                BufferPool gone{move(moved)};
+            }
+            test_should_be(mapped(address), true);
+            test_should_be(first.str() == "first", true);
+
+            first = PacketBuffer{};
+            test_should_be(mapped(address), true);
+            second = Buffer{};
+            test_should_be(mapped(address), false);
+        }
+
+        // a pool with no outstanding buffers is unmapped right away
+        {
+            const char *address = nullptr;
+            {
+                BufferPool pool{2, 64};
+                address = pool.allocate().data();
+            }
+            test_should_be(mapped(address), false);
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include "byte_stream.hh"
+#include "test_should_be.hh"
+
+#include <cstddef>
+#include <exception>
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    try {
+        {
+            ByteStream stream{10};
+            size_t wakeups = 0;
+            stream.set_readable_watermark(4, [&] { ++wakeups; });
+
+            stream.write("ab");
+            test_should_be(stream.readable(), false);
+            test_should_be(wakeups, size_t{0});
+
+            stream.write("cd");
+            test_should_be(stream.readable(), true);
+            test_should_be(wakeups, size_t{1});
+
+            // already readable: no new edge
+            stream.write("ef");
+            test_should_be(wakeups, size_t{1});
+
+            stream.pop_output(5);
+            test_should_be(stream.readable(), false);
+            stream.write("ghi");
+            test_should_be(wakeups, size_t{2});
+
+            stream.pop_output(4);
+            stream.end_input();
+            test_should_be(stream.readable(), true);
+            test_should_be(wakeups, size_t{3});
+        }
+
+        {
+            ByteStream stream{10};
+            size_t wakeups = 0;
+            stream.set_readable_watermark(100, [&] { ++wakeups; });
+
+            // the watermark is capped at the capacity
+            stream.write("0123456789");
+            test_should_be(stream.readable(), true);
+            test_should_be(wakeups, size_t{1});
+        }
+
+        {
+            ByteStream stream{10};
+            size_t wakeups = 0;
+            stream.set_readable_watermark(4, [&] { ++wakeups; });
+            stream.write("a");
+            stream.set_error();
+            test_should_be(stream.readable(), true);
+            test_should_be(wakeups, size_t{1});
+        }
+
+        {
+            ByteStream stream{10};
+            size_t wakeups = 0;
+            stream.set_writable_watermark(6, [&] { ++wakeups; });
+            test_should_be(stream.writable(), true);
+
+            stream.write("01234567");
+            test_should_be(stream.writable(), false);
+
+            // one byte of space is not enough
+            stream.pop_output(1);
+            test_should_be(stream.writable(), false);
+            test_should_be(wakeups, size_t{0});
+
+            stream.pop_output(3);
+            test_should_be(stream.writable(), true);
+            test_should_be(wakeups, size_t{1});
+
+            stream.pop_output(4);
+            test_should_be(wakeups, size_t{1});
+
+            stream.write("0123456789");
+            stream.end_input();
+            stream.pop_output(10);
+            test_should_be(stream.writable(), false);
+            test_should_be(wakeups, size_t{1});
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
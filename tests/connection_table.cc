@@ -0,0 +1,173 @@
+#include "connection_table.hh"
+
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std;
+
+static FourTuple flow(const uint32_t i) { return {0x0a000000 + i, 0x0a0000ff, static_cast<uint16_t>(i), 80}; }
+
+static bool operator<(const FourTuple &a, const FourTuple &b) {
+    return tie(a.src_ip, a.dst_ip, a.src_port, a.dst_port) < tie(b.src_ip, b.dst_ip, b.src_port, b.dst_port);
+}
+
+//! Check that `table` holds exactly the entries of `model`, and is no more than 70% full
+static void check_same(ConnectionTable<int> &table, const map<FourTuple, int> &model, const uint32_t universe) {
+    test_should_be(table.size(), model.size());
+    test_should_be((table.size() + table.tombstones()) * 10 <= table.capacity() * 7, true);
+    for (uint32_t i = 0; i < universe; ++i) {
+        const auto it = model.find(flow(i));
+        const int *value = table.find(flow(i));
+        if (it == model.end() ? value != nullptr : (value == nullptr or *value != it->second)) {
+            throw runtime_error("ConnectionTable entry " + to_string(i) + " does not match");
+        }
+    }
+    size_t visited = 0;
+    table.for_each([&](const FourTuple &key, int &value) {
+        ++visited;
+        if (model.at(key) != value) {
+            throw runtime_error("ConnectionTable::for_each visited a wrong value");
+        }
+    });
+    test_should_be(visited, model.size());
+}
+
+int main() {
+    try {
+        // insert, find and erase
+        {
+            ConnectionTable<int> table;
+            test_should_be(table.empty(), true);
+            test_should_be(table.find(flow(1)) == nullptr, true);
+
+            auto [value, inserted] = table.insert(flow(1), 10);
+            test_should_be(inserted, true);
+            test_should_be(*value, 10);
+            tie(value, inserted) = table.insert(flow(1), 11);
+            test_should_be(inserted, false);
+            test_should_be(*value, 10);
+            *value = 12;
+            test_should_be(*table.find(flow(1)), 12);
+            test_should_be(table.size(), size_t{1});
+
+            // the same addresses with the ports swapped are a different flow
+            FourTuple swapped = flow(1);
+            swapped.src_port = flow(1).dst_port;
+            swapped.dst_port = flow(1).src_port;
+            test_should_be(table.find(swapped) == nullptr, true);
+
+            test_should_be(table.erase(flow(2)), false);
+            test_should_be(table.erase(flow(1)), true);
+            test_should_be(table.erase(flow(1)), false);
+            test_should_be(table.find(flow(1)) == nullptr, true);
+            test_should_be(table.empty(), true);
+        }
+
+        // an erased entry leaves a tombstone, which a later insertion on the same probe sequence reuses
+        {
+            ConnectionTable<int> table{8};
+            for (uint32_t i = 0; i < 4; ++i) {
+                table.insert(flow(i), i);
+            }
+            table.erase(flow(2));
+            test_should_be(table.tombstones(), size_t{1});
+            for (uint32_t i = 0; i < 4; ++i) {
+                test_should_be(table.find(flow(i)) != nullptr, i != 2);
+            }
+            table.insert(flow(2), 20);
+            test_should_be(table.tombstones(), size_t{0});
+            test_should_be(*table.find(flow(2)), 20);
+            test_should_be(table.capacity(), size_t{8});
+        }
+
+        // the table is rebuilt when live entries and tombstones reach 70% of the slots
+        {
+            ConnectionTable<int> table{8};
+            for (uint32_t i = 0; i < 5; ++i) {
+                table.insert(flow(i), i);
+            }
+            test_should_be(table.capacity(), size_t{8});
+            table.insert(flow(5), 5);
+            test_should_be(table.capacity(), size_t{16});
+            for (uint32_t i = 0; i < 6; ++i) {
+                test_should_be(*table.find(flow(i)), static_cast<int>(i));
+            }
+        }
+
+        // ... and if most of those are tombstones, it is rebuilt at the same size, without them
+        {
+            ConnectionTable<int> table{8};
+            for (uint32_t i = 0; i < 5; ++i) {
+                table.insert(flow(i), i);
+            }
+            for (uint32_t i = 0; i < 4; ++i) {
+                table.erase(flow(i));
+            }
+            test_should_be(table.tombstones(), size_t{4});
+            table.insert(flow(10), 10);
+            test_should_be(table.capacity(), size_t{8});
+            test_should_be(table.tombstones(), size_t{0});
+            test_should_be(table.size(), size_t{2});
+            test_should_be(*table.find(flow(4)), 4);
+            test_should_be(*table.find(flow(10)), 10);
+        }
+
+        // erase_if removes exactly the entries that match, leaving tombstones
+        {
+            ConnectionTable<int> table;
+            for (uint32_t i = 0; i < 20; ++i) {
+                table.insert(flow(i), i);
+            }
+            const size_t removed = table.erase_if([](const FourTuple &, const int &value) { return value % 3 == 0; });
+            test_should_be(removed, size_t{7});
+            test_should_be(table.size(), size_t{13});
+            test_should_be(table.tombstones(), size_t{7});
+            for (uint32_t i = 0; i < 20; ++i) {
+                test_should_be(table.find(flow(i)) != nullptr, i % 3 != 0);
+            }
+            test_should_be(table.erase_if([](const FourTuple &, const int &) { return false; }), size_t{0});
+        }
+
+        // random operations agree with a std::map
+        {
+            constexpr uint32_t universe = 300;
+            mt19937 rng{7};
+            ConnectionTable<int> table{8};
+            map<FourTuple, int> model;
+            for (unsigned int step = 0; step < 20000; ++step) {
+                const FourTuple key = flow(rng() % universe);
+                const int value = static_cast<int>(rng() % 1000);
+                switch (rng() % 4) {
+                    case 0:
+                    case 1:
+                        test_should_be(table.insert(key, int{value}).second, model.emplace(key, value).second);
+                        break;
+                    case 2:
+                        test_should_be(table.erase(key), model.erase(key) == 1);
+                        break;
+                    default:
+                        table.erase_if([&](const FourTuple &, const int &v) { return v == value; });
+                        for (auto it = model.begin(); it != model.end();) {
+                            it = it->second == value ? model.erase(it) : next(it);
+                        }
+                }
+                if (step % 500 == 0) {
+                    check_same(table, model, universe);
+                }
+            }
+            check_same(table, model, universe);
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
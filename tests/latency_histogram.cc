@@ -0,0 +1,71 @@
+#include "latency_histogram.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+int main() {
+    try {
+        // small values are counted exactly
+        {
+            LatencyHistogram h;
+            test_should_be(h.count(), uint64_t{0});
+            test_should_be(h.percentile(50), uint64_t{0});
+            for (uint64_t value = 1; value <= 10; ++value) {
+                h.record(value);
+            }
+            test_should_be(h.count(), uint64_t{10});
+            test_should_be(h.min(), uint64_t{1});
+            test_should_be(h.max(), uint64_t{10});
+            test_should_be(h.mean(), 5.5);
+            test_should_be(h.percentile(50), uint64_t{5});
+            test_should_be(h.percentile(90), uint64_t{9});
+            test_should_be(h.percentile(100), uint64_t{10});
+            test_should_be(h.percentile(0), uint64_t{1});
+        }
+
+        // larger values are known to within 1/32 of themselves
+        {
+            mt19937_64 rng{42};
+            for (unsigned int i = 0; i < 100000; ++i) {
+                const uint64_t value = rng() >> (rng() % 64);
+                LatencyHistogram h;
+                h.record(value);
+                h.record(uint64_t{1} << 50);  // so that the answer isn't clipped to the largest sample
+                const uint64_t reported = h.percentile(50);
+                const uint64_t clamped = min(value, (uint64_t{1} << LatencyHistogram::MAX_VALUE_BITS) - 1);
+                if (reported < clamped or reported - clamped > clamped / LatencyHistogram::SUB_BUCKETS) {
+                    throw runtime_error("value " + to_string(value) + " was reported as " + to_string(reported));
+                }
+            }
+        }
+
+        // percentiles of a uniform distribution, and merging
+        {
+            LatencyHistogram a, b;
+            for (uint64_t value = 1; value <= 100000; ++value) {
+                (value % 2 ? a : b).record(value * 1000);
+            }
+            a.merge(b);
+            test_should_be(a.count(), uint64_t{100000});
+            test_should_be(a.max(), uint64_t{100000000});
+            const uint64_t p99 = a.percentile(99);
+            const uint64_t p999 = a.percentile(99.9);
+            if (p99 < 99000000 or p99 > 99000000 + 99000000 / LatencyHistogram::SUB_BUCKETS) {
+                throw runtime_error("p99 was " + to_string(p99));
+            }
+            if (p999 < 99900000 or p999 > 100000000) {
+                throw runtime_error("p99.9 was " + to_string(p999));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
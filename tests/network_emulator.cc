@@ -0,0 +1,149 @@
+#include "network_emulator.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! A segment occupying 20 + `payload` bytes on the link, numbered by its seqno
+static TCPSegment segment(const uint32_t seqno, const size_t payload) {
+    TCPSegment seg;
+    seg.header().seqno = WrappingInt32{seqno};
+    seg.payload() = string(payload, 'x');
+    return seg;
+}
+
+//! The seqnos of the segments that come out of `emulator` now
+static vector<uint32_t> take(NetworkEmulator &emulator) {
+    vector<NetworkEmulator::Packet> packets;
+    emulator.take_ready(packets);
+    vector<uint32_t> seqnos;
+    for (const auto &packet : packets) {
+        seqnos.push_back(packet.segment.header().seqno.raw_value());
+    }
+    return seqnos;
+}
+
+//! Check that the segments that come out of `emulator` now are those numbered `expected`
+static void expect_ready(NetworkEmulator &emulator, const vector<uint32_t> &expected) {
+    const vector<uint32_t> actual = take(emulator);
+    if (actual != expected) {
+        string message = "expected " + to_string(expected.size()) + " segment(s), got:";
+        for (const auto seqno : actual) {
+            message += " " + to_string(seqno);
+        }
+        throw runtime_error(message);
+    }
+}
+
+int main() {
+    try {
+        // a transparent emulator lets segments straight through
+        {
+            NetworkEmulator emulator{NetemConfig{}};
+            emulator.send(segment(1, 100));
+            test_should_be(take(emulator).size(), size_t{1});
+            test_should_be(emulator.empty(), true);
+        }
+
+        // propagation delay
+        {
+            NetemConfig config;
+            config.delay_ms = 30;
+            NetworkEmulator emulator{config};
+            emulator.send(segment(1, 100));
+            emulator.tick(29);
+            test_should_be(take(emulator).size(), size_t{0});
+            emulator.tick(1);
+            test_should_be(take(emulator).size(), size_t{1});
+        }
+
+        // a 1 Mbit/s link serializes a 1000-byte segment in 8 ms, and the queue drops what doesn't fit
+        {
+            NetemConfig config;
+            config.rate_bps = 1000000;
+            config.queue_bytes = 3000;
+            NetworkEmulator emulator{config};
+            for (uint32_t i = 0; i < 5; ++i) {
+                emulator.send(segment(i, 980));
+            }
+            test_should_be(emulator.stats().dropped_queue, uint64_t{1});  // one is on the link, three queued
+            emulator.tick(7);
+            test_should_be(take(emulator).size(), size_t{0});
+            emulator.tick(1);
+            expect_ready(emulator, {0});
+            emulator.tick(16);
+            expect_ready(emulator, {1, 2});
+            emulator.tick(8);
+            expect_ready(emulator, {3});
+            test_should_be(emulator.empty(), true);
+        }
+
+        // a standing queue: CoDel drops, and drop-tail doesn't (beyond what overflows)
+        for (const auto discipline : {NetemConfig::QueueDiscipline::DropTail, NetemConfig::QueueDiscipline::CoDel}) {
+            NetemConfig config;
+            config.rate_bps = 1000000;
+            config.queue_bytes = 100000;
+            config.queue = discipline;
+            NetworkEmulator emulator{config};
+            // offer 1.33 Mbit/s (which doesn't slow down when dropped) for five seconds
+            for (unsigned int ms = 0; ms < 5000; ++ms) {
+                if (ms % 6 == 0) {
+                    emulator.send(segment(ms, 980));
+                }
+                emulator.tick(1);
+                take(emulator);
+            }
+            if (discipline == NetemConfig::QueueDiscipline::CoDel) {
+                if (emulator.stats().dropped_codel < 50) {
+                    throw runtime_error("CoDel dropped only " + to_string(emulator.stats().dropped_codel));
+                }
+                if (emulator.stats().queue_bytes > 20000) {
+                    throw runtime_error("CoDel let the queue grow to " + to_string(emulator.stats().queue_bytes));
+                }
+            } else {
+                test_should_be(emulator.stats().dropped_codel, uint64_t{0});
+                test_should_be(emulator.stats().queue_bytes > 20000, true);
+            }
+        }
+
+        // the same seed gives the same losses, duplicates and reorderings
+        {
+            const string spec = "delay=10,jitter=5,loss=0.1,duplicate=0.1,reorder=0.1,seed=7";
+            const NetemConfig config = parse_netem_config(spec);
+            test_should_be(config.delay_ms, uint64_t{10});
+            test_should_be(config.seed, uint32_t{7});
+            vector<uint32_t> runs[2];
+            for (auto &run : runs) {
+                NetworkEmulator emulator{config};
+                for (uint32_t i = 0; i < 1000; ++i) {
+                    emulator.send(segment(i, 10));
+                    emulator.tick(1);
+                    for (const auto seqno : take(emulator)) {
+                        run.push_back(seqno);
+                    }
+                }
+            }
+            test_should_be(runs[0] == runs[1], true);
+            test_should_be(runs[0].size() > 800 and runs[0].size() < 1000, true);
+        }
+
+        test_should_be(parse_netem_config("rate=20M,aqm=codel").rate_bps, uint64_t{20000000});
+        bool threw = false;
+        try {
+            parse_netem_config("latency=10");
+        } catch (const runtime_error &) {
+            threw = true;
+        }
+        test_should_be(threw, true);
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
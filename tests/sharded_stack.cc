@@ -0,0 +1,77 @@
+#include "sharded_stack.hh"
+
+#include "address.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <atomic>
+#include <exception>
+#include <iostream>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // a worker's exception is rethrown by stop(), after every worker has been joined
+        {
+            atomic<size_t> setups{0};
+            ShardedStackConfig config;
+            config.shards = 3;
+            config.pin_threads = false;
+            ShardedTCPOverUDPStack stack{config,
+                                         [](const size_t index) {
+                                             if (index == 1) {
+                                                 throw runtime_error("no adapter for shard 1");
+                                             }
+                                             return reuseport_udp_adapter(Address{"127.0.0.1", 0});
+                                         },
+                                         [](size_t, TCPStack<TCPOverUDPSocketAdapter> &) {},
+                                         [&](size_t, TCPStack<TCPOverUDPSocketAdapter> &, EventLoop &) { ++setups; }};
+            string error;
+            try {
+                stack.stop();
+            } catch (const runtime_error &e) {
+                error = e.what();
+            }
+            test_should_be(error == "no adapter for shard 1", true);
+            test_should_be(setups.load(), size_t{2});
+
+            // ... only once
+            stack.stop();
+        }
+
+        // pinning picks among the CPUs the thread may run on
+        {
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            SystemCall("sched_getaffinity", sched_getaffinity(0, sizeof(allowed), &allowed));
+            const unsigned int count = CPU_COUNT(&allowed);
+
+            for (unsigned int i = 0; i < 2 * count; i += count) {
+                test_should_be(pin_current_thread(i), true);
+                cpu_set_t pinned;
+                CPU_ZERO(&pinned);
+                SystemCall("sched_getaffinity", sched_getaffinity(0, sizeof(pinned), &pinned));
+                test_should_be(CPU_COUNT(&pinned), 1);
+
+                // the first allowed CPU (the index wraps around)
+                int first = 0;
+                while (not CPU_ISSET(first, &allowed)) {
+                    ++first;
+                }
+                test_should_be(static_cast<bool>(CPU_ISSET(first, &pinned)), true);
+
+                // so that the next pin starts from the same set
+                SystemCall("sched_setaffinity", sched_setaffinity(0, sizeof(allowed), &allowed));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "simulator.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+//! Simulate one flow of `bytes` over a path described by `spec` (and an ACK path with the same delay)
+static SimFlowResult simulate(const string &spec, const size_t bytes, uint64_t *events = nullptr) {
+    const NetemConfig forward = parse_netem_config(spec);
+    NetemConfig reverse;
+    reverse.delay_ms = forward.delay_ms;
+
+    Simulator sim;
+    SimFlowConfig flow;
+    flow.bytes = bytes;
+    flow.forward_link = sim.add_link(forward);
+    flow.reverse_link = sim.add_link(reverse);
+    sim.add_flow(flow);
+    test_should_be(sim.run(3600 * 1000), true);
+    if (events != nullptr) {
+        *events = sim.events();
+    }
+    return sim.result(0);
+}
+
+int main() {
+    try {
+        // a lossless path: the transfer completes without retransmissions, paced by the window
+        {
+            const SimFlowResult result = simulate("delay=50", 1000000);
+            test_should_be(result.completed, true);
+            test_should_be(result.reset, false);
+            test_should_be(result.client.sender.retransmissions, uint64_t{0});
+            // 64000 bytes per 100 ms round trip, plus the handshake: just over 1.6 s
+            test_should_be(result.finish_ms >= 1600 and result.finish_ms < 1800, true);
+        }
+
+        // a lossy path: the transfer still completes, through retransmissions
+        {
+            const SimFlowResult result = simulate("delay=20,loss=0.02,seed=3", 1000000);
+            test_should_be(result.completed, true);
+            test_should_be(result.client.sender.retransmissions > 0, true);
+        }
+
+        // the same links and flows give the same results
+        {
+            const string spec = "delay=30,jitter=10,loss=0.01,rate=5M,aqm=codel,seed=11";
+            uint64_t events[2]{};
+            const SimFlowResult first = simulate(spec, 500000, &events[0]);
+            const SimFlowResult second = simulate(spec, 500000, &events[1]);
+            test_should_be(first.completed, true);
+            test_should_be(second.finish_ms, first.finish_ms);
+            test_should_be(second.client.sender.retransmissions, first.client.sender.retransmissions);
+            test_should_be(events[1], events[0]);
+        }
+
+        // two flows sharing a bottleneck both complete
+        {
+            Simulator sim;
+            const size_t forward = sim.add_link(parse_netem_config("delay=10,rate=10M"));
+            const size_t reverse = sim.add_link(parse_netem_config("delay=10"));
+            for (uint64_t start_ms : {0, 500}) {
+                SimFlowConfig flow;
+                flow.bytes = 2000000;
+                flow.start_ms = start_ms;
+                flow.forward_link = forward;
+                flow.reverse_link = reverse;
+                sim.add_flow(flow);
+            }
+            test_should_be(sim.run(3600 * 1000), true);
+            test_should_be(sim.result(0).completed and sim.result(1).completed, true);
+            test_should_be(sim.result(1).start_ms, uint64_t{500});
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,45 @@
+#include "siphash.hh"
+
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main() {
+    try {
+        // the key and expected outputs of the test vectors in the SipHash paper's reference implementation
+        const SipHashKey key{0x0706050403020100, 0x0f0e0d0c0b0a0908};
+        string message;
+        for (unsigned int i = 0; i < 15; ++i) {
+            message.push_back(static_cast<char>(i));
+        }
+        test_should_be(siphash24(key, message), uint64_t{0xa129ca6149be45e5});
+        test_should_be(siphash24(key, ""), uint64_t{0x726fdb47dd0e0e31});
+        test_should_be(siphash24(key, message.substr(0, 8)), uint64_t{0x93f5f5799a932462});
+
+        // the output depends on every bit of the key and the message
+        const uint64_t reference = siphash24(key, message);
+        for (unsigned int bit = 0; bit < 64; ++bit) {
+            test_should_be(siphash24({key.k0 ^ (uint64_t{1} << bit), key.k1}, message) != reference, true);
+            test_should_be(siphash24({key.k0, key.k1 ^ (uint64_t{1} << bit)}, message) != reference, true);
+        }
+        for (unsigned int bit = 0; bit < 8 * message.size(); ++bit) {
+            string flipped = message;
+            flipped[bit / 8] = static_cast<char>(flipped[bit / 8] ^ (1 << (bit % 8)));
+            test_should_be(siphash24(key, flipped) != reference, true);
+        }
+
+        // random keys differ
+        const SipHashKey a = SipHashKey::random(), b = SipHashKey::random();
+        test_should_be(a.k0 != b.k0 or a.k1 != b.k1, true);
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
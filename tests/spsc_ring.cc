@@ -0,0 +1,165 @@
+#include "spsc_ring.hh"
+
+#include "test_should_be.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+//! The byte at position `i` of the stress test's stream
+static char pattern(const uint64_t i) { return static_cast<char>(i * 7 % 251); }
+
+int main() {
+    try {
+        // push and pop across the end of the buffer
+        {
+            SPSCRing ring{5};
+            test_should_be(ring.capacity(), size_t{8});
+            test_should_be(ring.push("abcdef"), size_t{6});
+            char buffer[8];
+            test_should_be(ring.pop(buffer, 4), size_t{4});
+            test_should_be(string(buffer, 4) == "abcd", true);
+
+            test_should_be(ring.push("ghijklmn"), size_t{6});
+            test_should_be(ring.size(), size_t{8});
+            test_should_be(ring.push("x"), size_t{0});
+
+            // peek() stops at the end of the buffer; the rest comes from its start
+            test_should_be(ring.peek() == "efgh", true);
+            ring.pop(3);
+            test_should_be(ring.peek() == "h", true);
+            ring.pop(1);
+            test_should_be(ring.peek() == "ijkl", true);
+
+            // pop() copies across the end of the buffer
+            test_should_be(ring.push("opqr"), size_t{4});
+            test_should_be(ring.pop(buffer, 8), size_t{8});
+            test_should_be(string(buffer, 8) == "ijklopqr", true);
+            test_should_be(ring.empty(), true);
+            test_should_be(ring.peek().empty(), true);
+
+            bool threw = false;
+            try {
+                ring.pop(1);
+            } catch (const out_of_range &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+
+        // close() wakes a reader blocked on an empty ring, which then sees end-of-stream
+        {
+            SPSCRing ring{16};
+            atomic<bool> woke{false};
+            thread reader([&] {
+                ring.wait_readable();
+                woke = true;
+            });
+            this_thread::sleep_for(chrono::milliseconds(50));
+            test_should_be(woke.load(), false);
+            ring.close();
+            reader.join();
+            test_should_be(woke.load(), true);
+            test_should_be(ring.closed() and ring.empty(), true);
+            test_should_be(ring.push("x"), size_t{0});
+        }
+
+        // close() wakes a writer blocked on a full ring, and the reader can still drain what is left
+        {
+            SPSCRing ring{16};
+            test_should_be(ring.push(string(16, 'a')), size_t{16});
+            atomic<bool> woke{false};
+            thread writer([&] {
+                ring.wait_writable();
+                woke = true;
+            });
+            this_thread::sleep_for(chrono::milliseconds(50));
+            test_should_be(woke.load(), false);
+            ring.close();
+            writer.join();
+            test_should_be(woke.load(), true);
+            test_should_be(ring.push("b"), size_t{0});
+            test_should_be(ring.size(), size_t{16});
+            ring.pop(16);
+            test_should_be(ring.empty(), true);
+        }
+
+        // popping from a full ring wakes a blocked writer
+        {
+            SPSCRing ring{16};
+            ring.push(string(16, 'a'));
+            thread writer([&] {
+                while (ring.push("b") == 0) {
+                    ring.wait_writable();
+                }
+            });
+            this_thread::sleep_for(chrono::milliseconds(10));
+            ring.pop(1);
+            writer.join();
+            test_should_be(ring.size(), size_t{16});
+        }
+
+        // two threads, with chunks of random sizes: every byte arrives, in order
+        {
+            constexpr uint64_t total = 64 << 20;
+            SPSCRing ring{4096};
+            thread producer([&] {
+                mt19937 rng{1};
+                string chunk;
+                uint64_t sent = 0;
+                while (sent < total) {
+                    const uint64_t len = min<uint64_t>(rng() % 3000 + 1, total - sent);
+                    chunk.resize(len);
+                    for (uint64_t i = 0; i < len; ++i) {
+                        chunk[i] = pattern(sent + i);
+                    }
+                    string_view rest{chunk};
+                    while (not rest.empty()) {
+                        const size_t pushed = ring.push(rest);
+                        rest.remove_prefix(pushed);
+                        if (pushed == 0) {
+                            ring.wait_writable();
+                        }
+                    }
+                    sent += len;
+                }
+                ring.close();
+            });
+
+            uint64_t received = 0;
+            bool in_order = true;
+            while (true) {
+                const bool closed = ring.closed();
+                const string_view chunk = ring.peek();
+                if (chunk.empty()) {
+                    if (closed) {
+                        break;
+                    }
+                    ring.wait_readable();
+                    continue;
+                }
+                for (const char c : chunk) {
+                    in_order &= c == pattern(received++);
+                }
+                ring.pop(chunk.size());
+            }
+            producer.join();
+
+            test_should_be(received, total);
+            test_should_be(in_order, true);
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#include "static_eventloop.hh"
+
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <exception>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <utility>
+
+using namespace std;
+
+//! Both ends of a pipe
+static pair<FileDescriptor, FileDescriptor> make_pipe() {
+    int fds[2];
+    SystemCall("pipe", ::pipe(fds));
+    return {FileDescriptor{fds[0]}, FileDescriptor{fds[1]}};
+}
+
+int main() {
+    try {
+        // nothing is polled until some interest is set
+        {
+            auto [reader, writer] = make_pipe();
+            FdHandler handler{reader, [] {}};
+            StaticEventLoop loop{handler};
+            test_should_be(loop.interest(0, Direction::In), false);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Exit, true);
+        }
+
+        // readable and writable handlers are called only in the directions they are interested in
+        {
+            auto [reader, writer] = make_pipe();
+            string received;
+            unsigned int writes = 0;
+            FdHandler read_handler{reader, [&] { received += reader.read(); }};
+            FdHandler write_handler{writer, NoOpCallback{}, [&] { writer.write(to_string(writes++)); }};
+            StaticEventLoop loop{read_handler, write_handler};
+
+            loop.set_interest(0, Direction::In, true);
+            test_should_be(loop.interest(0, Direction::In), true);
+            test_should_be(loop.interest(0, Direction::Out), false);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+
+            loop.set_interest(1, Direction::Out, true);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(writes, 1u);
+            // handlers are dispatched in order, so the reader sees only what was written before this poll
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(received == "0", true);
+            test_should_be(writes, 2u);
+
+            // a writable handler that isn't interested in writing is skipped
+            loop.set_interest(1, Direction::Out, false);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(writes, 2u);
+            test_should_be(received == "01", true);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+
+            loop.set_interest(0, Direction::In, false);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Exit, true);
+        }
+
+        // a hangup clears the handler's interest and calls on_hangup, once; then nothing is left to poll
+        {
+            auto [reader, writer] = make_pipe();
+            string received;
+            unsigned int hangups = 0;
+            FdHandler handler{reader, [&] { received += reader.read(); }, NoOpCallback{}, [&] { ++hangups; }};
+            StaticEventLoop loop{handler};
+            loop.set_interest(0, Direction::In, true);
+
+            // data still buffered in the pipe is readable, even though the writer is gone
+            writer.write("abc");
+            writer.close();
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(received == "abc", true);
+            test_should_be(hangups, 0u);
+            test_should_be(loop.interest(0, Direction::In), true);
+
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(hangups, 1u);
+            test_should_be(loop.interest(0, Direction::In), false);
+            test_should_be(loop.wait_next_event(-1) == EventLoop::Result::Exit, true);
+            test_should_be(hangups, 1u);
+        }
+
+        // a hangup of one handler leaves the others polled
+        {
+            auto [reader1, writer1] = make_pipe();
+            auto [reader2, writer2] = make_pipe();
+            unsigned int hangups1 = 0, reads2 = 0;
+            FdHandler handler1{reader1, NoOpCallback{}, NoOpCallback{}, [&] { ++hangups1; }};
+            FdHandler handler2{reader2, [&] {
+                                   reader2.read();
+                                   ++reads2;
+                               }};
+            StaticEventLoop loop{handler1, handler2};
+            loop.set_interest(0, Direction::In, true);
+            loop.set_interest(1, Direction::In, true);
+
+            writer1.close();
+            writer2.write("x");
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Success, true);
+            test_should_be(hangups1, 1u);
+            test_should_be(reads2, 1u);
+            test_should_be(loop.interest(0, Direction::In), false);
+            test_should_be(loop.interest(1, Direction::In), true);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Timeout, true);
+
+            loop.set_interest(1, Direction::In, false);
+            test_should_be(loop.wait_next_event(0) == EventLoop::Result::Exit, true);
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,265 @@
+#include "tcp_stack.hh"
+
+#include "memory_adapter.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+using MemoryStack = TCPStack<MemoryAdapter>;
+
+//! The `i`th peer's flow to the local end 10.0.0.1:80
+static FourTuple peer(const uint32_t i) { return {0x0a000100 + i, 0x0a000001, static_cast<uint16_t>(1000 + i), 80}; }
+
+static TCPSegment syn(const uint32_t isn) {
+    TCPSegment seg;
+    seg.header().syn = true;
+    seg.header().seqno = WrappingInt32{isn};
+    return seg;
+}
+
+static TCPSegment ack(const WrappingInt32 seqno, const WrappingInt32 ackno) {
+    TCPSegment seg;
+    seg.header().ack = true;
+    seg.header().seqno = seqno;
+    seg.header().ackno = ackno;
+    seg.header().win = 1000;
+    return seg;
+}
+
+//! Hand `segment` from `flow` to the stack
+static void deliver(MemoryStack &stack, const FourTuple &flow, const TCPSegment &segment) {
+    stack.adapter().deliver(flow, segment);
+    stack.receive();
+}
+
+//! Remove the only segment the stack has sent (which must be to `flow`)
+static TCPSegment take_sent(MemoryStack &stack, const FourTuple &flow) {
+    auto &sent = stack.adapter().sent();
+    test_should_be(sent.size(), size_t{1});
+    test_should_be(sent.front().flow == flow, true);
+    TCPSegment segment = sent.front().segment;
+    sent.pop_front();
+    return segment;
+}
+
+//! Send a SYN from `flow`, and return the SYN-ACK
+static TCPSegment syn_ack_for(MemoryStack &stack, const FourTuple &flow, const uint32_t isn) {
+    deliver(stack, flow, syn(isn));
+    const TCPSegment syn_ack = take_sent(stack, flow);
+    test_should_be(syn_ack.header().syn, true);
+    test_should_be(syn_ack.header().ack, true);
+    test_should_be(syn_ack.header().ackno, WrappingInt32{isn + 1});
+    return syn_ack;
+}
+
+//! Complete the handshake started by syn_ack_for()
+static void ack_syn_ack(MemoryStack &stack, const FourTuple &flow, const uint32_t isn, const TCPSegment &syn_ack) {
+    deliver(stack, flow, ack(WrappingInt32{isn + 1}, syn_ack.header().seqno + 1));
+}
+
+//! Complete a handshake from `flow` and accept the connection
+//! \returns the stack's ISN
+static WrappingInt32 establish(MemoryStack &stack, const FourTuple &flow, const uint32_t isn) {
+    const TCPSegment syn_ack = syn_ack_for(stack, flow, isn);
+    ack_syn_ack(stack, flow, isn, syn_ack);
+    test_should_be(*stack.accept() == flow, true);
+    return syn_ack.header().seqno;
+}
+
+//! A segment from a peer whose handshake was done with establish()
+static TCPSegment data(const uint32_t isn, const WrappingInt32 stack_isn, const string &payload) {
+    TCPSegment seg = ack(WrappingInt32{isn + 1}, stack_isn + 1);
+    seg.payload() = string{payload};
+    return seg;
+}
+
+static MemoryStack listening_stack(const size_t syn_backlog, const size_t accept_backlog, const SynCookies cookies) {
+    MemoryStack stack{MemoryAdapter{}};
+    ListenConfig config;
+    config.syn_backlog = syn_backlog;
+    config.accept_backlog = accept_backlog;
+    config.syn_cookies = cookies;
+    stack.listen(config);
+    return stack;
+}
+
+int main() {
+    try {
+        // SYN, SYN-ACK, ACK: the connection goes through the SYN backlog to the accept queue
+        {
+            MemoryStack stack = listening_stack(4, 4, SynCookies::WhenFull);
+            const TCPSegment syn_ack = syn_ack_for(stack, peer(0), 1000);
+            test_should_be(stack.syn_received(), size_t{1});
+            test_should_be(stack.accept_queue_size(), size_t{0});
+            test_should_be(stack.find(peer(0)) == nullptr, true);
+
+            ack_syn_ack(stack, peer(0), 1000, syn_ack);
+            test_should_be(stack.syn_received(), size_t{0});
+            test_should_be(stack.accept_queue_size(), size_t{1});
+            test_should_be(stack.adapter().sent().empty(), true);
+
+            const optional<FourTuple> accepted = stack.accept();
+            test_should_be(accepted.has_value() and *accepted == peer(0), true);
+            test_should_be(stack.accept().has_value(), false);
+            TCPConnection *connection = stack.find(peer(0));
+            test_should_be(connection != nullptr, true);
+            test_should_be(connection->state() == TCPState::State::ESTABLISHED, true);
+        }
+
+        // beyond the SYN backlog, SYNs are answered with cookies, and a valid cookie creates the connection
+        {
+            MemoryStack stack = listening_stack(1, 4, SynCookies::WhenFull);
+            syn_ack_for(stack, peer(0), 1000);
+            test_should_be(stack.syn_received(), size_t{1});
+
+            const TCPSegment cookie = syn_ack_for(stack, peer(1), 2000);
+            test_should_be(stack.syn_received(), size_t{1});
+            test_should_be(stack.size(), size_t{1});
+
+            ack_syn_ack(stack, peer(1), 2000, cookie);
+            test_should_be(stack.size(), size_t{2});
+            test_should_be(stack.accept_queue_size(), size_t{1});
+            test_should_be(stack.adapter().sent().empty(), true);
+            test_should_be(*stack.accept() == peer(1), true);
+            test_should_be(stack.find(peer(1))->state() == TCPState::State::ESTABLISHED, true);
+
+            // the connection works, with the cookie as its ISN
+            test_should_be(stack.write(peer(1), "hello"), size_t{5});
+            const TCPSegment data = take_sent(stack, peer(1));
+            test_should_be(data.header().seqno, cookie.header().seqno + 1);
+            test_should_be(data.payload().str() == "hello", true);
+        }
+
+        // a cookie is rejected if it doesn't match the flow, the peer's ISN, or its own hash
+        {
+            MemoryStack stack = listening_stack(4, 4, SynCookies::Always);
+            const TCPSegment cookie = syn_ack_for(stack, peer(0), 1000);
+            test_should_be(stack.size(), size_t{0});
+
+            deliver(stack, peer(0), ack(WrappingInt32{1001}, cookie.header().seqno + 2));
+            deliver(stack, peer(0), ack(WrappingInt32{1001}, cookie.header().seqno + (1 + (1 << 20))));
+            deliver(stack, peer(0), ack(WrappingInt32{5001}, cookie.header().seqno + 1));
+            ack_syn_ack(stack, peer(1), 1000, cookie);
+            test_should_be(stack.size(), size_t{0});
+            test_should_be(stack.accept_queue_size(), size_t{0});
+
+            ack_syn_ack(stack, peer(0), 1000, cookie);
+            test_should_be(stack.size(), size_t{1});
+            test_should_be(stack.accept_queue_size(), size_t{1});
+        }
+
+        // a cookie is valid in the period it was issued and the next one, but not after
+        {
+            MemoryStack stack = listening_stack(4, 4, SynCookies::Always);
+            const TCPSegment fresh = syn_ack_for(stack, peer(0), 1000);
+            const TCPSegment stale = syn_ack_for(stack, peer(1), 2000);
+
+            stack.tick(MemoryStack::SYN_COOKIE_PERIOD_MS);
+            ack_syn_ack(stack, peer(0), 1000, fresh);
+            test_should_be(stack.accept_queue_size(), size_t{1});
+
+            stack.tick(MemoryStack::SYN_COOKIE_PERIOD_MS);
+            ack_syn_ack(stack, peer(1), 2000, stale);
+            test_should_be(stack.accept_queue_size(), size_t{1});
+            test_should_be(stack.size(), size_t{1});
+        }
+
+        // when the accept queue is full, SYNs are dropped (not answered, even with a cookie)
+        {
+            MemoryStack stack = listening_stack(4, 1, SynCookies::WhenFull);
+            const TCPSegment syn_ack = syn_ack_for(stack, peer(0), 1000);
+            ack_syn_ack(stack, peer(0), 1000, syn_ack);
+            test_should_be(stack.accept_queue_size(), size_t{1});
+
+            deliver(stack, peer(1), syn(2000));
+            test_should_be(stack.adapter().sent().empty(), true);
+            test_should_be(stack.syn_received(), size_t{0});
+            test_should_be(stack.size(), size_t{1});
+
+            // once the queue has room, the same SYN is answered
+            stack.accept();
+            syn_ack_for(stack, peer(1), 2000);
+            test_should_be(stack.syn_received(), size_t{1});
+        }
+
+        // segments are routed by their 4-tuple, and replies go back to the same 4-tuple
+        {
+            MemoryStack stack = listening_stack(8, 8, SynCookies::WhenFull);
+            FourTuple other_port = peer(0);
+            ++other_port.src_port;
+            FourTuple other_local = peer(0);
+            --other_local.dst_ip;
+            const FourTuple flows[] = {peer(0), peer(1), other_port, other_local};
+            WrappingInt32 stack_isns[4] = {WrappingInt32{0}, WrappingInt32{0}, WrappingInt32{0}, WrappingInt32{0}};
+            for (uint32_t i = 0; i < 4; ++i) {
+                stack_isns[i] = establish(stack, flows[i], 1000 * i);
+            }
+            test_should_be(stack.size(), size_t{4});
+
+            for (uint32_t i = 4; i-- > 0;) {
+                deliver(stack, flows[i], data(1000 * i, stack_isns[i], "flow " + to_string(i)));
+                const TCPSegment reply = take_sent(stack, flows[i]);
+                test_should_be(reply.header().ackno, WrappingInt32{1000 * i + 1 + 6});
+            }
+            for (uint32_t i = 0; i < 4; ++i) {
+                test_should_be(stack.find(flows[i])->inbound_stream().read(100) == "flow " + to_string(i), true);
+            }
+
+            // a segment for an unknown flow that differs from a known one in one field goes nowhere
+            FourTuple stranger = peer(1);
+            stranger.dst_port = 81;
+            deliver(stack, stranger, data(1000, stack_isns[1], "x"));
+            test_should_be(stack.adapter().sent().empty(), true);
+            test_should_be(stack.find(peer(1))->inbound_stream().buffer_empty(), true);
+        }
+
+        // a closed connection is kept until its owner has read what the peer sent, or releases it
+        {
+            MemoryStack stack = listening_stack(8, 8, SynCookies::WhenFull);
+            const WrappingInt32 isn0 = establish(stack, peer(0), 1000);
+            const WrappingInt32 isn1 = establish(stack, peer(1), 2000);
+            test_should_be(stack.release(peer(0)), false);
+
+            for (uint32_t i = 0; i < 2; ++i) {
+                const uint32_t isn = 1000 * (i + 1);
+                deliver(stack, peer(i), data(isn, i == 0 ? isn0 : isn1, "unread"));
+                stack.adapter().sent().clear();
+                TCPSegment rst = ack(WrappingInt32{isn + 1 + 6}, (i == 0 ? isn0 : isn1) + 1);
+                rst.header().rst = true;
+                deliver(stack, peer(i), rst);
+                test_should_be(stack.find(peer(i))->active(), false);
+            }
+
+            stack.tick(1);
+            test_should_be(stack.size(), size_t{2});
+            test_should_be(stack.find(peer(0))->inbound_stream().read(100) == "unread", true);
+            stack.tick(1);
+            test_should_be(stack.find(peer(0)) == nullptr, true);
+            test_should_be(stack.size(), size_t{1});
+
+            test_should_be(stack.release(peer(1)), true);
+            test_should_be(stack.release(peer(1)), false);
+            test_should_be(stack.size(), size_t{0});
+        }
+
+        // a stack that isn't listening ignores SYNs
+        {
+            MemoryStack stack{MemoryAdapter{}};
+            deliver(stack, peer(0), syn(1000));
+            test_should_be(stack.adapter().sent().empty(), true);
+            test_should_be(stack.size(), size_t{0});
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
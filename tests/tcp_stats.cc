@@ -0,0 +1,116 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "test_should_be.hh"
+
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static vector<TCPSegment> take(TCPConnection &connection) {
+    vector<TCPSegment> segments;
+    connection.drain_segments(segments);
+    return segments;
+}
+
+static void deliver(TCPConnection &connection, const vector<TCPSegment> &segments) {
+    for (const auto &segment : segments) {
+        connection.segment_received(segment);
+    }
+}
+
+int main() {
+    try {
+        TCPConfig config;
+        config.rt_timeout = 1000;
+        config.recv_capacity = 20;
+        config.measure_latency = true;
+        TCPConnection x{config};
+        TCPConnection y{config};
+
+        // handshake, with the SYN taking 10 ms to be acknowledged
+        x.connect();
+        const auto syn = take(x);
+        x.tick(10);
+        deliver(y, syn);
+        deliver(x, take(y));
+        deliver(y, take(x));
+        test_should_be(x.stats().sender.rtt_samples, uint64_t{1});
+        test_should_be(x.stats().sender.srtt_ms, 10.0);
+        test_should_be(x.stats().sender.rttvar_ms, 5.0);
+        test_should_be(x.stats().sender.segments_sent, uint64_t{2});
+        test_should_be(x.stats().sender.peer_window, uint64_t{20});
+        test_should_be(x.stats().segments_received, uint64_t{1});
+
+        // nothing to send
+        x.tick(50);
+        test_should_be(x.stats().sender.sender_limited_ms, uint64_t{50});
+        test_should_be(x.stats().sender.window_limited_ms, uint64_t{0});
+
+        // a lost segment is retransmitted, and its ACK is not used to measure the RTT
+        x.write("hello");
+        take(x);
+        x.tick(1000);
+        test_should_be(x.stats().sender.rto_expirations, uint64_t{1});
+        test_should_be(x.stats().sender.retransmissions, uint64_t{1});
+        test_should_be(x.stats().sender.bytes_retransmitted, uint64_t{5});
+        test_should_be(x.stats().sender.bytes_sent, uint64_t{10});
+        test_should_be(x.stats().sender.rto_ms, uint64_t{2000});
+        test_should_be(x.stats().sender.bytes_in_flight, uint64_t{5});
+        deliver(y, take(x));
+        deliver(x, take(y));
+        test_should_be(x.stats().sender.rtt_samples, uint64_t{1});
+        test_should_be(x.stats().sender.rto_ms, uint64_t{1000});
+        test_should_be(x.stats().sender.bytes_in_flight, uint64_t{0});
+
+        // a duplicated segment, acknowledged at once
+        x.write("world");
+        const auto world = take(x);
+        deliver(y, world);
+        deliver(y, world);
+        test_should_be(y.stats().receiver.duplicate_segments, uint64_t{1});
+        deliver(x, take(y));
+        test_should_be(x.stats().sender.rtt_samples, uint64_t{2});
+        test_should_be(x.stats().sender.srtt_ms, 8.75);
+        test_should_be(x.stats().sender.rttvar_ms, 6.25);
+
+        // two segments, delivered out of order
+        x.write("abc");
+        const auto abc = take(x);
+        x.write("def");
+        deliver(y, take(x));
+        test_should_be(y.stats().receiver.out_of_order_segments, uint64_t{1});
+        test_should_be(y.stats().receiver.out_of_order_bytes, uint64_t{3});
+        deliver(y, abc);
+        test_should_be(y.stats().receiver.out_of_order_bytes, uint64_t{0});
+        test_should_be(y.stats().receiver.window, uint64_t{4});
+        deliver(x, take(y));
+
+        // filling the receiver's buffer closes the window
+        x.write("ghij");
+        deliver(y, take(x));
+        deliver(x, take(y));
+        test_should_be(x.stats().sender.zero_window_events, uint64_t{1});
+        test_should_be(x.stats().sender.peer_window, uint64_t{0});
+
+        // with the window closed, one byte is sent as a probe and the rest waits
+        x.write("kl");
+        take(x);
+        x.tick(100);
+        test_should_be(x.stats().sender.window_limited_ms, uint64_t{100});
+
+        test_should_be(y.stats().receiver.segments_received, uint64_t{8});
+        test_should_be(y.stats().receiver.bytes_received, uint64_t{25});
+
+        // every write but the last has been acknowledged (and y wrote nothing)
+        test_should_be(x.stats().write_latency.count(), uint64_t{5});
+        test_should_be(y.stats().write_latency.count(), uint64_t{0});
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
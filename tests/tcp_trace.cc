@@ -0,0 +1,143 @@
+#include "tcp_trace.hh"
+
+#include "file_descriptor.hh"
+#include "test_should_be.hh"
+#include "util.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+//! Record `count` WindowUpdate events for `connection`, numbered from zero
+static void record_many(const uint32_t connection, const uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+        TraceRecord record;
+        record.connection = connection;
+        record.event = TraceEvent::WindowUpdate;
+        record.value = i;
+        Tracer::record(record);
+    }
+}
+
+int main() {
+    char path[] = "/tmp/tcp_trace_test_XXXXXX";
+    FileDescriptor{SystemCall("mkstemp", ::mkstemp(path))};  // only the name is needed
+
+    try {
+        // events from several threads all reach the file, with their fields intact
+        {
+            constexpr uint32_t per_thread = 5000;
+            Tracer::start(path, 1 << 14);
+            test_should_be(Tracer::enabled(), true);
+
+            TCPSegment seg;
+            seg.header().syn = true;
+            seg.header().ack = true;
+            seg.header().seqno = WrappingInt32{1234};
+            seg.header().ackno = WrappingInt32{5678};
+            seg.header().win = 999;
+            seg.header().sport = 1000;
+            seg.header().dport = 80;
+            seg.payload() = string(10, 'x');
+            Tracer::segment(TraceEvent::SegmentSent, seg, 0x0a000001, 0x0a000002);
+
+            thread first(record_many, 1, per_thread);
+            thread second(record_many, 2, per_thread);
+            first.join();
+            second.join();
+
+            test_should_be(Tracer::stop(), uint64_t{0});
+            test_should_be(Tracer::enabled(), false);
+
+            TraceFileHeader header;
+            const vector<TraceRecord> records = read_trace_file(path, header);
+            test_should_be(header.realtime_offset_ns != 0, true);
+            test_should_be(records.size(), size_t{2 * per_thread + 1});
+
+            uint32_t next_value[3] = {0, 0, 0};
+            uint64_t last_time[3] = {0, 0, 0};
+            size_t segments = 0;
+            for (const auto &record : records) {
+                if (record.event == TraceEvent::SegmentSent) {
+                    ++segments;
+                    test_should_be(record.connection, uint32_t{0});
+                    test_should_be(record.flags, uint8_t{0x12});
+                    test_should_be(record.seqno, uint32_t{1234});
+                    test_should_be(record.ackno, uint32_t{5678});
+                    test_should_be(record.win, uint16_t{999});
+                    test_should_be(record.length, uint32_t{10});
+                    test_should_be(record.src_ip, uint32_t{0x0a000001});
+                    test_should_be(record.dst_ip, uint32_t{0x0a000002});
+                    test_should_be(record.sport, uint16_t{1000});
+                    test_should_be(record.dport, uint16_t{80});
+                    continue;
+                }
+
+                // each thread's events are in the order (and time order) it recorded them
+                test_should_be(record.event == TraceEvent::WindowUpdate, true);
+                test_should_be(record.connection == 1 or record.connection == 2, true);
+                test_should_be(record.value, next_value[record.connection]++);
+                test_should_be(record.time_ns >= last_time[record.connection], true);
+                last_time[record.connection] = record.time_ns;
+                test_should_be(record.reserved, uint32_t{0});
+            }
+            test_should_be(segments, size_t{1});
+            test_should_be(next_value[1], per_thread);
+            test_should_be(next_value[2], per_thread);
+        }
+
+        // events that don't fit in a full ring are dropped and counted, and the rest are kept
+        {
+            constexpr uint32_t total = 10000;
+            Tracer::start(path, 16);
+            thread recorder(record_many, 7, total);
+            recorder.join();
+            const uint64_t dropped = Tracer::stop();
+
+            TraceFileHeader header;
+            const vector<TraceRecord> records = read_trace_file(path, header);
+            test_should_be(dropped > 0, true);
+            test_should_be(records.size() + dropped, uint64_t{total});
+
+            // the kept events are the first ones recorded after each drain, so their values only increase
+            uint32_t previous = 0;
+            for (size_t i = 0; i < records.size(); ++i) {
+                test_should_be(records[i].connection, uint32_t{7});
+                test_should_be(i == 0 or records[i].value > previous, true);
+                previous = records[i].value;
+            }
+        }
+
+        // a file that isn't a trace is rejected
+        {
+            FileDescriptor file{SystemCall("open", ::open(path, O_WRONLY | O_TRUNC))};
+            file.write("not a trace file, but long enough to hold a header");
+            file.close();
+
+            TraceFileHeader header;
+            bool threw = false;
+            try {
+                read_trace_file(path, header);
+            } catch (const runtime_error &) {
+                threw = true;
+            }
+            test_should_be(threw, true);
+        }
+    } catch (const exception &e) {
+        cerr << "Test failure: " << e.what() << endl;
+        ::unlink(path);
+        return EXIT_FAILURE;
+    }
+
+    ::unlink(path);
+    return EXIT_SUCCESS;
+}